@@ -20,7 +20,7 @@ cache_sim::cache_sim(unsigned  assoc_1, unsigned  assoc_2, unsigned  l1_size, un
 
                      }
 
-unsigned int L1_L2_Cache::get_index_L2(unsigned int address, unsigned long cache_l2_size, unsigned long associativity,unsigned long block_size)
+unsigned int L1_L2_Cache::get_index_L2(unsigned long address, unsigned long cache_l2_size, unsigned long associativity,unsigned long block_size)
                               {
     unsigned long int sets=cache_l2_size/(associativity*block_size);
     unsigned int index=log2(sets);
@@ -29,7 +29,7 @@ unsigned int L1_L2_Cache::get_index_L2(unsigned int address, unsigned long cache
     return index_bit;
                               }
 
-unsigned int L1_L2_Cache::get_tag_L2(unsigned int address, unsigned long cache_l2_size, unsigned long associativity,
+unsigned int L1_L2_Cache::get_tag_L2(unsigned long address, unsigned long cache_l2_size, unsigned long associativity,
                                      unsigned long block_size)
                                      {
                                          unsigned long int sets=cache_l2_size/(associativity*block_size);
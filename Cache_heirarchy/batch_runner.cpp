@@ -0,0 +1,301 @@
+//
+// Created by Sweta Subhra Datta
+//
+#include "batch_runner.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+using namespace std;
+
+/*
+ * Reads a job list, one job per line, '#' starts a comment:
+ *   <trace_file> <BLOCKSIZE> <L1_SIZE> <L1_ASSOC> <VC_NUM_BLOCKS> <L2_SIZE> <L2_ASSOC> [--index=..] [--dead-block=..]
+ *   <trace_file> --config=<hierarchy file>
+ * @return false after printing the error if a line is malformed
+ */
+bool parse_job_list(const char *job_file, vector<batch_job> &jobs)
+{
+    ifstream job_list(job_file);
+    if(!job_list.is_open())
+    {
+        printf("Error: Unable to open file %s\n", job_file);
+        return false;
+    }
+    string line;
+    unsigned line_no=0;
+    while(getline(job_list,line))
+    {
+        line_no++;
+        size_t comment=line.find('#');
+        if(comment!=string::npos)
+        {
+            line.erase(comment);
+        }
+        istringstream fields(line);
+        batch_job job;
+        if(!(fields>>job.trace_file))
+        {
+            continue;
+        }
+        string rest;
+        getline(fields,rest);
+        job.description=rest.substr(rest.find_first_not_of(" \t")==string::npos?rest.size():rest.find_first_not_of(" \t"));
+        istringstream config(rest);
+        string first;
+        config>>first;
+        if(first.compare(0,9,"--config=")==0)
+        {
+            job.config_file=first.substr(9);
+            jobs.push_back(job);
+            continue;
+        }
+        level_params l1_config;
+        level_params l2_config;
+        istringstream numbers(rest);
+        if(!(numbers>>l1_config.block_size>>l1_config.size>>l1_config.assoc>>l1_config.vc_num_blocks>>l2_config.size>>l2_config.assoc))
+        {
+            printf("Error: %s:%u: expected <trace> <6 cache parameters> or <trace> --config=<file>\n", job_file, line_no);
+            return false;
+        }
+        string option;
+        while(numbers>>option)
+        {
+            bool ok=false;
+            if(option.compare(0,8,"--index=")==0)
+                ok=parse_index_policy(option.c_str()+8,&l1_config.index_policy);
+            else if(option.compare(0,13,"--dead-block=")==0)
+                ok=parse_dead_block_policy(option.c_str()+13,&l1_config.dead_block_policy,&l1_config.dead_block_region_bits);
+            if(!ok)
+            {
+                printf("Error: %s:%u: bad option %s\n", job_file, line_no, option.c_str());
+                return false;
+            }
+        }
+        l1_config.name="L1";
+        job.levels.push_back(l1_config);
+        if(l2_config.size!=0)
+        {
+            l2_config.name="L2";
+            l2_config.block_size=l1_config.block_size;
+            job.levels[0].next="L2";
+            job.levels.push_back(l2_config);
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+/*
+ * Runs one job against its already loaded trace
+ */
+static void run_job(const batch_job &job, const vector<trace_record_t> &records, batch_result &result)
+{
+    cache_hierarchy hierarchy;
+    if(!job.config_file.empty())
+    {
+        if(!hierarchy.load_config(job.config_file.c_str()))
+            return;
+    }
+    else
+    {
+        for(unsigned i=0;i<job.levels.size();i++)
+        {
+            hierarchy.add_level(job.levels[i]);
+        }
+        if(!hierarchy.link())
+            return;
+    }
+    //a miss the victim cache satisfies never leaves L1, so misses are the accesses neither one held
+    unsigned long l1_misses=0;
+    chrono::steady_clock::time_point start=chrono::steady_clock::now();
+    for(size_t i=0;i<records.size();i++)
+    {
+        if(records[i].rw=='r' || records[i].rw=='w')
+        {
+            if(!hierarchy.access(hierarchy.data_entry,records[i].address,records[i].rw=='w'))
+                l1_misses++;
+        }
+        else if(records[i].rw=='i' && !job.config_file.empty())
+        {
+            //positional jobs have no L1I and drop fetches like the simulator does
+            hierarchy.instruction_fetch(records[i].address);
+        }
+    }
+    result.seconds=chrono::duration<double>(chrono::steady_clock::now()-start).count();
+    cache_level *L1=hierarchy.data_entry;
+    result.accesses=records.size();
+    result.l1_misses=l1_misses;
+    unsigned long l1_accesses=L1->cache->L1_reads+L1->cache->L1_writes;
+    result.l1_miss_rate=(l1_accesses==0)?0:(double)result.l1_misses/(double)l1_accesses;
+    result.l1_writebacks=L1->writebacks;
+    if(L1->next!=NULL)
+    {
+        cache_sim *L2=L1->next->cache;
+        result.l2_miss_rate=(L2->L1_reads==0)?0:(double)L2->L1_read_misses/(double)L2->L1_reads;
+    }
+    result.memory_traffic=hierarchy.memory_reads+hierarchy.memory_writes;
+    result.ok=true;
+}
+
+/*
+ * Work-stealing pool: every worker owns a deque, pops its own jobs from the back and
+ * steals from the front of the others once it runs dry. No job creates new jobs,
+ * so a worker that finds every deque empty is done
+ */
+class work_stealing_pool
+{
+public:
+    class work_queue
+    {
+    public:
+        mutex lock;
+        deque<size_t> tasks;
+    };
+
+    vector<work_queue> queues;
+
+    work_stealing_pool(unsigned workers):queues(workers) {}
+
+    void push(unsigned worker,size_t task)
+    {
+        queues[worker].tasks.push_back(task);
+    }
+
+    bool pop(unsigned worker,size_t *task)
+    {
+        lock_guard<mutex> guard(queues[worker].lock);
+        if(queues[worker].tasks.empty())
+            return false;
+        *task=queues[worker].tasks.back();
+        queues[worker].tasks.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned thief,size_t *task)
+    {
+        for(unsigned i=1;i<queues.size();i++)
+        {
+            work_queue &victim=queues[(thief+i)%queues.size()];
+            lock_guard<mutex> guard(victim.lock);
+            if(!victim.tasks.empty())
+            {
+                *task=victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+/*
+ * Loads every distinct trace of the job list once, runs all jobs on a work-stealing pool
+ * and prints one table with a row per job in job-list order
+ * @params::job list,worker threads (0 is one per core),table file (NULL for stdout)
+ * @return exit status
+ */
+int run_batch(const char *job_file, unsigned threads, const char *output_file)
+{
+    vector<batch_job> jobs;
+    if(!parse_job_list(job_file,jobs))
+    {
+        return EXIT_FAILURE;
+    }
+
+    map<string,unsigned> trace_ids;
+    vector<vector<trace_record_t> > traces;
+    for(unsigned j=0;j<jobs.size();j++)
+    {
+        map<string,unsigned>::iterator known=trace_ids.find(jobs[j].trace_file);
+        if(known==trace_ids.end())
+        {
+            traces.push_back(vector<trace_record_t>());
+            if(!load_trace(jobs[j].trace_file.c_str(),traces.back()))
+            {
+                printf("Error: Unable to open file %s\n", jobs[j].trace_file.c_str());
+                return EXIT_FAILURE;
+            }
+            known=trace_ids.insert(make_pair(jobs[j].trace_file,(unsigned)traces.size()-1)).first;
+        }
+        jobs[j].trace_id=known->second;
+    }
+
+    if(threads==0)
+    {
+        threads=thread::hardware_concurrency();
+        if(threads==0)
+            threads=1;
+    }
+    if(threads>jobs.size() && !jobs.empty())
+    {
+        threads=jobs.size();
+    }
+    //jobs of one trace are dealt out round robin, so the longest traces do not pile up on one worker
+    work_stealing_pool pool(threads);
+    for(size_t j=0;j<jobs.size();j++)
+    {
+        pool.push(j%threads,j);
+    }
+    vector<batch_result> results(jobs.size());
+    vector<thread> workers;
+    for(unsigned w=0;w<threads;w++)
+    {
+        workers.push_back(thread([&pool,&jobs,&traces,&results,w]()
+        {
+            size_t task;
+            while(pool.pop(w,&task) || pool.steal(w,&task))
+            {
+                run_job(jobs[task],traces[jobs[task].trace_id],results[task]);
+            }
+        }));
+    }
+    for(unsigned w=0;w<workers.size();w++)
+    {
+        workers[w].join();
+    }
+
+    FILE *FP = stdout;
+    if(output_file != NULL)
+    {
+        FP = fopen(output_file, "w");
+        if(FP == NULL)
+        {
+            printf("Error: Unable to open file %s\n", output_file);
+            return EXIT_FAILURE;
+        }
+    }
+    fprintf(FP,"%-4s %-32s %-36s %10s %8s %10s %8s %10s %9s\n","job","trace","configuration","accesses",
+            "L1_miss","L1_wb","L2_miss","mem_traffic","seconds");
+    int status=0;
+    for(size_t j=0;j<jobs.size();j++)
+    {
+        batch_result &result=results[j];
+        if(!result.ok)
+        {
+            fprintf(FP,"%-4zu %-32s %-36s %10s\n",j,jobs[j].trace_file.c_str(),jobs[j].description.c_str(),"failed");
+            status=EXIT_FAILURE;
+            continue;
+        }
+        char l2_miss[16]="-";
+        if(result.l2_miss_rate>=0)
+        {
+            snprintf(l2_miss,sizeof(l2_miss),"%.4f",result.l2_miss_rate);
+        }
+        fprintf(FP,"%-4zu %-32s %-36s %10llu %8.4f %10lu %8s %10lu %9.3f\n",j,jobs[j].trace_file.c_str(),
+                jobs[j].description.c_str(),result.accesses,result.l1_miss_rate,result.l1_writebacks,l2_miss,
+                result.memory_traffic,result.seconds);
+    }
+    if(FP != stdout)
+    {
+        fclose(FP);
+    }
+    return status;
+}
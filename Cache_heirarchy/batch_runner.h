@@ -0,0 +1,43 @@
+//
+// Created by Sweta Subhra Datta
+//
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+#include <string>
+#include <vector>
+#include "cache_hierarchy.h"
+#include "trace.h"
+
+using namespace std;
+
+/*
+ * One line of a job list: a trace and the hierarchy to run it on
+ */
+class batch_job
+{
+public:
+    string trace_file;
+    string description;          //configuration as written in the job list
+    string config_file;          //set for --config=<file> jobs
+    vector<level_params> levels; //set for positional jobs
+    unsigned trace_id=0;         //index into the loaded traces
+};
+
+class batch_result
+{
+public:
+    bool ok=false;
+    unsigned long long accesses=0;
+    unsigned long l1_misses=0;          //L1 misses the victim cache did not satisfy
+    unsigned long l1_writebacks=0;
+    double l1_miss_rate=0;
+    double l2_miss_rate=-1;      //-1 when the hierarchy has a single level
+    unsigned long memory_traffic=0;
+    double seconds=0;
+};
+
+bool parse_job_list(const char *job_file,vector<batch_job> &jobs);
+int run_batch(const char *job_file,unsigned threads,const char *output_file);
+
+#endif //BATCH_RUNNER_H
@@ -0,0 +1,268 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "cache_hierarchy.h"
+#include "workload_gen.h"
+#include "trace.h"
+
+using namespace std;
+
+/*
+ * Throughput benchmark of the cache library.
+ *   cache_bench [--traces=<dir>] [--min-accesses=N] [--synthetic-accesses=N] [--output=file]
+ * Every workload is replayed from memory through the L1, L1+VC and L1+L2 paths at a few
+ * geometries. Each run happens in its own child process, which holds only its workload and
+ * its hierarchy, so the peak RSS reported is that of the run. The memory the hierarchy
+ * itself allocates is reported apart, it is small next to a workload. Results go out as JSON so
+ * runs of different versions can be compared
+ */
+
+typedef struct bench_geometry
+{
+    const char *path;
+    unsigned long l1_size;
+    unsigned long l1_assoc;
+    unsigned long block_size;
+    unsigned long vc_num_blocks;
+    unsigned long l2_size;
+    unsigned long l2_assoc;
+}bench_geometry_t;
+
+static const bench_geometry_t geometries[]=
+{
+    {"L1",    1024,  2, 32, 0,  0,      0},
+    {"L1",    32768, 8, 64, 0,  0,      0},
+    {"L1+VC", 1024,  2, 32, 16, 0,      0},
+    {"L1+VC", 32768, 8, 64, 16, 0,      0},
+    {"L1+L2", 1024,  2, 32, 0,  65536,  8},
+    {"L1+L2", 32768, 8, 64, 0,  262144, 8},
+};
+
+static const char *bundled_traces[]={"gcc","go","perl","vortex","compress"};
+static const char *synthetic_mixes[]={"stream:1:4M","zipf:1:64M","chase:1:16M","uniform:1:16M"};
+
+//what a child process sends back to the parent
+typedef struct bench_result
+{
+    unsigned long long accesses;
+    double seconds;
+    double miss_rate;
+    unsigned long hierarchy_bytes;
+}bench_result_t;
+
+/*
+ * Builds the hierarchy of one geometry the same way main.cpp does for the positional arguments
+ */
+static void build_hierarchy(cache_hierarchy &hierarchy, const bench_geometry_t &geometry)
+{
+    level_params l1_config;
+    l1_config.name="L1";
+    l1_config.size=geometry.l1_size;
+    l1_config.assoc=geometry.l1_assoc;
+    l1_config.block_size=geometry.block_size;
+    l1_config.vc_num_blocks=geometry.vc_num_blocks;
+    if(geometry.l2_size!=0)
+    {
+        level_params l2_config;
+        l2_config.name="L2";
+        l2_config.size=geometry.l2_size;
+        l2_config.assoc=geometry.l2_assoc;
+        l2_config.block_size=geometry.block_size;
+        l1_config.next="L2";
+        hierarchy.add_level(l1_config);
+        hierarchy.add_level(l2_config);
+    }
+    else
+    {
+        hierarchy.add_level(l1_config);
+    }
+    hierarchy.link();
+}
+
+/*
+ * Reads a bundled trace or generates a synthetic mix
+ * @return false if the trace cannot be read
+ */
+static bool load_workload(const string &trace_file, const char *mix, unsigned long long synthetic_accesses,
+                          vector<trace_record_t> &records)
+{
+    if(mix==NULL)
+    {
+        return load_trace(trace_file.c_str(),records) && !records.empty();
+    }
+    workload_params params;
+    params.accesses=synthetic_accesses;
+    parse_pattern_mix(mix,&params);
+    workload_gen generator(params);
+    records.resize(params.accesses);
+    for(unsigned long long i=0;i<params.accesses;i++)
+    {
+        generator.next(&records[i].rw,&records[i].address);
+    }
+    return true;
+}
+
+/*
+ * Child side of one run. The workload is materialised before the clock starts, so parsing and
+ * generation stay out of the timed loop
+ */
+static bool run_geometry(const string &trace_file, const char *mix, unsigned long long synthetic_accesses,
+                         unsigned long long min_accesses, const bench_geometry_t &geometry, bench_result_t *result)
+{
+    vector<trace_record_t> records;
+    if(!load_workload(trace_file,mix,synthetic_accesses,records))
+    {
+        return false;
+    }
+    //short traces are replayed until the run is long enough to time
+    unsigned long long passes=(min_accesses+records.size()-1)/records.size();
+    cache_hierarchy hierarchy;
+    build_hierarchy(hierarchy,geometry);
+    chrono::steady_clock::time_point start=chrono::steady_clock::now();
+    for(unsigned long long pass=0;pass<passes;pass++)
+    {
+        for(size_t i=0;i<records.size();i++)
+        {
+            hierarchy.access(hierarchy.data_entry,records[i].address,records[i].rw=='w');
+        }
+    }
+    result->seconds=chrono::duration<double>(chrono::steady_clock::now()-start).count();
+    result->accesses=passes*records.size();
+    result->hierarchy_bytes=hierarchy.footprint_bytes();
+    cache_sim *L1=hierarchy.levels[0]->cache;
+    //a miss the victim cache satisfied never left L1, as in the batch and positional L1+VC rates
+    result->miss_rate=(double)(L1->L1_read_misses+L1->L1_writes_misses-L1->swaps)/(double)(L1->L1_reads+L1->L1_writes);
+    return true;
+}
+
+/*
+ * Runs one geometry in a child process
+ * @return false if the child could not run it, "peak_rss_kb" gets the peak resident set of the child
+ */
+static bool fork_geometry(const string &trace_file, const char *mix, unsigned long long synthetic_accesses,
+                          unsigned long long min_accesses, const bench_geometry_t &geometry, bench_result_t *result,
+                          long *peak_rss_kb)
+{
+    int channel[2];
+    if(pipe(channel)!=0)
+    {
+        return false;
+    }
+    fflush(NULL);
+    pid_t child=fork();
+    if(child<0)
+    {
+        close(channel[0]);
+        close(channel[1]);
+        return false;
+    }
+    if(child==0)
+    {
+        close(channel[0]);
+        bench_result_t measured;
+        bool ok=run_geometry(trace_file,mix,synthetic_accesses,min_accesses,geometry,&measured) &&
+                write(channel[1],&measured,sizeof(measured))==(ssize_t)sizeof(measured);
+        _exit(ok?EXIT_SUCCESS:EXIT_FAILURE);
+    }
+    close(channel[1]);
+    bool received=read(channel[0],result,sizeof(*result))==(ssize_t)sizeof(*result);
+    close(channel[0]);
+    int status;
+    struct rusage usage;
+    if(wait4(child,&status,0,&usage)!=child || !WIFEXITED(status) || WEXITSTATUS(status)!=EXIT_SUCCESS)
+    {
+        return false;
+    }
+    *peak_rss_kb=usage.ru_maxrss;
+    return received;
+}
+
+int main(int argc,char* argv[])
+{
+    string trace_dir="traces";
+    unsigned long long min_accesses=2000000;
+    unsigned long long synthetic_accesses=4000000;
+    const char *output_file=NULL;
+    for(int arg=1;arg<argc;arg++)
+    {
+        if(strncmp(argv[arg],"--traces=",9)==0)
+            trace_dir=argv[arg]+9;
+        else if(strncmp(argv[arg],"--min-accesses=",15)==0)
+            min_accesses=strtoull(argv[arg]+15,NULL,10);
+        else if(strncmp(argv[arg],"--synthetic-accesses=",21)==0)
+            synthetic_accesses=strtoull(argv[arg]+21,NULL,10);
+        else if(strncmp(argv[arg],"--output=",9)==0)
+            output_file=argv[arg]+9;
+        else
+        {
+            printf("Error: Unknown option %s\n", argv[arg]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    //the parent only lists the workloads, every child loads its own
+    vector<string> workload_names;
+    vector<string> trace_files;
+    vector<const char *> mixes;
+    for(unsigned t=0;t<sizeof(bundled_traces)/sizeof(bundled_traces[0]);t++)
+    {
+        workload_names.push_back(bundled_traces[t]);
+        trace_files.push_back(trace_dir+"/"+bundled_traces[t]+"_trace.txt");
+        mixes.push_back(NULL);
+    }
+    for(unsigned m=0;m<sizeof(synthetic_mixes)/sizeof(synthetic_mixes[0]);m++)
+    {
+        workload_names.push_back(string("synthetic-")+synthetic_mixes[m]);
+        trace_files.push_back("");
+        mixes.push_back(synthetic_mixes[m]);
+    }
+
+    FILE *FP = stdout;
+    if(output_file != NULL)
+    {
+        FP = fopen(output_file, "w");
+        if(FP == NULL)
+        {
+            printf("Error: Unable to open file %s\n", output_file);
+            exit(EXIT_FAILURE);
+        }
+    }
+    fprintf(FP,"{\n  \"benchmark\": \"cache_bench\",\n  \"results\": [");
+    bool first=true;
+    for(unsigned w=0;w<workload_names.size();w++)
+    {
+        for(unsigned g=0;g<sizeof(geometries)/sizeof(geometries[0]);g++)
+        {
+            const bench_geometry_t &geometry=geometries[g];
+            bench_result_t result;
+            long peak_rss_kb=0;
+            if(!fork_geometry(trace_files[w],mixes[w],synthetic_accesses,min_accesses,geometry,&result,&peak_rss_kb))
+            {
+                fprintf(stderr,"Warning: skipping %s\n", workload_names[w].c_str());
+                break;
+            }
+            fprintf(FP,"%s\n    {\"workload\": \"%s\", \"path\": \"%s\", \"l1_size\": %lu, \"l1_assoc\": %lu, "
+                       "\"block_size\": %lu, \"vc_num_blocks\": %lu, \"l2_size\": %lu, \"l2_assoc\": %lu, "
+                       "\"accesses\": %llu, \"seconds\": %.6f, \"accesses_per_second\": %.0f, \"ns_per_access\": %.3f, "
+                       "\"l1_miss_rate\": %.4f, \"peak_rss_kb\": %ld, \"hierarchy_kb\": %.1f}",
+                    first?"":",", workload_names[w].c_str(), geometry.path, geometry.l1_size, geometry.l1_assoc,
+                    geometry.block_size, geometry.vc_num_blocks, geometry.l2_size, geometry.l2_assoc,
+                    result.accesses, result.seconds, result.accesses/result.seconds, result.seconds*1e9/result.accesses,
+                    result.miss_rate, peak_rss_kb, result.hierarchy_bytes/1024.0);
+            fflush(FP);
+            first=false;
+        }
+    }
+    fprintf(FP,"\n  ]\n}\n");
+    if(FP != stdout)
+    {
+        fclose(FP);
+    }
+    return 0;
+}
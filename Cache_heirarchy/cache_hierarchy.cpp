@@ -0,0 +1,696 @@
+//
+// Created by Sweta Subhra Datta
+//
+#include "cache_hierarchy.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace std;
+
+static const char *index_policy_names[4]={"modulo","xor","prime","skewed"};
+static const char *inclusion_names[3]={"nine","inclusive","exclusive"};
+
+/*
+ * Maps the name used on the command line and in configuration files to an index policy
+ * @return false if the name is unknown
+ */
+bool parse_index_policy(const char *name, index_policy_t *policy)
+{
+    for(unsigned i=0;i<4;i++)
+    {
+        if(strcmp(name,index_policy_names[i])==0)
+        {
+            *policy=(index_policy_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Parses "evict", "bypass" or "off", optionally followed by ":<log2 region size>"
+ * @return false if the text is malformed
+ */
+bool parse_dead_block_policy(const char *name, dead_block_policy_t *policy, unsigned *region_bits)
+{
+    char mode[16];
+    unsigned bits=*region_bits;
+    if(sscanf(name,"%15[a-z]:%u",mode,&bits)<1 || bits==0 || bits>=64)
+    {
+        return false;
+    }
+    if(strcmp(mode,"off")==0)
+        *policy=DEAD_BLOCK_OFF;
+    else if(strcmp(mode,"evict")==0)
+        *policy=DEAD_BLOCK_EVICT;
+    else if(strcmp(mode,"bypass")==0)
+        *policy=DEAD_BLOCK_BYPASS;
+    else
+        return false;
+    *region_bits=bits;
+    return true;
+}
+
+cache_level::cache_level(const level_params &level_config)
+{
+    params=level_config;
+    cache=NULL;
+}
+
+/*
+ * Builds the cache_sim of the level. cache_sim divides by the geometry,
+ * so link() calls this only after checking it
+ */
+void cache_level::build()
+{
+    cache=new cache_sim(params.assoc,params.size,params.block_size,params.vc_num_blocks);
+    cache->set_index_policy(params.index_policy,params.size,params.assoc,params.block_size);
+    cache->set_dead_block_predictor(params.dead_block_policy,params.dead_block_region_bits);
+}
+
+cache_level::~cache_level()
+{
+    delete cache;
+}
+
+cache_hierarchy::~cache_hierarchy()
+{
+    for(unsigned i=0;i<levels.size();i++)
+    {
+        delete levels[i];
+    }
+}
+
+/*
+ * Reads a hierarchy description, one directive per line, '#' starts a comment:
+ *   level <name> <size> <assoc> <block_size> [vc=<blocks>] [index=modulo|xor|prime|skewed]
+ *         [inclusion=nine|inclusive|exclusive] [deadblock=evict|bypass[:<region bits>]] [latency=<cycles>]
+ *         [next=<level>|memory]
+ *   data <level>     level the trace accesses go to (default: the first level)
+ *   instr <level>    level instruction fetches go to (default: the data level)
+ *   memory <cycles>  latency of main memory for timed accesses (default: 100)
+ * @return false after printing the error if the file is malformed
+ */
+bool cache_hierarchy::load_config(const char *config_file)
+{
+    ifstream config(config_file);
+    if(!config.is_open())
+    {
+        printf("Error: Unable to open file %s\n", config_file);
+        return false;
+    }
+    string line;
+    unsigned line_no=0;
+    while(getline(config,line))
+    {
+        line_no++;
+        size_t comment=line.find('#');
+        if(comment!=string::npos)
+        {
+            line.erase(comment);
+        }
+        istringstream fields(line);
+        string directive;
+        if(!(fields>>directive))
+        {
+            continue;
+        }
+        if(directive=="data")
+        {
+            fields>>data_entry_name;
+        }
+        else if(directive=="instr")
+        {
+            fields>>instr_entry_name;
+        }
+        else if(directive=="memory")
+        {
+            if(!(fields>>memory_latency))
+            {
+                printf("Error: %s:%u: expected memory <cycles>\n", config_file, line_no);
+                return false;
+            }
+        }
+        else if(directive=="level")
+        {
+            level_params level_config;
+            if(!(fields>>level_config.name>>level_config.size>>level_config.assoc>>level_config.block_size))
+            {
+                printf("Error: %s:%u: expected level <name> <size> <assoc> <block_size>\n", config_file, line_no);
+                return false;
+            }
+            string option;
+            while(fields>>option)
+            {
+                size_t eq=option.find('=');
+                string key=option.substr(0,eq);
+                string value=(eq==string::npos)?"":option.substr(eq+1);
+                bool ok=true;
+                if(key=="vc")
+                    level_config.vc_num_blocks=strtoul(value.c_str(),NULL,10);
+                else if(key=="index")
+                    ok=parse_index_policy(value.c_str(),&level_config.index_policy);
+                else if(key=="inclusion" && value=="nine")
+                    level_config.inclusion=INCLUSION_NINE;
+                else if(key=="inclusion" && value=="inclusive")
+                    level_config.inclusion=INCLUSION_INCLUSIVE;
+                else if(key=="inclusion" && value=="exclusive")
+                    level_config.inclusion=INCLUSION_EXCLUSIVE;
+                else if(key=="deadblock")
+                    ok=parse_dead_block_policy(value.c_str(),&level_config.dead_block_policy,&level_config.dead_block_region_bits);
+                else if(key=="latency" && !value.empty())
+                    level_config.latency=strtoul(value.c_str(),NULL,10);
+                else if(key=="next" && !value.empty())
+                    level_config.next=value;
+                else
+                    ok=false;
+                if(!ok)
+                {
+                    printf("Error: %s:%u: bad level option %s\n", config_file, line_no, option.c_str());
+                    return false;
+                }
+            }
+            add_level(level_config);
+        }
+        else
+        {
+            printf("Error: %s:%u: unknown directive %s\n", config_file, line_no, directive.c_str());
+            return false;
+        }
+    }
+    return link();
+}
+
+void cache_hierarchy::add_level(const level_params &params)
+{
+    levels.push_back(new cache_level(params));
+}
+
+cache_level *cache_hierarchy::find_level(const string &name)
+{
+    for(unsigned i=0;i<levels.size();i++)
+    {
+        if(levels[i]->params.name==name)
+        {
+            return levels[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Checks the geometry of every level before building its cache, resolves the next-level names,
+ * fills in the upper links and checks the chain can be simulated
+ * @return false after printing the error if it cannot
+ */
+bool cache_hierarchy::link()
+{
+    if(levels.empty())
+    {
+        printf("Error: The hierarchy has no levels\n");
+        return false;
+    }
+    for(unsigned i=0;i<levels.size();i++)
+    {
+        level_params &params=levels[i]->params;
+        unsigned long sets=(params.assoc*params.block_size==0)?0:params.size/(params.assoc*params.block_size);
+        if(sets==0 || (sets&(sets-1))!=0 || (params.block_size&(params.block_size-1))!=0)
+        {
+            printf("Error: Level %s needs a power of two number of sets and block size\n", params.name.c_str());
+            return false;
+        }
+        if(params.dead_block_policy!=DEAD_BLOCK_OFF && params.vc_num_blocks!=0)
+        {
+            printf("Error: Level %s cannot combine dead-block prediction with a VC\n", params.name.c_str());
+            return false;
+        }
+        if(levels[i]->cache==NULL)
+        {
+            levels[i]->build();
+        }
+        if(params.next=="memory")
+        {
+            continue;
+        }
+        levels[i]->next=find_level(params.next);
+        if(levels[i]->next==NULL || levels[i]->next==levels[i])
+        {
+            printf("Error: Level %s has a bad next level %s\n", params.name.c_str(), params.next.c_str());
+            return false;
+        }
+        levels[i]->next->upper.push_back(levels[i]);
+        //back-invalidation and victim fills work on whole blocks of the lower level
+        if(levels[i]->next->params.block_size<params.block_size)
+        {
+            printf("Error: Level %s has smaller blocks than level %s above it\n",
+                   params.next.c_str(), params.name.c_str());
+            return false;
+        }
+    }
+    for(unsigned i=0;i<levels.size();i++)
+    {
+        //a chain longer than the number of levels has to revisit one of them
+        cache_level *level=levels[i];
+        for(unsigned depth=0;level!=NULL;depth++,level=level->next)
+        {
+            if(depth>levels.size())
+            {
+                printf("Error: Level %s is part of a cycle\n", levels[i]->params.name.c_str());
+                return false;
+            }
+        }
+    }
+    data_entry=data_entry_name.empty()?levels[0]:find_level(data_entry_name);
+    instr_entry=instr_entry_name.empty()?data_entry:find_level(instr_entry_name);
+    if(data_entry==NULL || instr_entry==NULL)
+    {
+        printf("Error: Unknown entry level %s\n", data_entry==NULL?data_entry_name.c_str():instr_entry_name.c_str());
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Reads or writes one address at "level", pulling the block from below on a miss and
+ * sending the block it displaced down
+ * @params::level,address,true for a write
+ * @return true if the level (L1 part or VC) held the block
+ */
+bool cache_hierarchy::access(cache_level *level, unsigned long address, bool is_write)
+{
+    cache_sim *cache=level->cache;
+    level_params &params=level->params;
+    bool hit;
+    bool present;
+    if(params.vc_num_blocks==0)
+    {
+        hit_miss_policy_t status=is_write?cache->write_Cache(address,params.size,params.assoc,params.block_size)
+                                         :cache->read_Cache(address,params.size,params.assoc,params.block_size);
+        hit=(status==HIT);
+        present=hit;
+    }
+    else
+    {
+        hit_miss_policy_L1V status_v=is_write?cache->L1_Victim_write_cache(address,params.size,params.assoc,params.block_size)
+                                             :cache->L1_Victim_read_cache(address,params.size,params.assoc,params.block_size);
+        hit=(status_v==R_L1_HIT || status_v==W_L1_HIT);
+        present=hit || status_v==R_L1_MISS_BUT_VICTIM_HIT_SWAPPED || status_v==W_L1_MISS_BUT_VICTIM_HIT_SWAPPED;
+    }
+    if(is_write)
+    {
+        cache->L1_writes++;
+        if(!hit)
+            cache->L1_writes_misses++;
+    }
+    else
+    {
+        cache->L1_reads++;
+        if(!hit)
+            cache->L1_read_misses++;
+    }
+    //a miss the victim cache satisfied swapped the two blocks instead of going below
+    if(present && !hit)
+        cache->swaps++;
+    cache->lru_counter++;
+
+    //take the victim out before the levels below run
+    bool evicted=cache->evicted_valid;
+    unsigned long evicted_address=cache->evicted_address;
+    bool evicted_dirty=(cache->evicted_dirty==1);
+    //writebacks and write-arounds reach the levels below too, only demand fetches choose the supplier
+    cache_level *demand_supplier=supplier;
+    if(cache->bypassed && is_write)
+    {
+        //write-around, nothing was allocated so nothing is fetched
+        write_around(level,address);
+        supplier=demand_supplier;
+    }
+    else if(!present)
+    {
+        fetch(level,address);
+        demand_supplier=supplier;
+    }
+    if(evicted)
+    {
+        evict(level,evicted_address,evicted_dirty);
+        supplier=demand_supplier;
+    }
+    return present;
+}
+
+/*
+ * Brings the block "level" just allocated from the first level below that has it.
+ * Exclusive levels hand the block up and drop their copy, the others are read normally
+ */
+void cache_hierarchy::fetch(cache_level *level, unsigned long address)
+{
+    stream_out(level,'r',address);
+    cache_level *below=level->next;
+    while(below!=NULL && below->params.inclusion==INCLUSION_EXCLUSIVE)
+    {
+        level_params &params=below->params;
+        unsigned was_dirty=0;
+        below->cache->L1_reads++;
+        if(below->cache->invalidate_block(address,params.size,params.assoc,params.block_size,&was_dirty))
+        {
+            if(was_dirty==1 && !level->cache->mark_dirty(address,level->params.size,level->params.assoc,level->params.block_size))
+            {
+                //the block bypassed the level above, keep the modified copy here
+                install(below,address,true);
+            }
+            supplier=below;
+            return;
+        }
+        below->cache->L1_read_misses++;
+        //exclusive levels do not allocate on a miss, keep looking further down
+        below=below->next;
+    }
+    if(below==NULL)
+    {
+        memory_reads++;
+        supplier=NULL;
+        return;
+    }
+    //a hit there ends the search, a miss fetches further down and moves the supplier again
+    supplier=below;
+    access(below,address,false);
+}
+
+/*
+ * Sends a block displaced from "level" down the hierarchy
+ * @params::level,block address,dirty bit of the block
+ */
+void cache_hierarchy::evict(cache_level *level, unsigned long address, bool dirty)
+{
+    if(level->params.inclusion==INCLUSION_INCLUSIVE)
+    {
+        //copies above may be newer, in which case this eviction carries their data
+        if(back_invalidate(level,address,level->params.block_size))
+        {
+            dirty=true;
+        }
+    }
+    if(dirty)
+    {
+        level->writebacks++;
+        stream_out(level,'w',address);
+    }
+    cache_level *below=level->next;
+    if(below==NULL)
+    {
+        if(dirty)
+            memory_writes++;
+        return;
+    }
+    if(below->params.inclusion==INCLUSION_EXCLUSIVE)
+    {
+        //exclusive levels are filled with every victim, clean or dirty
+        install(below,address,dirty);
+        return;
+    }
+    if(dirty)
+    {
+        access(below,address,true);
+    }
+}
+
+/*
+ * Sends a write that bypassed "level" to the level below it
+ */
+void cache_hierarchy::write_around(cache_level *level, unsigned long address)
+{
+    stream_out(level,'w',address);
+    cache_level *below=level->next;
+    if(below==NULL)
+        memory_writes++;
+    else if(below->params.inclusion==INCLUSION_EXCLUSIVE)
+        install(below,address,true);
+    else
+        access(below,address,true);
+}
+
+/*
+ * Places a victim from the level above into an exclusive level, nothing is read from below
+ */
+void cache_hierarchy::install(cache_level *level, unsigned long address, bool dirty)
+{
+    cache_sim *cache=level->cache;
+    level_params &params=level->params;
+    level->victim_fills++;
+    if(params.vc_num_blocks==0)
+    {
+        if(dirty)
+            cache->write_Cache(address,params.size,params.assoc,params.block_size);
+        else
+            cache->read_Cache(address,params.size,params.assoc,params.block_size);
+    }
+    else
+    {
+        if(dirty)
+            cache->L1_Victim_write_cache(address,params.size,params.assoc,params.block_size);
+        else
+            cache->L1_Victim_read_cache(address,params.size,params.assoc,params.block_size);
+    }
+    cache->lru_counter++;
+    if(cache->evicted_valid)
+    {
+        evict(level,cache->evicted_address,cache->evicted_dirty==1);
+    }
+}
+
+/*
+ * Removes every copy of [address,address+span) from the levels above "level"
+ * @return true if one of the dropped copies was dirty
+ */
+bool cache_hierarchy::back_invalidate(cache_level *level, unsigned long address, unsigned long span)
+{
+    bool dirty=false;
+    for(unsigned i=0;i<level->upper.size();i++)
+    {
+        cache_level *upper=level->upper[i];
+        level_params &params=upper->params;
+        for(unsigned long block=address;block<address+span;block+=params.block_size)
+        {
+            unsigned was_dirty=0;
+            if(upper->cache->invalidate_block(block,params.size,params.assoc,params.block_size,&was_dirty))
+            {
+                level->back_invalidations++;
+                if(was_dirty==1)
+                    dirty=true;
+            }
+        }
+        //a non-inclusive level in between does not stop copies further up
+        if(back_invalidate(upper,address,span))
+        {
+            dirty=true;
+        }
+    }
+    return dirty;
+}
+
+/*
+ * Zeroes the statistics of every level and of memory, the cache contents stay warm
+ */
+void cache_hierarchy::clear_stats()
+{
+    for(unsigned i=0;i<levels.size();i++)
+    {
+        levels[i]->cache->clear_stats();
+        levels[i]->writebacks=0;
+        levels[i]->victim_fills=0;
+        levels[i]->back_invalidations=0;
+        levels[i]->supplied=0;
+    }
+    timed_accesses=0;
+    timed_cycles=0;
+    timed_memory_accesses=0;
+    memory_reads=0;
+    memory_writes=0;
+    instruction_fetches=0;
+    instruction_fetch_misses=0;
+    instruction_memory_reads=0;
+}
+
+/*
+ * @return bytes of simulator state held by every level
+ */
+unsigned long cache_hierarchy::footprint_bytes()
+{
+    unsigned long bytes=0;
+    for(unsigned i=0;i<levels.size();i++)
+    {
+        bytes+=sizeof(cache_level)+levels[i]->cache->footprint_bytes();
+    }
+    return bytes;
+}
+
+/*
+ * Copies every read and writeback "level" sends down to "stream" as "r|w <hex block address> <record index>".
+ * Replaying the stream on a configuration that starts at the next level reproduces that level's
+ * statistics for NINE hierarchies, clean victims of exclusive levels are not part of it
+ */
+void cache_hierarchy::export_stream(FILE *stream, cache_level *level)
+{
+    miss_stream=stream;
+    miss_stream_level=level;
+    //miss streams can be long, write them in large chunks
+    setvbuf(stream,NULL,_IOFBF,1<<20);
+}
+
+void cache_hierarchy::stream_out(cache_level *level, char rw, unsigned long address)
+{
+    if(level!=miss_stream_level || miss_stream==NULL)
+    {
+        return;
+    }
+    fprintf(miss_stream,"%c %lx %llu\n",rw,address&~(level->params.block_size-1),record_index);
+}
+
+void cache_hierarchy::print_config(const char *trace_file)
+{
+    printf("===== Simulator configuration =====\n");
+    for(unsigned i=0;i<levels.size();i++)
+    {
+        level_params &params=levels[i]->params;
+        printf("%-8s size %lu, assoc %lu, block %lu, vc %lu, index %s, inclusion %s, next %s\n",
+               params.name.c_str(), params.size, params.assoc, params.block_size, params.vc_num_blocks,
+               index_policy_names[params.index_policy], inclusion_names[params.inclusion], params.next.c_str());
+    }
+    printf("data:    %s\n", data_entry->params.name.c_str());
+    printf("instr:   %s\n", instr_entry->params.name.c_str());
+    printf("trace_file: %s\n", trace_file);
+    printf("===================================\n\n");
+}
+
+/*
+ * Fetch of an 'i' trace record. It enters at instr_entry and shares every level below it with the data side
+ * @return true if instr_entry held the block
+ */
+bool cache_hierarchy::instruction_fetch(unsigned long address)
+{
+    unsigned long reads_before=memory_reads;
+    bool present=access(instr_entry,address,false);
+    instruction_fetches++;
+    if(!present)
+    {
+        instruction_fetch_misses++;
+        instruction_memory_reads+=memory_reads-reads_before;
+    }
+    return present;
+}
+
+/*
+ * Data access of a pipeline's load or store. Every level it looks in on the way down to the one
+ * that holds the block adds its latency, main memory adds memory_latency when none does
+ * @return cycles until the block is available
+ */
+unsigned cache_hierarchy::timed_access(unsigned long address, bool is_write)
+{
+    supplier=data_entry;
+    access(data_entry,address,is_write);
+    unsigned cycles=0;
+    for(cache_level *level=data_entry;level!=NULL;level=level->next)
+    {
+        cycles+=level->params.latency;
+        if(level==supplier)
+        {
+            break;
+        }
+    }
+    if(supplier==NULL)
+    {
+        cycles+=memory_latency;
+        timed_memory_accesses++;
+    }
+    else
+    {
+        supplier->supplied++;
+    }
+    timed_accesses++;
+    timed_cycles+=cycles;
+    return cycles;
+}
+
+/*
+ * Where the timed accesses were served and what they cost on average
+ */
+void cache_hierarchy::print_timing_stats()
+{
+    cout<<"===== Access timing ====="<<endl;
+    cout<<"a. number of timed accesses: "<<dec<<timed_accesses<<endl;
+    for(unsigned i=0;i<levels.size();i++)
+    {
+        if(levels[i]->supplied!=0)
+        {
+            cout<<"   served by "<<levels[i]->params.name<<" ("<<levels[i]->params.latency<<" cycles): "<<dec<<levels[i]->supplied<<endl;
+        }
+    }
+    cout<<"   served by memory ("<<memory_latency<<" cycles): "<<dec<<timed_memory_accesses<<endl;
+    printf("b. average access latency: ");
+    printf("%.4f",timed_accesses==0?0.0:(double)timed_cycles/(double)timed_accesses);
+    cout<<"\n";
+}
+
+/*
+ * Front-end view: every fetch miss stalls fetch, the ones served by memory stall it longest
+ */
+void cache_hierarchy::print_instruction_stats()
+{
+    cout<<"===== Instruction fetch ("<<instr_entry->params.name<<") ====="<<endl;
+    cout<<"a. number of fetches: "<<dec<<instruction_fetches<<endl;
+    cout<<"b. number of fetch misses: "<<dec<<instruction_fetch_misses<<endl;
+    printf("c. fetch miss rate: ");
+    printf("%.4f",instruction_fetches==0?0.0:(double)instruction_fetch_misses/(double)instruction_fetches);
+    cout<<"\n";
+    cout<<"d. number of fetches served by memory: "<<dec<<instruction_memory_reads<<endl;
+    cout<<"\n";
+}
+
+void cache_hierarchy::print_stats()
+{
+    for(unsigned i=0;i<levels.size();i++)
+    {
+        cache_sim *cache=levels[i]->cache;
+        unsigned long accesses=cache->L1_reads+cache->L1_writes;
+        cout<<"===== "<<levels[i]->params.name<<" results ====="<<endl;
+        cout<<"a. number of reads: "<<dec<<cache->L1_reads<<endl;
+        cout<<"b. number of read misses: "<<dec<<cache->L1_read_misses<<endl;
+        cout<<"c. number of writes: "<<dec<<cache->L1_writes<<endl;
+        cout<<"d. number of write misses: "<<dec<<cache->L1_writes_misses<<endl;
+        printf("e. miss rate: ");
+        printf("%.4f",accesses==0?0.0:(double)(cache->L1_read_misses+cache->L1_writes_misses)/(double)accesses);
+        cout<<"\n";
+        cout<<"f. number of swap requests: "<<dec<<cache->swap_requests<<endl;
+        if(levels[i]->params.vc_num_blocks!=0)
+        {
+            cout<<"   number of swaps: "<<dec<<cache->swaps<<endl;
+            printf("   combined L1+VC miss rate: ");
+            printf("%.4f",accesses==0?0.0:(double)(cache->L1_read_misses+cache->L1_writes_misses-cache->swaps)/(double)accesses);
+            cout<<"\n";
+        }
+        cout<<"g. number of writebacks: "<<dec<<levels[i]->writebacks<<endl;
+        cout<<"h. number of victim fills: "<<dec<<levels[i]->victim_fills<<endl;
+        cout<<"i. number of back-invalidations: "<<dec<<levels[i]->back_invalidations<<endl;
+        if(levels[i]->params.dead_block_policy!=DEAD_BLOCK_OFF)
+        {
+            cache->print_dead_block_stats();
+        }
+        if(way_stats)
+        {
+            cache->print_way_prediction_stats();
+        }
+        cout<<"\n";
+    }
+    if(instruction_fetches!=0)
+    {
+        print_instruction_stats();
+    }
+    cout<<"===== Memory ====="<<endl;
+    cout<<"a. number of memory reads: "<<dec<<memory_reads<<endl;
+    cout<<"b. number of memory writes: "<<dec<<memory_writes<<endl;
+    cout<<"c. total memory traffic: "<<dec<<memory_reads+memory_writes<<endl;
+}
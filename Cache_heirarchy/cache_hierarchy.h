@@ -0,0 +1,115 @@
+//
+// Created by Sweta Subhra Datta
+//
+#ifndef CACHE_HIERARCHY_H
+#define CACHE_HIERARCHY_H
+
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include "sim_cache.h"
+
+using namespace std;
+
+/*
+ * Relation of a level to the levels that miss into it
+ */
+typedef enum
+{
+    INCLUSION_NINE,      //non-inclusive non-exclusive, nothing is enforced
+    INCLUSION_INCLUSIVE, //holds every block of the levels above, its evictions back-invalidate them
+    INCLUSION_EXCLUSIVE, //holds only blocks the levels above do not, filled with their victims
+
+}inclusion_policy_t;
+
+class level_params
+{
+public:
+    string name;
+    unsigned long int size=0;
+    unsigned long int assoc=1;
+    unsigned long int block_size=0;
+    unsigned long int vc_num_blocks=0;
+    index_policy_t index_policy=INDEX_MODULO;
+    inclusion_policy_t inclusion=INCLUSION_NINE;
+    dead_block_policy_t dead_block_policy=DEAD_BLOCK_OFF;
+    unsigned dead_block_region_bits=12;
+    unsigned latency=1;         //cycles to return a block this level holds, timed accesses only
+    string next="memory";
+};
+
+/*
+ * One cache of the hierarchy: a cache_sim, built by cache_hierarchy::link(), plus the links to its neighbours.
+ * The cache_sim counters (L1_reads, L1_read_misses, ...) count the accesses of this level
+ */
+class cache_level
+{
+public:
+    level_params params;
+    cache_sim *cache;
+    cache_level *next=NULL;     //NULL is main memory
+    vector<cache_level*> upper; //levels that miss into this one
+    unsigned long writebacks=0;
+    unsigned long victim_fills=0;
+    unsigned long back_invalidations=0;
+    unsigned long supplied=0;   //timed accesses this level supplied the block of
+
+    cache_level(const level_params &params);
+    ~cache_level();
+    void build();
+};
+
+/*
+ * Write-back, write-allocate hierarchy of any depth built from level_params,
+ * either from a configuration file or by the caller. Every topology runs through access()
+ */
+class cache_hierarchy
+{
+public:
+    vector<cache_level*> levels;
+    cache_level *data_entry=NULL;  //level the trace reads and writes go to
+    cache_level *instr_entry=NULL; //level instruction fetches go to
+    string data_entry_name;
+    string instr_entry_name;
+    unsigned long memory_reads=0;
+    unsigned long memory_writes=0;
+    unsigned long instruction_fetches=0;
+    unsigned long instruction_fetch_misses=0;  //fetches instr_entry did not hold
+    unsigned long instruction_memory_reads=0;  //fetches that went all the way to memory
+    unsigned long long record_index=0; //index of the trace record being simulated, set by the driver
+    FILE *miss_stream=NULL;            //requests leaving miss_stream_level are copied here
+    cache_level *miss_stream_level=NULL;
+    bool way_stats=false;              //print_stats() adds the way-predictor report of every level
+    unsigned memory_latency=100;       //cycles main memory adds to a timed access that misses every level
+    cache_level *supplier=NULL;        //level the last demand fetch was served by, NULL is main memory
+    unsigned long timed_accesses=0;
+    unsigned long timed_cycles=0;
+    unsigned long timed_memory_accesses=0;
+
+    ~cache_hierarchy();
+    bool load_config(const char *config_file);
+    void add_level(const level_params &params);
+    bool link();
+    cache_level *find_level(const string &name);
+    bool access(cache_level *level,unsigned long address,bool is_write);
+    bool instruction_fetch(unsigned long address);
+    unsigned timed_access(unsigned long address,bool is_write);
+    void fetch(cache_level *level,unsigned long address);
+    void evict(cache_level *level,unsigned long address,bool dirty);
+    void install(cache_level *level,unsigned long address,bool dirty);
+    void write_around(cache_level *level,unsigned long address);
+    bool back_invalidate(cache_level *level,unsigned long address,unsigned long span);
+    void clear_stats();
+    unsigned long footprint_bytes();
+    void export_stream(FILE *stream,cache_level *level);
+    void stream_out(cache_level *level,char rw,unsigned long address);
+    void print_config(const char *trace_file);
+    void print_stats();
+    void print_instruction_stats();
+    void print_timing_stats();
+};
+
+bool parse_index_policy(const char *name,index_policy_t *policy);
+bool parse_dead_block_policy(const char *name,dead_block_policy_t *policy,unsigned *region_bits);
+
+#endif //CACHE_HIERARCHY_H
@@ -0,0 +1,40 @@
+//
+// Created by Sweta Subhra Datta
+//
+#include "cache_memory.h"
+#include "cache_hierarchy.h"
+
+cache_memory::cache_memory()
+{
+    hierarchy=new cache_hierarchy();
+}
+
+cache_memory::~cache_memory()
+{
+    delete hierarchy;
+}
+
+/*
+ * Builds the hierarchy from a configuration file, see cache_hierarchy::load_config.
+ * The level latencies and the memory directive set the timing
+ * @return false after printing the error if the file is malformed
+ */
+bool cache_memory::load_config(const char *config_file)
+{
+    return hierarchy->load_config(config_file);
+}
+
+/*
+ * The first cycle of an access is the pipeline's own, a hit in a 1-cycle level adds nothing
+ */
+unsigned cache_memory::access(unsigned address, bool write)
+{
+    unsigned cycles=hierarchy->timed_access(address,write);
+    return cycles>0?cycles-1:0;
+}
+
+void cache_memory::print_stats()
+{
+    hierarchy->print_stats();
+    hierarchy->print_timing_stats();
+}
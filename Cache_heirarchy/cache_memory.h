@@ -0,0 +1,28 @@
+//
+// Created by Sweta Subhra Datta
+//
+#ifndef CACHE_MEMORY_H
+#define CACHE_MEMORY_H
+
+#include "memory_backend.h"
+
+class cache_hierarchy;
+
+/*
+ * Memory backend of the pipeline simulators timed by a cache hierarchy: each load or store goes
+ * through the hierarchy's data entry level and is as slow as the level that held the block.
+ * Only cache_hierarchy is forward declared, sim_cache.h and the simulators both define UNDEFINED
+ */
+class cache_memory : public memory_backend
+{
+public:
+    cache_hierarchy *hierarchy;
+
+    cache_memory();
+    ~cache_memory();
+    bool load_config(const char *config_file);
+    unsigned access(unsigned address,bool write);
+    void print_stats();
+};
+
+#endif //CACHE_MEMORY_H
@@ -0,0 +1,205 @@
+//
+// Created by Sweta Subhra Datta
+//
+#include "first_touch.h"
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include "math.h"
+
+using namespace std;
+
+/*
+ * Parses "exact" or "bloom[:<expected blocks>[:<false positive rate>]]"
+ * @return false if the text is malformed
+ */
+bool parse_first_touch(const char *text, first_touch_mode_t *mode, unsigned long long *capacity, double *target_error)
+{
+    char name[16];
+    int fields=sscanf(text,"%15[a-z]:%llu:%lf",name,capacity,target_error);
+    if(fields<1 || *target_error<=0 || *target_error>=1)
+    {
+        return false;
+    }
+    if(strcmp(name,"exact")==0)
+        *mode=FIRST_TOUCH_EXACT;
+    else if(strcmp(name,"bloom")==0)
+        *mode=FIRST_TOUCH_BLOOM;
+    else
+        return false;
+    return true;
+}
+
+/*
+ * Sizes the Bloom filter for "capacity" blocks at "target_error" false positives:
+ * m = -n ln(p) / ln(2)^2 cells and k = m/n ln(2) hashes
+ */
+first_touch_tracker::first_touch_tracker(first_touch_mode_t tracker_mode, unsigned long block_size,
+                                         unsigned long long expected_blocks, double error)
+{
+    mode=tracker_mode;
+    block_bits=log2(block_size);
+    capacity=expected_blocks;
+    target_error=error;
+    if(mode==FIRST_TOUCH_BLOOM)
+    {
+        num_cells=(unsigned long)ceil(-(double)capacity*log(target_error)/(log(2.0)*log(2.0)));
+        num_cells=(num_cells<64)?64:num_cells;
+        hashes=(unsigned)round((double)num_cells/(double)capacity*log(2.0));
+        hashes=(hashes<1)?1:hashes;
+        cells=vector<unsigned long long>((num_cells+63)/64,0);
+    }
+}
+
+/*
+ * Records one access of the measured trace
+ * @params::record index,address,true if the access missed the first data level
+ * @return true if the block was touched for the first time
+ */
+bool first_touch_tracker::observe(unsigned long long record_index, unsigned long address, bool missed)
+{
+    unsigned long block=address>>block_bits;
+    bool first=(mode==FIRST_TOUCH_EXACT)?touch_exact(block):touch_bloom(block);
+    if(first)
+    {
+        unique_blocks++;
+    }
+    if(missed)
+    {
+        misses++;
+        if(first)
+            cold_misses++;
+    }
+    if(record_index%sample_interval==0)
+    {
+        if(samples.size()==FIRST_TOUCH_MAX_SAMPLES)
+        {
+            //keep every other sample and sample half as often, the curve keeps its shape in constant memory
+            for(unsigned i=0;i<FIRST_TOUCH_MAX_SAMPLES/2;i++)
+            {
+                samples[i]=samples[2*i];
+            }
+            samples.resize(FIRST_TOUCH_MAX_SAMPLES/2);
+            sample_interval*=2;
+        }
+        if(record_index%sample_interval==0)
+        {
+            samples.push_back(make_pair(record_index,unique_blocks));
+        }
+    }
+    return first;
+}
+
+bool first_touch_tracker::touch_exact(unsigned long block)
+{
+    unsigned long page_number=block>>FIRST_TOUCH_PAGE_BITS;
+    if(last_page==NULL || page_number!=last_page_number)
+    {
+        vector<unsigned long long> &page=pages[page_number];
+        if(page.empty())
+        {
+            page=vector<unsigned long long>((1UL<<FIRST_TOUCH_PAGE_BITS)/64,0);
+        }
+        last_page=&page;
+        last_page_number=page_number;
+    }
+    unsigned long bit=block&((1UL<<FIRST_TOUCH_PAGE_BITS)-1);
+    unsigned long long mask=1ULL<<(bit%64);
+    if((*last_page)[bit/64]&mask)
+    {
+        return false;
+    }
+    (*last_page)[bit/64]|=mask;
+    return true;
+}
+
+/*
+ * Kirsch-Mitzenmacher double hashing: cell i of a block is h1+i*h2
+ */
+bool first_touch_tracker::touch_bloom(unsigned long block)
+{
+    unsigned long long h=block*0x9E3779B97F4A7C15ULL;
+    h^=h>>29;
+    unsigned long long h1=h*0xBF58476D1CE4E5B9ULL;
+    unsigned long long h2=(h^(h>>31))*0x94D049BB133111EBULL|1;
+    bool present=true;
+    for(unsigned i=0;i<hashes;i++)
+    {
+        unsigned long slot=(h1+i*h2)%num_cells;
+        unsigned long long mask=1ULL<<(slot%64);
+        if((cells[slot/64]&mask)==0)
+        {
+            present=false;
+            cells[slot/64]|=mask;
+        }
+    }
+    return !present;
+}
+
+/*
+ * @return expected false-positive rate for the blocks inserted so far, (1-e^(-kn/m))^k
+ */
+double first_touch_tracker::false_positive_rate()
+{
+    if(mode==FIRST_TOUCH_EXACT)
+    {
+        return 0;
+    }
+    return pow(1.0-exp(-(double)hashes*unique_blocks/(double)num_cells),hashes);
+}
+
+unsigned long first_touch_tracker::memory_bytes()
+{
+    if(mode==FIRST_TOUCH_BLOOM)
+    {
+        return cells.size()*sizeof(unsigned long long);
+    }
+    return pages.size()*((1UL<<FIRST_TOUCH_PAGE_BITS)/8);
+}
+
+/*
+ * Warm-up end: touched blocks stay known, only the miss counts start over
+ */
+void first_touch_tracker::clear_stats()
+{
+    cold_misses=0;
+    misses=0;
+}
+
+void first_touch_tracker::print_stats()
+{
+    cout<<"===== First-touch tracking ====="<<endl;
+    if(mode==FIRST_TOUCH_EXACT)
+    {
+        cout<<"mode: exact bitmap, "<<dec<<pages.size()<<" pages"<<endl;
+    }
+    else
+    {
+        cout<<"mode: Bloom filter, "<<dec<<num_cells<<" cells, "<<hashes<<" hashes, sized for "<<capacity<<" blocks"<<endl;
+    }
+    cout<<"a. number of unique blocks: "<<dec<<unique_blocks<<endl;
+    if(mode==FIRST_TOUCH_EXACT)
+    {
+        cout<<"b. footprint in bytes: "<<dec<<(unique_blocks<<block_bits)<<endl;
+    }
+    else
+    {
+        //a false positive hides a first touch, so both counts are lower bounds
+        cout<<"b. approximate footprint in bytes: "<<dec<<(unique_blocks<<block_bits);
+        printf(" (false-positive bound %.4f up to %llu blocks)",target_error,capacity);
+        cout<<"\n";
+    }
+    cout<<"c. number of cold misses: "<<dec<<cold_misses<<endl;
+    printf("d. cold share of misses: ");
+    printf("%.4f",misses==0?0.0:(double)cold_misses/(double)misses);
+    cout<<"\n";
+    printf("e. expected false-positive rate: ");
+    printf("%.4f",false_positive_rate());
+    cout<<"\n";
+    cout<<"f. tracker memory in bytes: "<<dec<<memory_bytes()<<endl;
+    cout<<"footprint over time (record, unique blocks):"<<endl;
+    for(unsigned i=0;i<samples.size();i++)
+    {
+        cout<<"  "<<dec<<samples[i].first<<" "<<samples[i].second<<endl;
+    }
+}
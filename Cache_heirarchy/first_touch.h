@@ -0,0 +1,61 @@
+//
+// Created by Sweta Subhra Datta
+//
+#ifndef FIRST_TOUCH_H
+#define FIRST_TOUCH_H
+
+#include <vector>
+#include <unordered_map>
+#include <stddef.h>
+
+using namespace std;
+
+typedef enum
+{
+    FIRST_TOUCH_EXACT, //two-level bitmap, one bit per block of the touched regions
+    FIRST_TOUCH_BLOOM, //Bloom filter of fixed size, first touches can be missed at a bounded rate
+
+}first_touch_mode_t;
+
+#define FIRST_TOUCH_PAGE_BITS 15      //blocks covered by one bitmap page (4KB of bits)
+#define FIRST_TOUCH_MAX_SAMPLES 64    //footprint samples kept, older ones are thinned out
+
+/*
+ * Decides whether a block is touched for the first time, for cold-miss and footprint statistics.
+ * Memory is bounded by the touched regions (exact) or fixed up front (Bloom)
+ */
+class first_touch_tracker
+{
+public:
+    first_touch_mode_t mode;
+    unsigned block_bits;
+    //exact mode: second level pages are allocated when a region is first touched
+    unordered_map<unsigned long,vector<unsigned long long> > pages;
+    unsigned long last_page_number=0;
+    vector<unsigned long long> *last_page=NULL;
+    //Bloom mode: one bit per cell, blocks are never removed so no cell needs a count
+    vector<unsigned long long> cells;
+    unsigned long num_cells=0;
+    unsigned hashes=0;
+    unsigned long long capacity=0;
+    double target_error=0;
+
+    unsigned long long unique_blocks=0;
+    unsigned long long cold_misses=0;
+    unsigned long long misses=0;
+    unsigned long long sample_interval=4096;
+    vector<pair<unsigned long long,unsigned long long> > samples;//(record index,unique blocks)
+
+    first_touch_tracker(first_touch_mode_t mode,unsigned long block_size,unsigned long long capacity,double target_error);
+    bool observe(unsigned long long record_index,unsigned long address,bool missed);
+    bool touch_exact(unsigned long block);
+    bool touch_bloom(unsigned long block);
+    double false_positive_rate();
+    unsigned long memory_bytes();
+    void clear_stats();
+    void print_stats();
+};
+
+bool parse_first_touch(const char *text,first_touch_mode_t *mode,unsigned long long *capacity,double *target_error);
+
+#endif //FIRST_TOUCH_H
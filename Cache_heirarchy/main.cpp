@@ -1,115 +1,425 @@
 #include <iostream>
 #include "sim_cache.h"
+#include "tlb_sim.h"
+#include "cache_hierarchy.h"
+#include "batch_runner.h"
+#include "trace.h"
+#include "first_touch.h"
+#include "region_stats.h"
+#include "workload_gen.h"
+#include <cstring>
 
 
 int main(int argc,char* argv[])
 {
-    FILE *FP;               // File handler
+    trace_reader reader;    // text or binary trace
     char *trace_file;       // Variable that holds trace file name;
     cache_params params;
     // look at sim_cache.h header file for the the definition of struct cache_params
     char rw;                // variable holds read/write type read from input file. The array size is 2 because it holds 'r' or 'w' and '\0'. Make sure to adapt in future projects
-    unsigned  addr; // Variable holds the address read from input file
+    unsigned long addr; // Variable holds the address read from input file (%lx needs a long)
 
 
 
-    // strtoul() converts char* to unsigned long. It is included in <stdlib.h>
-    params.block_size       = strtoul(argv[1], NULL, 10);
-    params.l1_size          = strtoul(argv[2], NULL, 10);
-    params.l1_assoc         = strtoul(argv[3], NULL, 10);
-    params.vc_num_blocks    = strtoul(argv[4], NULL, 10);
-    params.l2_size          = strtoul(argv[5], NULL, 10);
-    params.l2_assoc         = strtoul(argv[6], NULL, 10);
-    trace_file              = argv[7];
-    int sets=params.l1_size/(params.l1_assoc*params.block_size);
-    bool L1_VC;
-    if(params.vc_num_blocks==0)
-                    L1_VC=false;
-    else
-                   L1_VC= true;
-    // Open trace_file in read mode
-    cache_sim L1_Cache(params.l1_assoc,params.l1_size,params.block_size,params.vc_num_blocks);
-    FP = fopen(trace_file, "r");
-    if(FP == NULL)
+    // "--batch=<job list> [--threads=N] [--output=file]" runs many (trace, configuration) pairs in one process
+    if(argc >= 2 && strncmp(argv[1],"--batch=",8)==0)
     {
-        // Throw error and exit if fopen() failed
-        printf("Error: Unable to open file %s\n", trace_file);
+        unsigned threads = 0;
+        const char *output_file = NULL;
+        for(int arg=2;arg<argc;arg++)
+        {
+            if(strncmp(argv[arg],"--threads=",10)==0)
+                threads=strtoul(argv[arg]+10,NULL,10);
+            else if(strncmp(argv[arg],"--output=",9)==0)
+                output_file=argv[arg]+9;
+            else
+            {
+                printf("Error: Unknown option %s\n", argv[arg]);
+                exit(EXIT_FAILURE);
+            }
+        }
+        return run_batch(argv[1]+8,threads,output_file);
+    }
+    // Either "--config=<hierarchy file> <trace_file>" or the positional L1/VC/L2 parameters
+    char *config_file = NULL;
+    int first_option = 8;
+    if(argc >= 3 && strncmp(argv[1],"--config=",9)==0)
+    {
+        config_file = argv[1]+9;
+        trace_file  = argv[2];
+        first_option = 3;
+    }
+    else if(argc < 8)
+    {
+        printf("Error: Expected <BLOCKSIZE> <L1_SIZE> <L1_ASSOC> <VC_NUM_BLOCKS> <L2_SIZE> <L2_ASSOC> <trace_file>"
+               " or --config=<file> <trace_file>\n");
         exit(EXIT_FAILURE);
     }
-
-    // Print params
-    printf("===== Simulator configuration =====\n"
-           "L1_BLOCKSIZE:                     %lu\n"
-           "L1_SIZE:                          %lu\n"
-           "L1_ASSOC:                         %lu\n"
-           "VC_NUM_BLOCKS:                    %lu\n"
-           "L2_SIZE:                          %lu\n"
-           "L2_ASSOC:                         %lu\n"
-           "trace_file:                       %s\n"
-           "===================================\n\n", params.block_size, params.l1_size, params.l1_assoc, params.vc_num_blocks, params.l2_size, params.l2_assoc, trace_file);
-
-    char str[2];
-    int i;
-    while(fscanf(FP, "%s %lx", str, &addr) != EOF)
+    else
     {
-
-        rw = str[0];
-        if (rw == 'r')
+        // strtoul() converts char* to unsigned long. It is included in <stdlib.h>
+        params.block_size       = strtoul(argv[1], NULL, 10);
+        params.l1_size          = strtoul(argv[2], NULL, 10);
+        params.l1_assoc         = strtoul(argv[3], NULL, 10);
+        params.vc_num_blocks    = strtoul(argv[4], NULL, 10);
+        params.l2_size          = strtoul(argv[5], NULL, 10);
+        params.l2_assoc         = strtoul(argv[6], NULL, 10);
+        trace_file              = argv[7];
+    }
+    // optional trailing switches, e.g. --index=xor
+    index_policy_t index_policy = INDEX_MODULO;
+    dead_block_policy_t dead_block_policy = DEAD_BLOCK_OFF;
+    unsigned dead_block_region_bits = 12;
+    bool use_tlb = false;   // TLB front-end is off unless --tlb or --page-size is given
+    tlb_params tlb_config;
+    const char *miss_stream_file = NULL;
+    unsigned long long skip_records = 0;    // not simulated at all
+    unsigned long long warmup_records = 0;  // simulated, then the stats are cleared
+    unsigned long long window_records = 0;  // measured records, 0 is the rest of the trace
+    bool way_stats = false;
+    unsigned long region_size = 0;          // per-region attribution is off unless --regions is given
+    unsigned long region_count = 32;
+    unsigned long l1i_size = 0;             // positional runs drop 'i' records unless --l1i is given
+    unsigned long l1i_assoc = 0;
+    bool use_first_touch = false;
+    first_touch_mode_t first_touch_mode = FIRST_TOUCH_EXACT;
+    unsigned long long first_touch_capacity = 1ULL<<24;  // blocks the Bloom filter is sized for
+    double first_touch_error = 0.01;
+    for(int arg=first_option;arg<argc;arg++)
+    {
+        if(strncmp(argv[arg],"--index=",8)==0 && config_file==NULL)
         {
-            if(!L1_VC)
+            // hierarchies from a file set index=... per level
+            if(!parse_index_policy(argv[arg]+8,&index_policy))
             {
-                //printf("%s %lx\n", "read", addr);
-                hit_miss_policy_t status = L1_Cache.read_Cache(addr, params.l1_size, params.l1_assoc,
-                                                               params.block_size);
-                if (status == MISS) {
-                    L1_Cache.L1_read_misses++;
-                }
-
+                printf("Error: Unknown index policy %s\n", argv[arg]);
+                exit(EXIT_FAILURE);
             }
-            else
+        }
+        else if(strncmp(argv[arg],"--dead-block=",13)==0 && config_file==NULL)
+        {
+            // --dead-block=evict|bypass[:LOG2_REGION_SIZE], hierarchies from a file set deadblock=... per level
+            if(!parse_dead_block_policy(argv[arg]+13,&dead_block_policy,&dead_block_region_bits))
             {
-                hit_miss_policy_L1V status_v=L1_Cache.L1_Victim_read_cache(addr,params.l1_size,params.l1_assoc,params.block_size);
-                if(status_v!=R_L1_HIT)
-                {
-                    L1_Cache.L1_read_misses++;
-                }
+                printf("Error: Bad dead-block predictor %s\n", argv[arg]);
+                exit(EXIT_FAILURE);
             }
-
-            L1_Cache.L1_reads++;
-
-
-        }// Print and test if file is read correctly
-        else if (rw == 'w')
+        }
+        else if(strncmp(argv[arg],"--export-misses=",16)==0)
+        {
+            // --export-misses=<file>: requests the data-side first level sends down, see cache_hierarchy::export_stream
+            miss_stream_file=argv[arg]+16;
+        }
+        else if(strncmp(argv[arg],"--skip=",7)==0)
+            skip_records=strtoull(argv[arg]+7,NULL,10);
+        else if(strncmp(argv[arg],"--warmup=",9)==0)
+            warmup_records=strtoull(argv[arg]+9,NULL,10);
+        else if(strncmp(argv[arg],"--window=",9)==0)
+            window_records=strtoull(argv[arg]+9,NULL,10);
+        else if(strncmp(argv[arg],"--regions=",10)==0)
         {
-            if(!L1_VC)
+            // --regions=REGION_SIZE[:TOP_K], e.g. 4K:64 or 1M
+            char size_text[32]="";
+            sscanf(argv[arg]+10,"%31[^:]:%lu",size_text,&region_count);
+            region_size=parse_size(size_text);
+            if(region_size==0 || (region_size&(region_size-1))!=0 || region_count==0)
             {
-                //printf("%s %lx\n", "read", addr);
-                hit_miss_policy_t status = L1_Cache.write_Cache(addr, params.l1_size, params.l1_assoc,
-                                                               params.block_size);
-                if (status == MISS)
-                {
-                    L1_Cache.L1_writes_misses++;
-                }
-
+                printf("Error: Bad region size %s\n", argv[arg]);
+                exit(EXIT_FAILURE);
             }
-            else
+        }
+        else if(strncmp(argv[arg],"--l1i=",6)==0 && config_file==NULL)
+        {
+            // --l1i=L1I_SIZE:L1I_ASSOC, split L1 with the BLOCKSIZE of the L1D sharing the L2,
+            // hierarchies from a file use "instr <level>"
+            if(sscanf(argv[arg]+6,"%lu:%lu",&l1i_size,&l1i_assoc)!=2)
+            {
+                printf("Error: Bad L1I geometry %s\n", argv[arg]);
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if(strcmp(argv[arg],"--way-stats")==0)
+        {
+            // reports the first-probe hit rate of the MRU way predictor
+            way_stats=true;
+        }
+        else if(strncmp(argv[arg],"--first-touch=",14)==0)
+        {
+            // --first-touch=exact or bloom[:EXPECTED_BLOCKS[:FALSE_POSITIVE_RATE]]
+            if(!parse_first_touch(argv[arg]+14,&first_touch_mode,&first_touch_capacity,&first_touch_error))
+            {
+                printf("Error: Bad first-touch tracker %s\n", argv[arg]);
+                exit(EXIT_FAILURE);
+            }
+            use_first_touch=true;
+        }
+        else if(strncmp(argv[arg],"--tlb=",6)==0)
+        {
+            // --tlb=L1_ENTRIES:L1_ASSOC:L2_ENTRIES:L2_ASSOC (L2_ENTRIES 0 disables the L2 TLB),
+            // each level needs at least one set of a non-zero associativity
+            if(sscanf(argv[arg]+6,"%lu:%lu:%lu:%lu",&tlb_config.l1_entries,&tlb_config.l1_assoc,
+                      &tlb_config.l2_entries,&tlb_config.l2_assoc)!=4
+               || tlb_config.l1_assoc==0 || tlb_config.l1_entries<tlb_config.l1_assoc
+               || tlb_config.l2_assoc==0 || (tlb_config.l2_entries!=0 && tlb_config.l2_entries<tlb_config.l2_assoc))
+            {
+                printf("Error: Bad TLB geometry %s\n", argv[arg]);
+                exit(EXIT_FAILURE);
+            }
+            use_tlb=true;
+        }
+        else if(strncmp(argv[arg],"--page-size=",12)==0)
+        {
+            // --page-size=4K, 2M or a size in bytes, a power of two
+            char unit=0;
+            int fields=sscanf(argv[arg]+12,"%lu%c",&tlb_config.page_size,&unit);
+            if(unit=='K' || unit=='k')
+                tlb_config.page_size*=1024;
+            else if(unit=='M' || unit=='m')
+                tlb_config.page_size*=1024*1024;
+            else if(unit!=0)
+                fields=0;
+            if(fields<1 || tlb_config.page_size==0 || (tlb_config.page_size&(tlb_config.page_size-1))!=0)
+            {
+                printf("Error: Bad page size %s\n", argv[arg]);
+                exit(EXIT_FAILURE);
+            }
+            use_tlb=true;
+        }
+        else if(strncmp(argv[arg],"--walk-latency=",15)==0)
+        {
+            // --walk-latency=PTE_L1_HIT_CYCLES:PTE_L1_MISS_CYCLES
+            if(sscanf(argv[arg]+15,"%lu:%lu",&tlb_config.walk_hit_cycles,&tlb_config.walk_miss_cycles)!=2)
+            {
+                printf("Error: Bad walk latency %s\n", argv[arg]);
+                exit(EXIT_FAILURE);
+            }
+        }
+        else
+        {
+            printf("Error: Unknown option %s\n", argv[arg]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    cache_hierarchy hierarchy;
+    if(config_file != NULL)
+    {
+        if(!hierarchy.load_config(config_file))
+            exit(EXIT_FAILURE);
+    }
+    else
+    {
+        // the positional interface is the L1(+VC)(+L2) special case of a configuration file
+        level_params l1_config;
+        l1_config.name="L1";
+        l1_config.size=params.l1_size;
+        l1_config.assoc=params.l1_assoc;
+        l1_config.block_size=params.block_size;
+        l1_config.vc_num_blocks=params.vc_num_blocks;
+        l1_config.index_policy=index_policy;
+        l1_config.dead_block_policy=dead_block_policy;
+        l1_config.dead_block_region_bits=dead_block_region_bits;
+        if(params.l2_size!=0)
+        {
+            level_params l2_config;
+            l2_config.name="L2";
+            l2_config.size=params.l2_size;
+            l2_config.assoc=params.l2_assoc;
+            l2_config.block_size=params.block_size;
+            l1_config.next="L2";
+            hierarchy.add_level(l1_config);
+            hierarchy.add_level(l2_config);
+        }
+        else
+        {
+            hierarchy.add_level(l1_config);
+        }
+        if(l1i_size!=0)
+        {
+            // added last, the legacy report finds the L2 at levels[1]
+            level_params l1i_config;
+            l1i_config.name="L1I";
+            l1i_config.size=l1i_size;
+            l1i_config.assoc=l1i_assoc;
+            l1i_config.block_size=params.block_size;
+            l1i_config.next=l1_config.next;
+            hierarchy.add_level(l1i_config);
+            hierarchy.data_entry_name="L1";
+            hierarchy.instr_entry_name="L1I";
+        }
+        if(!hierarchy.link())
+            exit(EXIT_FAILURE);
+    }
+    hierarchy.way_stats = way_stats;
+    FILE *miss_stream = NULL;
+    if(miss_stream_file != NULL)
+    {
+        miss_stream = fopen(miss_stream_file, "w");
+        if(miss_stream == NULL)
+        {
+            printf("Error: Unable to open file %s\n", miss_stream_file);
+            exit(EXIT_FAILURE);
+        }
+        hierarchy.export_stream(miss_stream,hierarchy.data_entry);
+    }
+    tlb_sim *TLB = NULL;
+    if(use_tlb)
+    {
+        TLB = new tlb_sim(tlb_config,&hierarchy);
+    }
+    first_touch_tracker *first_touch = NULL;
+    if(use_first_touch)
+    {
+        first_touch = new first_touch_tracker(first_touch_mode,hierarchy.data_entry->params.block_size,
+                                              first_touch_capacity,first_touch_error);
+    }
+    region_stats *regions = NULL;
+    if(region_size != 0)
+    {
+        regions = new region_stats(region_size,region_count);
+    }
+    if(!reader.open(trace_file))
+    {
+        // Throw error and exit if fopen() failed
+        printf("Error: Unable to open file %s\n", trace_file);
+        exit(EXIT_FAILURE);
+    }
+
+    // Print params
+    if(config_file != NULL)
+    {
+        hierarchy.print_config(trace_file);
+    }
+    else
+    {
+        printf("===== Simulator configuration =====\n"
+               "L1_BLOCKSIZE:                     %lu\n"
+               "L1_SIZE:                          %lu\n"
+               "L1_ASSOC:                         %lu\n"
+               "VC_NUM_BLOCKS:                    %lu\n"
+               "L2_SIZE:                          %lu\n"
+               "L2_ASSOC:                         %lu\n"
+               "trace_file:                       %s\n"
+               "===================================\n\n", params.block_size, params.l1_size, params.l1_assoc, params.vc_num_blocks, params.l2_size, params.l2_assoc, trace_file);
+        if(index_policy!=INDEX_MODULO)
+        {
+            static const char *index_policy_names[4]={"modulo","xor","prime","skewed"};
+            printf("INDEX_POLICY:                     %s\n\n", index_policy_names[index_policy]);
+        }
+    }
+
+    // binary traces seek past the skipped records, the others read them, so every format counts records alike
+    reader.skip(skip_records);
+    unsigned long long simulated = 0;
+    while((window_records == 0 || simulated < warmup_records + window_records) && reader.next(&rw, &addr))
+    {
+        if(simulated++ == warmup_records && warmup_records != 0)
+        {
+            // the contents stay warm, only the measurement starts over
+            hierarchy.clear_stats();
+            if(TLB != NULL)
+                TLB->clear_stats();
+            if(first_touch != NULL)
+                first_touch->clear_stats();
+            if(regions != NULL)
+                regions->clear_stats();
+        }
+        hierarchy.record_index = reader.records_read - 1;
+        if(TLB != NULL)
+        {
+            // translate first, the walk may already bring PTE blocks into the data caches
+            TLB->translate(addr);
+        }
+        if (rw == 'r' || rw == 'w')
+        {
+            bool present = hierarchy.access(hierarchy.data_entry, addr, rw == 'w');
+            if(first_touch != NULL)
+                first_touch->observe(hierarchy.record_index, addr, !present);
+            if(regions != NULL)
             {
-                hit_miss_policy_L1V status_v=L1_Cache.L1_Victim_write_cache(addr,params.l1_size,params.l1_assoc,params.block_size);
-                if(status_v!=W_L1_HIT)
-                {
-                    L1_Cache.L1_writes_misses++;
-                }
+                regions->access(addr, !present);
+                cache_sim *entry_cache = hierarchy.data_entry->cache;
+                if(entry_cache->evicted_valid && entry_cache->evicted_dirty == 1)
+                    regions->writeback(entry_cache->evicted_address);
             }
-            L1_Cache.L1_writes++;
-           // printf("%s %lx\n", "write", addr);
         }
-        L1_Cache.lru_counter++;
+        else if (rw == 'i' && (config_file != NULL || l1i_size != 0))
+        {
+            hierarchy.instruction_fetch(addr);
+        }
     }
-    L1_Cache.L1_VC_miss_rate=(float)(L1_Cache.L1_read_misses+L1_Cache.L1_writes_misses-L1_Cache.swaps)/(float)(L1_Cache.L1_reads+L1_Cache.L1_writes);
 
-    L1_Cache.total_memory_traffic=L1_Cache.L1_read_misses+L1_Cache.L1_writes_misses-L1_Cache.swaps+L1_Cache.evict_count;
+    if(warmup_records != 0 && simulated <= warmup_records)
+    {
+        // the trace ended inside the warm-up, nothing was measured
+        hierarchy.clear_stats();
+        if(TLB != NULL)
+            TLB->clear_stats();
+        if(first_touch != NULL)
+            first_touch->clear_stats();
+        if(regions != NULL)
+            regions->clear_stats();
+    }
 
-    L1_Cache.print_CacheTable(sets,params.l1_assoc);
+    if(config_file != NULL)
+    {
+        hierarchy.print_stats();
+    }
+    else
+    {
+        cache_sim &L1_Cache = *hierarchy.levels[0]->cache;
+        if(L1_Cache.L1_reads+L1_Cache.L1_writes != 0)
+            L1_Cache.L1_VC_miss_rate=(float)(L1_Cache.L1_read_misses+L1_Cache.L1_writes_misses-L1_Cache.swaps)/(float)(L1_Cache.L1_reads+L1_Cache.L1_writes);
+        if(hierarchy.levels.size()>1)
+        {
+            cache_level *L2 = hierarchy.levels[1];
+            L1_Cache.L2_reads=L2->cache->L1_reads;
+            L1_Cache.L2_read_misses=L2->cache->L1_read_misses;
+            L1_Cache.L2_writes=L2->cache->L1_writes;
+            L1_Cache.L2_writes_misses=L2->cache->L1_writes_misses;
+            L1_Cache.L2_miss_rate=(L1_Cache.L2_reads==0)?0:(float)L1_Cache.L2_read_misses/(float)L1_Cache.L2_reads;
+            L1_Cache.writebacks_L2=L2->writebacks;
+            L1_Cache.total_memory_traffic=hierarchy.memory_reads+hierarchy.memory_writes;
+        }
+        else
+        {
+            // the L1I never holds dirty blocks, its misses are all the traffic it adds
+            L1_Cache.total_memory_traffic=L1_Cache.L1_read_misses+L1_Cache.L1_writes_misses-L1_Cache.swaps+L1_Cache.evict_count
+                                          +hierarchy.instruction_memory_reads;
+        }
+        L1_Cache.print_CacheTable(L1_Cache.sets_l1,params.l1_assoc);
+        if(l1i_size!=0)
+        {
+            cout<<"\n";
+            hierarchy.print_instruction_stats();
+        }
+        if(dead_block_policy!=DEAD_BLOCK_OFF)
+        {
+            L1_Cache.print_dead_block_stats();
+        }
+        if(way_stats)
+        {
+            L1_Cache.print_way_prediction_stats();
+        }
+    }
+    if(TLB != NULL)
+    {
+        TLB->print_stats();
+        delete TLB;
+    }
+    if(regions != NULL)
+    {
+        regions->print_stats();
+        delete regions;
+    }
+    if(first_touch != NULL)
+    {
+        first_touch->print_stats();
+        delete first_touch;
+    }
+    if(miss_stream != NULL)
+    {
+        fclose(miss_stream);
+    }
 
 
 
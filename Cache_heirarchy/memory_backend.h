@@ -0,0 +1,25 @@
+#ifndef MEMORY_BACKEND_H_
+#define MEMORY_BACKEND_H_
+
+/* timing of the data memory as seen by the pipeline simulators (the MEM stage of sim_pipe, the
+   MEMORY unit of sim_ooo), the data itself stays in the simulator. A backend is asked once per
+   load or store, when the access starts */
+class memory_backend{
+public:
+        virtual ~memory_backend() {}
+
+        //returns the clock cycles the access keeps the memory stage busy after its first cycle
+        virtual unsigned access(unsigned address, bool write) = 0;
+};
+
+/* every access takes the same number of extra cycles, the data_memory_latency of the simulators */
+class fixed_latency_memory : public memory_backend{
+public:
+        unsigned latency;
+
+        fixed_latency_memory(unsigned memory_latency=0) : latency(memory_latency) {}
+
+        unsigned access(unsigned, bool) { return latency; }
+};
+
+#endif /*MEMORY_BACKEND_H_*/
@@ -0,0 +1,141 @@
+//
+// Created by Sweta Subhra Datta
+//
+#include "region_stats.h"
+#include <iostream>
+#include <stdio.h>
+#include <algorithm>
+#include "math.h"
+
+using namespace std;
+
+region_stats::region_stats(unsigned long region_size, size_t max_regions)
+{
+    region_bits=log2(region_size);
+    capacity=(max_regions==0)?1:max_regions;
+    heap.reserve(capacity);
+}
+
+/*
+ * Counts one data access in its region
+ * @params::address,true if the access missed the first data level
+ */
+void region_stats::access(unsigned long address, bool missed)
+{
+    unsigned long region=address>>region_bits;
+    unordered_map<unsigned long,size_t>::iterator found=slot.find(region);
+    if(!missed)
+    {
+        total_hits++;
+        if(found!=slot.end())
+            heap[found->second].hits++;
+        return;
+    }
+    total_misses++;
+    if(found!=slot.end())
+    {
+        heap[found->second].misses++;
+        sift_down(found->second);
+        return;
+    }
+    if(heap.size()<capacity)
+    {
+        region_entry_t entry;
+        entry.region=region;
+        entry.misses=1;
+        heap.push_back(entry);
+        slot[region]=heap.size()-1;
+        sift_up(heap.size()-1);
+        return;
+    }
+    //Space-Saving: the region with the fewest misses makes room and hands its count on as the error bound
+    region_entry_t &root=heap[0];
+    slot.erase(root.region);
+    root.error=root.misses;
+    root.misses++;
+    root.region=region;
+    root.hits=0;
+    root.writebacks=0;
+    slot[region]=0;
+    sift_down(0);
+}
+
+/*
+ * Counts a dirty block leaving the first data level against the region it belongs to
+ */
+void region_stats::writeback(unsigned long address)
+{
+    total_writebacks++;
+    unordered_map<unsigned long,size_t>::iterator found=slot.find(address>>region_bits);
+    if(found!=slot.end())
+        heap[found->second].writebacks++;
+}
+
+/*
+ * Warm-up end: the monitored regions are dropped with their counts
+ */
+void region_stats::clear_stats()
+{
+    heap.clear();
+    slot.clear();
+    total_hits=0;
+    total_misses=0;
+    total_writebacks=0;
+}
+
+void region_stats::swap_entries(size_t a, size_t b)
+{
+    swap(heap[a],heap[b]);
+    slot[heap[a].region]=a;
+    slot[heap[b].region]=b;
+}
+
+void region_stats::sift_up(size_t position)
+{
+    while(position>0 && heap[(position-1)/2].misses>heap[position].misses)
+    {
+        swap_entries(position,(position-1)/2);
+        position=(position-1)/2;
+    }
+}
+
+void region_stats::sift_down(size_t position)
+{
+    while(true)
+    {
+        size_t smallest=position;
+        size_t left=2*position+1;
+        size_t right=left+1;
+        if(left<heap.size() && heap[left].misses<heap[smallest].misses)
+            smallest=left;
+        if(right<heap.size() && heap[right].misses<heap[smallest].misses)
+            smallest=right;
+        if(smallest==position)
+            return;
+        swap_entries(position,smallest);
+        position=smallest;
+    }
+}
+
+/*
+ * Monitored regions hottest first. A region's misses exceed its true count by at most its error,
+ * hits and writebacks are only counted while the region is monitored
+ */
+void region_stats::print_stats()
+{
+    vector<region_entry_t> ranked(heap);
+    sort(ranked.begin(),ranked.end(),[](const region_entry_t &left,const region_entry_t &right)
+    {
+        return left.misses>right.misses || (left.misses==right.misses && left.region<right.region);
+    });
+    cout<<"===== Hot regions ====="<<endl;
+    cout<<"region size: "<<dec<<(1UL<<region_bits)<<", regions monitored: "<<ranked.size()<<" of "<<capacity<<endl;
+    cout<<"total hits: "<<dec<<total_hits<<", total misses: "<<total_misses<<", total writebacks: "<<total_writebacks<<endl;
+    printf("%-5s %-18s %10s %8s %10s %10s %10s\n","rank","region","misses","error","hits","writebacks","miss_share");
+    for(size_t i=0;i<ranked.size();i++)
+    {
+        printf("%-5zu 0x%-16lx %10llu %8llu %10llu %10llu %10.4f\n",i+1,ranked[i].region<<region_bits,
+               ranked[i].misses,ranked[i].error,ranked[i].hits,ranked[i].writebacks,
+               total_misses==0?0.0:(double)ranked[i].misses/(double)total_misses);
+    }
+}
@@ -0,0 +1,50 @@
+//
+// Created by Sweta Subhra Datta
+//
+#ifndef REGION_STATS_H
+#define REGION_STATS_H
+
+#include <vector>
+#include <unordered_map>
+#include <stddef.h>
+
+using namespace std;
+
+/*
+ * Hits, misses and writebacks per address region of the data side, so misses can be mapped
+ * back to the data structures that cause them. Regions are ranked by misses with the
+ * Space-Saving heavy-hitter sketch: at most "capacity" regions are monitored and memory stays flat
+ */
+class region_stats
+{
+public:
+    typedef struct region_entry
+    {
+        unsigned long region=0;
+        unsigned long long misses=0; //upper bound of the true count
+        unsigned long long error=0;  //misses inherited from the region it replaced
+        unsigned long long hits=0;   //counted while monitored
+        unsigned long long writebacks=0;
+    }region_entry_t;
+
+    unsigned region_bits;
+    size_t capacity;
+    vector<region_entry_t> heap;               //min-heap on misses, the root is replaced first
+    unordered_map<unsigned long,size_t> slot;  //region -> position in heap
+    unsigned long long total_hits=0;
+    unsigned long long total_misses=0;
+    unsigned long long total_writebacks=0;
+
+    region_stats(unsigned long region_size,size_t capacity);
+    void access(unsigned long address,bool missed);
+    void writeback(unsigned long address);
+    void clear_stats();
+    void print_stats();
+
+private:
+    void sift_up(size_t position);
+    void sift_down(size_t position);
+    void swap_entries(size_t a,size_t b);
+};
+
+#endif //REGION_STATS_H
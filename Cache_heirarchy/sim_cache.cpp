@@ -7,8 +7,62 @@
 #include "algorithm"
 #include "math.h"
 #include <map>
+#include <limits>
 using namespace std;
 
+/*
+ * Every tag takes "width" bits of "words", a tag may straddle two words
+ */
+void tag_store::resize(unsigned long count, unsigned bits)
+{
+    entries=count;
+    width=(bits==0)?1:(bits>64?64:bits);
+    words.assign((entries*width+63)/64,0);
+}
+
+unsigned long tag_store::get(unsigned long entry) const
+{
+    unsigned long bit=entry*width;
+    unsigned shift=bit%64;
+    unsigned long tag=words[bit/64]>>shift;
+    if(shift+width>64)
+    {
+        tag|=words[bit/64+1]<<(64-shift);
+    }
+    return (width==64)?tag:tag&((1UL<<width)-1);
+}
+
+void tag_store::set(unsigned long entry, unsigned long tag)
+{
+    if(width<64 && (tag>>width)!=0)
+    {
+        widen(64-__builtin_clzl(tag));
+    }
+    unsigned long mask=(width==64)?~0UL:(1UL<<width)-1;
+    unsigned long bit=entry*width;
+    unsigned shift=bit%64;
+    words[bit/64]=(words[bit/64]&~(mask<<shift))|(tag<<shift);
+    if(shift+width>64)
+    {
+        unsigned spill=64-shift;
+        words[bit/64+1]=(words[bit/64+1]&~(mask>>spill))|(tag>>spill);
+    }
+}
+
+/*
+ * Repacks every tag at "bits" bits, only happens when a trace reaches a new highest address bit
+ */
+void tag_store::widen(unsigned bits)
+{
+    tag_store wider;
+    wider.resize(entries,bits);
+    for(unsigned long entry=0;entry<entries;entry++)
+    {
+        wider.set(entry,get(entry));
+    }
+    *this=wider;
+}
+
 /*
  * This is the paramterised constructor of the class when only L1 or L1-VC
  */
@@ -17,15 +71,21 @@ cache_sim::cache_sim(unsigned long associativity, unsigned long l1_size, unsigne
     unsigned rows_of_SETS = l1_size / (associativity * block_size);
     ///Allocating the size of Cache Table
     L1_Cachetable = vector<vector<L1_block>>(rows_of_SETS,vector<L1_block>(associativity));
+    sets_l1 = rows_of_SETS;
+    l1_assoc = associativity;
+    cache_size_l1 = l1_size;
+    block_size_l1 = block_size;
+    mru_way = vector<unsigned short>(rows_of_SETS,0);
+    tags.resize((unsigned long)rows_of_SETS*associativity,tag_bits_for(l1_size,associativity,block_size));
 
     //only allocate victim cache when necessary
     if(VC_NUM_BLOCKS!=0) {
         victim_Cache = vector<L1_block>(VC_NUM_BLOCKS);
+        victim_tags = vector<unsigned long>(VC_NUM_BLOCKS,0);
         victim_block_size = VC_NUM_BLOCKS;
-        for(int i=0;i<victim_Cache.size();i++)
+        for(unsigned i=0;i<victim_Cache.size();i++)
         {
-            victim_Cache[i].LRU=numeric_limits<unsigned >::max();
-            victim_Cache[i].address=UNDEFINED;
+            victim_Cache[i].LRU=numeric_limits<unsigned long>::max();
         }
     }
 }
@@ -38,98 +98,253 @@ cache_sim::cache_sim(unsigned long associativity, unsigned long l1_size, unsigne
 
 
 
-unsigned long cache_sim::get_index(unsigned  address, unsigned long cache_l1_size, unsigned long associativity,unsigned long block_size)
+unsigned long cache_sim::get_index(unsigned long address, unsigned long cache_l1_size, unsigned long associativity,unsigned long block_size)
 {
+    if(index_policy==INDEX_SKEWED)
+    {
+        return get_way_index(address,0,cache_l1_size,associativity,block_size);
+    }
     unsigned long int sets=cache_l1_size/(associativity*block_size);
     unsigned int index=log2(sets);
     unsigned int block_offset=log2(block_size);
+    if(index_policy==INDEX_XOR_FOLD)
+    {
+        //fold every index-wide field of the block address onto the low bits
+        unsigned long block_address=address>>block_offset;
+        unsigned long index_bit=0;
+        while(block_address!=0 && index!=0)
+        {
+            index_bit^=block_address&((1<<index)-1);
+            block_address>>=index;
+        }
+        return index_bit;
+    }
+    if(index_policy==INDEX_PRIME_MODULO)
+    {
+        return (address>>block_offset)%prime_sets;
+    }
     unsigned long index_bit=(address>>block_offset)&((1<<index)-1);
     return index_bit;
 }
+
+/*
+ * Skewed-associative index: the low index bits XOR-ed with a per-way hash of the
+ * remaining block address bits, so two blocks that conflict in one way rarely conflict in the others
+ * @params::address,way,cache_l1_size,associativity,block_size
+ * @return index of the set for that way
+ */
+unsigned long cache_sim::get_way_index(unsigned long address, unsigned way, unsigned long cache_l1_size, unsigned long associativity,unsigned long block_size)
+{
+    //odd multipliers are bijective on the high bits, way 0 keeps the plain fold
+    static const unsigned long long skew_multiplier[8]={1ULL,0x9E3779B97F4A7C15ULL,0xC2B2AE3D27D4EB4FULL,0x165667B19E3779F9ULL,
+                                                        0xD6E8FEB86659FD93ULL,0xFF51AFD7ED558CCDULL,0xC4CEB9FE1A85EC53ULL,0x27D4EB2F165667C5ULL};
+    unsigned long int sets=cache_l1_size/(associativity*block_size);
+    unsigned int index=log2(sets);
+    unsigned int block_offset=log2(block_size);
+    if(index==0)
+    {
+        return 0;
+    }
+    unsigned long long block_address=address>>block_offset;
+    unsigned long long high_bits=(block_address>>index)*skew_multiplier[way%8];
+    if(way>=8)
+    {
+        high_bits=(high_bits<<(way/8))|(high_bits>>(64-(way/8)));
+    }
+    unsigned long long index_bit=block_address;
+    while(high_bits!=0)
+    {
+        index_bit^=high_bits;
+        high_bits>>=index;
+    }
+    return index_bit&((1ULL<<index)-1);
+}
+
+/*
+ * Selects the index function used by get_index/get_way_index for every later access
+ * @params::policy,cache_l1_size,associativity,block_size
+ */
+void cache_sim::set_index_policy(index_policy_t policy, unsigned long cache_l1_size, unsigned long associativity,unsigned long block_size)
+{
+    index_policy=policy;
+    unsigned long int sets=cache_l1_size/(associativity*block_size);
+    if(policy==INDEX_PRIME_MODULO)
+    {
+        //largest prime that still fits in the table, the remaining sets stay unused
+        prime_sets=sets;
+        while(prime_sets>2)
+        {
+            bool is_prime=true;
+            for(unsigned long d=2;d*d<=prime_sets;d++)
+            {
+                if(prime_sets%d==0)
+                {
+                    is_prime=false;
+                    break;
+                }
+            }
+            if(is_prime)
+                break;
+            prime_sets--;
+        }
+        if(prime_sets==0)
+            prime_sets=1;
+    }
+    if(policy==INDEX_SKEWED)
+    {
+        way_index=vector<unsigned long>(associativity,0);
+    }
+    //hashed policies keep the whole block address in the tag
+    tags.resize(L1_Cachetable.size()*associativity,tag_bits_for(cache_l1_size,associativity,block_size));
+}
+
+/*
+ * Computes the set of every way for the current address (skewed organisation only)
+ */
+void cache_sim::map_ways(unsigned long address, unsigned long cache_l1_size, unsigned long associativity,unsigned long block_size)
+{
+    if(index_policy!=INDEX_SKEWED)
+    {
+        return;
+    }
+    for(unsigned way=0;way<associativity;way++)
+    {
+        way_index[way]=get_way_index(address,way,cache_l1_size,associativity,block_size);
+    }
+}
+
+/*
+ * Returns the row of L1_Cachetable that holds "way" for the access mapped to "index"
+ */
+unsigned long cache_sim::set_of(unsigned long index, unsigned way)
+{
+    if(index_policy==INDEX_SKEWED)
+    {
+        return way_index[way];
+    }
+    return index;
+}
+
 /*
  * This function helps to get the tag of the address
  * @params::addres,cache_l1_size,assoxiativity,block_size
  * @return index
  */
 
-unsigned long   cache_sim::get_tag(unsigned address, unsigned long cache_l1_size, unsigned long associativity,
+unsigned long   cache_sim::get_tag(unsigned long address, unsigned long cache_l1_size, unsigned long associativity,
                                    unsigned long block_size)
 {
     unsigned long int sets=cache_l1_size/(associativity*block_size);
     unsigned int index=log2(sets);
     unsigned int block_offset=log2(block_size);
+    if(index_policy!=INDEX_MODULO)
+    {
+        //hashed indices are not invertible, keep the whole block address
+        index=0;
+    }
     unsigned long long tag_bit=(address>>(index + block_offset));
     return tag_bit;
 }
 
+/*
+ * Width of the tags of 32-bit addresses, the tag store widens itself for longer ones
+ * @params::cache_l1_size,associativity,block_size
+ * @return number of tag bits, at least 1
+ */
+unsigned cache_sim::tag_bits_for(unsigned long cache_l1_size, unsigned long associativity, unsigned long block_size)
+{
+    unsigned long int sets=cache_l1_size/(associativity*block_size);
+    unsigned int index=log2(sets);
+    unsigned int block_offset=log2(block_size);
+    if(index_policy!=INDEX_MODULO)
+    {
+        index=0;
+    }
+    return (index+block_offset<32)?32-(index+block_offset):1;
+}
+
 /*
  * This function helps to get the offset of the address
  * @params::addres,cache_l1_size,assoxiativity,block_size
  * @return index
  */
 
-unsigned long cache_sim::get_offset(unsigned int address, unsigned long cache_l1_size, unsigned long associativity,unsigned long block_size)
+unsigned long cache_sim::get_offset(unsigned long address, unsigned long cache_l1_size, unsigned long associativity,unsigned long block_size)
 {
-    unsigned long int sets=cache_l1_size/(associativity*block_size);
-    unsigned int index=log2(sets);
     unsigned int block_offset=log2(block_size);
-    // unsigned int tag=32-(index+block_offset);
-    unsigned long block_offset_bit=(address>>0 & (1<<block_offset)-1);
+    unsigned long block_offset_bit=(address & ((1<<block_offset)-1));
     return block_offset_bit;
 
 }
 
 
-hit_miss_policy_t cache_sim::read_Cache(unsigned int address, unsigned long cache_l1_size, unsigned long int associativity,
+hit_miss_policy_t cache_sim::read_Cache(unsigned long address, unsigned long cache_l1_size, unsigned long int associativity,
                                         unsigned long int  block_size)
 {
     unsigned long index = get_index(address,cache_l1_size,associativity,block_size);
     unsigned long long tag = get_tag(address,cache_l1_size,associativity,block_size);
+    map_ways(address,cache_l1_size,associativity,block_size);
     //unsigned long offset = get_block_offset(address);
+    evicted_valid=false;
+    bypassed=false;
     hit_miss_policy_t status;
 
     //if there is a read hit
-    for (unsigned hit_loop = 0; hit_loop < associativity; hit_loop++)
+    int hit_way = find_way(index,tag,associativity);
+    if (hit_way >= 0)
     {
-        if (L1_Cachetable[index][hit_loop].tag == tag && L1_Cachetable[index][hit_loop].valid_bit == 1)
-        {
-            L1_Cachetable[index][hit_loop].LRU = lru_counter;//Accessed
-            status = HIT;
-            return status;
-        }
+        L1_Cachetable[set_of(index,hit_way)][hit_way].LRU = lru_counter;//Accessed
+        if(dead_block_policy!=DEAD_BLOCK_OFF)
+            dead_block_hit(L1_Cachetable[set_of(index,hit_way)][hit_way],address);
+        status = HIT;
+        return status;
     }
 
     //if there is a read miss
-    for(int miss_loop=0;miss_loop<associativity;miss_loop++)
+    if(dead_block_policy==DEAD_BLOCK_BYPASS && dead_block_bypass(address,index,tag))
+    {
+        return MISS;
+    }
+    for(unsigned miss_loop=0;miss_loop<associativity;miss_loop++)
     {
         status=MISS;
         ////////if conflict
-        if(L1_Cachetable[index][miss_loop].tag!=UNDEFINED)
+        if(L1_Cachetable[set_of(index,miss_loop)][miss_loop].valid_bit==1)
         {
 
             unsigned new_block = evict_blocK(index,associativity);
-            if(L1_Cachetable[index][new_block].dirty_bit==1)
+            if(L1_Cachetable[set_of(index,new_block)][new_block].dirty_bit==1)
             {
                 evict_count++;
 
             }
-
-            L1_Cachetable[index][new_block].index = index;
-            L1_Cachetable[index][new_block].tag = tag;
-            L1_Cachetable[index][new_block].LRU= lru_counter;
-            L1_Cachetable[index][new_block].valid_bit = 1;
-            L1_Cachetable[index][new_block].dirty_bit=0;
+            record_eviction(L1_Cachetable[set_of(index,new_block)][new_block],tag_of(set_of(index,new_block),new_block));
+            if(dead_block_policy!=DEAD_BLOCK_OFF)
+                dead_block_evicted(L1_Cachetable[set_of(index,new_block)][new_block],tag_of(set_of(index,new_block),new_block));
+
+            L1_Cachetable[set_of(index,new_block)][new_block].index = index;
+            set_tag(set_of(index,new_block),new_block,tag);
+            L1_Cachetable[set_of(index,new_block)][new_block].LRU= lru_counter;
+            mru_way[index] = new_block;
+            L1_Cachetable[set_of(index,new_block)][new_block].valid_bit = 1;
+            L1_Cachetable[set_of(index,new_block)][new_block].dirty_bit=0;
+            if(dead_block_policy!=DEAD_BLOCK_OFF)
+                dead_block_fill(L1_Cachetable[set_of(index,new_block)][new_block],address);
             return MISS;
         }
             //////if empty
         else
         {
-            if (L1_Cachetable[index][miss_loop].tag == UNDEFINED ) {
-                L1_Cachetable[index][miss_loop].tag = tag;
+            if (L1_Cachetable[set_of(index,miss_loop)][miss_loop].valid_bit==0 ) {
+                set_tag(set_of(index,miss_loop),miss_loop,tag);
+                L1_Cachetable[set_of(index,miss_loop)][miss_loop].index = index;
                 // cache_table[index].at(j).block_offset = offset;
-                L1_Cachetable[index][miss_loop].dirty_bit = 0;
-                L1_Cachetable[index][miss_loop].valid_bit = 1;
-                L1_Cachetable[index][miss_loop].LRU = lru_counter;
+                L1_Cachetable[set_of(index,miss_loop)][miss_loop].dirty_bit = 0;
+                L1_Cachetable[set_of(index,miss_loop)][miss_loop].valid_bit = 1;
+                L1_Cachetable[set_of(index,miss_loop)][miss_loop].LRU = lru_counter;
+                mru_way[index] = miss_loop;
+                if(dead_block_policy!=DEAD_BLOCK_OFF)
+                    dead_block_fill(L1_Cachetable[set_of(index,miss_loop)][miss_loop],address);
                 return MISS;
             }
         }
@@ -139,58 +354,73 @@ hit_miss_policy_t cache_sim::read_Cache(unsigned int address, unsigned long cach
 
     return status;
 }
-hit_miss_policy_t cache_sim::write_Cache(unsigned int address, unsigned long cache_l1_size,unsigned long associativity, unsigned long block_size)
+hit_miss_policy_t cache_sim::write_Cache(unsigned long address, unsigned long cache_l1_size,unsigned long associativity, unsigned long block_size)
 {
     hit_miss_policy_t status;
     unsigned long index = get_index(address, cache_l1_size, associativity, block_size);
     unsigned long  tag = get_tag(address, cache_l1_size, associativity, block_size);
-    for (unsigned hit_loop = 0; hit_loop < associativity; hit_loop++)
-
-        //////////////////////FOR_HIT//////////////////////////////
+    map_ways(address, cache_l1_size, associativity, block_size);
+    evicted_valid=false;
+    bypassed=false;
+    //////////////////////FOR_HIT//////////////////////////////
+    int hit_way = find_way(index,tag,associativity);
+    if (hit_way >= 0)
     {
-        if (L1_Cachetable[index][hit_loop].tag == tag && L1_Cachetable[index][hit_loop].valid_bit == 1)
-        {
-
-            L1_Cachetable[index][hit_loop].dirty_bit = 1;
-            L1_Cachetable[index][hit_loop].LRU = lru_counter;
-
-            status=HIT;
-            return status;
-        }
+        L1_Cachetable[set_of(index,hit_way)][hit_way].dirty_bit = 1;
+        L1_Cachetable[set_of(index,hit_way)][hit_way].LRU = lru_counter;
+        if(dead_block_policy!=DEAD_BLOCK_OFF)
+            dead_block_hit(L1_Cachetable[set_of(index,hit_way)][hit_way],address);
 
+        status=HIT;
+        return status;
     }
     /////////////////////FOR_write_MISS/////////////////////
+    if(dead_block_policy==DEAD_BLOCK_BYPASS && dead_block_bypass(address,index,tag))
+    {
+        //write-around, the level below takes the data
+        return MISS;
+    }
     for (unsigned miss_loop = 0; miss_loop < associativity; miss_loop++)
     {
 
         //Picture of L2 comes here
-        if (L1_Cachetable[index][miss_loop].tag!=UNDEFINED)//when conflict
+        if (L1_Cachetable[set_of(index,miss_loop)][miss_loop].valid_bit==1)//when conflict
         {
 
             unsigned new_block = evict_blocK(index, associativity);
-            if(L1_Cachetable[index][new_block].dirty_bit==1)
+            if(L1_Cachetable[set_of(index,new_block)][new_block].dirty_bit==1)
             {
                 evict_count++;
             }
-            L1_Cachetable[index][new_block].LRU = lru_counter;
-            L1_Cachetable[index][new_block].tag = tag;
-            L1_Cachetable[index][new_block].dirty_bit = 1;
-            L1_Cachetable[index][new_block].valid_bit = 1;//Not needed
-            L1_Cachetable[index][new_block].address = address;
+            record_eviction(L1_Cachetable[set_of(index,new_block)][new_block],tag_of(set_of(index,new_block),new_block));
+            if(dead_block_policy!=DEAD_BLOCK_OFF)
+                dead_block_evicted(L1_Cachetable[set_of(index,new_block)][new_block],tag_of(set_of(index,new_block),new_block));
+            L1_Cachetable[set_of(index,new_block)][new_block].index = index;
+            L1_Cachetable[set_of(index,new_block)][new_block].LRU = lru_counter;
+            mru_way[index] = new_block;
+            set_tag(set_of(index,new_block),new_block,tag);
+            L1_Cachetable[set_of(index,new_block)][new_block].dirty_bit = 1;
+            L1_Cachetable[set_of(index,new_block)][new_block].valid_bit = 1;//Not needed
+            L1_Cachetable[set_of(index,new_block)][new_block].offset = address&(block_size-1);
+            if(dead_block_policy!=DEAD_BLOCK_OFF)
+                dead_block_fill(L1_Cachetable[set_of(index,new_block)][new_block],address);
             status= MISS;
             return status;
         }
         else
         {
 
-            if (L1_Cachetable[index][miss_loop].tag == UNDEFINED )
+            if (L1_Cachetable[set_of(index,miss_loop)][miss_loop].valid_bit==0 )
             {
-                L1_Cachetable[index][miss_loop].tag = tag;
-                L1_Cachetable[index][miss_loop].index=index;
-                L1_Cachetable[index][miss_loop].valid_bit = 1;
-                L1_Cachetable[index][miss_loop].dirty_bit = 1;
-                L1_Cachetable[index][miss_loop].address = address;
-                L1_Cachetable[index][miss_loop].LRU = lru_counter;
+                set_tag(set_of(index,miss_loop),miss_loop,tag);
+                L1_Cachetable[set_of(index,miss_loop)][miss_loop].index=index;
+                L1_Cachetable[set_of(index,miss_loop)][miss_loop].valid_bit = 1;
+                L1_Cachetable[set_of(index,miss_loop)][miss_loop].dirty_bit = 1;
+                L1_Cachetable[set_of(index,miss_loop)][miss_loop].offset = address&(block_size-1);
+                L1_Cachetable[set_of(index,miss_loop)][miss_loop].LRU = lru_counter;
+                mru_way[index] = miss_loop;
+                if(dead_block_policy!=DEAD_BLOCK_OFF)
+                    dead_block_fill(L1_Cachetable[set_of(index,miss_loop)][miss_loop],address);
                 status=MISS;
                 return status;
             }
@@ -204,24 +434,25 @@ hit_miss_policy_t cache_sim::write_Cache(unsigned int address, unsigned long cac
  *
  */
 hit_miss_policy_L1V
-cache_sim::L1_Victim_read_cache(unsigned int address, unsigned long cache_l1_size, unsigned long associativity,
+cache_sim::L1_Victim_read_cache(unsigned long address, unsigned long cache_l1_size, unsigned long associativity,
                                 unsigned long block_size)
 {
     unsigned long index = get_index(address,cache_l1_size,associativity,block_size);
     unsigned long long tag = get_tag(address,cache_l1_size,associativity,block_size);
+    map_ways(address,cache_l1_size,associativity,block_size);
     //unsigned long offset = get_block_offset(address);
+    evicted_valid=false;
+    bypassed=false;
 
 
 
-    for (unsigned hit_loop = 0; hit_loop < associativity; hit_loop++)
+    //Case-0:if L1 hit do nothing return HIT
+    int hit_way = find_way(index,tag,associativity);
+    if (hit_way >= 0)
     {
-        //Case-0:if L1 hit do nothing return HIT
-        if (L1_Cachetable[index][hit_loop].tag == tag && L1_Cachetable[index][hit_loop].valid_bit == 1)
-        {
-            L1_Cachetable[index][hit_loop].LRU = lru_counter;//Accessed
-            L1_V_status = R_L1_HIT;
-            return L1_V_status;
-        }
+        L1_Cachetable[set_of(index,hit_way)][hit_way].LRU = lru_counter;//Accessed
+        L1_V_status = R_L1_HIT;
+        return L1_V_status;
     }
 
 
@@ -234,7 +465,7 @@ cache_sim::L1_Victim_read_cache(unsigned int address, unsigned long cache_l1_siz
 
                      for(unsigned victim_hit_loop=0;victim_hit_loop<victim_block_size;victim_hit_loop++)
                      {
-                         if (victim_Cache[victim_hit_loop].tag == tag) {
+                         if (victim_tags[victim_hit_loop]==tag && victim_Cache[victim_hit_loop].valid_bit == 1) {
                              L1_V_status=R_L1_MISS_BUT_VICTIM_HIT_SWAPPED;
                              swap_with_victim(index, associativity,victim_hit_loop);
                              swap_requests++;
@@ -249,14 +480,15 @@ cache_sim::L1_Victim_read_cache(unsigned int address, unsigned long cache_l1_siz
         {
             //Case 1-if L1 is empty
                     //->push block to L1
-            if (L1_Cachetable[index][miss_loop_L1].tag == UNDEFINED  && L1_Cachetable[index][miss_loop_L1].valid_bit==0 )//L1 is empty
+            if (L1_Cachetable[set_of(index,miss_loop_L1)][miss_loop_L1].valid_bit==0 )//L1 is empty
             {
-                L1_Cachetable[index][miss_loop_L1].tag = tag;
-                L1_Cachetable[index][miss_loop_L1].index=index;
-                L1_Cachetable[index][miss_loop_L1].valid_bit = 1;
-                L1_Cachetable[index][miss_loop_L1].dirty_bit = 0;
-                L1_Cachetable[index][miss_loop_L1].address = address;
-                L1_Cachetable[index][miss_loop_L1].LRU = lru_counter;
+                set_tag(set_of(index,miss_loop_L1),miss_loop_L1,tag);
+                L1_Cachetable[set_of(index,miss_loop_L1)][miss_loop_L1].index=index;
+                L1_Cachetable[set_of(index,miss_loop_L1)][miss_loop_L1].valid_bit = 1;
+                L1_Cachetable[set_of(index,miss_loop_L1)][miss_loop_L1].dirty_bit = 0;
+                L1_Cachetable[set_of(index,miss_loop_L1)][miss_loop_L1].offset = address&(block_size-1);
+                L1_Cachetable[set_of(index,miss_loop_L1)][miss_loop_L1].LRU = lru_counter;
+                mru_way[index] = miss_loop_L1;
                 L1_V_status=R_L1_MISS_L1_EMPTY_REPLACED;
                 return L1_V_status;
 
@@ -269,50 +501,57 @@ cache_sim::L1_Victim_read_cache(unsigned int address, unsigned long cache_l1_siz
                                                 //-> replace the newly evicted block from L1 in Victim
                                             //else
                                                 //->if victim is not full just replace the block;
-            if(L1_Cachetable[index][miss_loop_L1].tag!=UNDEFINED && L1_Cachetable[index][miss_loop_L1].valid_bit==1 && Cache_index_is_Full(index,associativity))
+            if(L1_Cachetable[set_of(index,miss_loop_L1)][miss_loop_L1].valid_bit==1 && Cache_index_is_Full(index,associativity))
             {
 
                 unsigned L1_evict_block_id = evict_blocK(index, associativity);
-                for(int i=0;i<victim_block_size;i++) {
+                for(unsigned i=0;i<victim_block_size;i++) {
                     //Place available in Victim
-                            if(victim_Cache[i].tag==UNDEFINED)
+                            if(victim_Cache[i].valid_bit==0)
                             {
-                                victim_Cache[i].tag = L1_Cachetable[index][L1_evict_block_id].tag;
+                                victim_tags[i] = tag_of(set_of(index,L1_evict_block_id),L1_evict_block_id);
                                 victim_Cache[i].LRU =lru_counter;
-                                victim_Cache[i].valid_bit = L1_Cachetable[index][L1_evict_block_id].valid_bit;
-                                victim_Cache[i].dirty_bit = L1_Cachetable[index][L1_evict_block_id].dirty_bit;
-                                victim_Cache[i].address = L1_Cachetable[index][L1_evict_block_id].address;
+                                victim_Cache[i].valid_bit = L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].valid_bit;
+                                victim_Cache[i].dirty_bit = L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].dirty_bit;
+                                victim_Cache[i].offset = L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].offset;
+                                victim_Cache[i].index = L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].index;
                                // sort_Victim();
                                 //Dont forget to replace the new block in L1
-                                L1_Cachetable[index][L1_evict_block_id].tag=tag;
-                                L1_Cachetable[index][L1_evict_block_id].LRU=lru_counter;
-                                L1_Cachetable[index][L1_evict_block_id].valid_bit=1;
-                                L1_Cachetable[index][L1_evict_block_id].dirty_bit=0;
-                                L1_Cachetable[index][L1_evict_block_id].address=address;
+                                set_tag(set_of(index,L1_evict_block_id),L1_evict_block_id,tag);
+                                L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].index=index;
+                                L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].LRU=lru_counter;
+                                mru_way[index] = L1_evict_block_id;
+                                L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].valid_bit=1;
+                                L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].dirty_bit=0;
+                                L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].offset = address&(block_size-1);
                                 L1_V_status=R_L1_FULL_VICTIM_EMPTY_EVICTED2VICTIM_L1_REPLACED;
                                 return L1_V_status;
                             }
                     //Victim full
-                            if(victim_Cache[i].tag!=UNDEFINED && no_empty_blocks_in_victim())
+                            if(victim_Cache[i].valid_bit==1 && no_empty_blocks_in_victim())
                             {
                                 unsigned victim_block_to_be_evicted=evict_block_from_victim();
+                                record_eviction(victim_Cache[victim_block_to_be_evicted],victim_tags[victim_block_to_be_evicted]);
                                 if(victim_Cache[victim_block_to_be_evicted].dirty_bit==1)
                                 {
                                     evict_count++;
                                 }
-                                victim_Cache[victim_block_to_be_evicted].tag = L1_Cachetable[index][L1_evict_block_id].tag;
+                                victim_tags[victim_block_to_be_evicted] = tag_of(set_of(index,L1_evict_block_id),L1_evict_block_id);
                                 victim_Cache[victim_block_to_be_evicted].LRU = lru_counter;
-                                victim_Cache[victim_block_to_be_evicted].valid_bit = L1_Cachetable[index][L1_evict_block_id].valid_bit;
-                                victim_Cache[victim_block_to_be_evicted].dirty_bit = L1_Cachetable[index][L1_evict_block_id].dirty_bit;
-                                victim_Cache[victim_block_to_be_evicted].address = L1_Cachetable[index][L1_evict_block_id].address;
+                                victim_Cache[victim_block_to_be_evicted].valid_bit = L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].valid_bit;
+                                victim_Cache[victim_block_to_be_evicted].dirty_bit = L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].dirty_bit;
+                                victim_Cache[victim_block_to_be_evicted].offset = L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].offset;
+                                victim_Cache[victim_block_to_be_evicted].index = L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].index;
                                // sort_Victim();
                                 swap_requests++;
                                 //dont forget to replace the new block in L1
-                                L1_Cachetable[index][L1_evict_block_id].tag=tag;
-                                L1_Cachetable[index][L1_evict_block_id].LRU=lru_counter;
-                                L1_Cachetable[index][L1_evict_block_id].valid_bit=1;
-                                L1_Cachetable[index][L1_evict_block_id].dirty_bit=0;
-                                L1_Cachetable[index][L1_evict_block_id].address=address;
+                                set_tag(set_of(index,L1_evict_block_id),L1_evict_block_id,tag);
+                                L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].index=index;
+                                L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].LRU=lru_counter;
+                                mru_way[index] = L1_evict_block_id;
+                                L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].valid_bit=1;
+                                L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].dirty_bit=0;
+                                L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].offset = address&(block_size-1);
                                 L1_V_status=R_L1_FULL_VICTIM_FULL_EVICTEDFROMVICTIM_L1_REPLACED;
                                 return L1_V_status;
                             }
@@ -333,27 +572,28 @@ cache_sim::L1_Victim_read_cache(unsigned int address, unsigned long cache_l1_siz
  */
 
 hit_miss_policy_L1V
-cache_sim::L1_Victim_write_cache(unsigned int address, unsigned long cache_l1_size, unsigned long associativity,
+cache_sim::L1_Victim_write_cache(unsigned long address, unsigned long cache_l1_size, unsigned long associativity,
                                 unsigned long block_size)
 {
     unsigned long index = get_index(address,cache_l1_size,associativity,block_size);
     unsigned long long tag = get_tag(address,cache_l1_size,associativity,block_size);
+    map_ways(address,cache_l1_size,associativity,block_size);
     //unsigned long offset = get_block_offset(address);
+    evicted_valid=false;
+    bypassed=false;
 
 
 
-    for (unsigned hit_loop = 0; hit_loop < associativity; hit_loop++)
+    //Case-0:if L1 hit do nothing return HIT
+    int hit_way = find_way(index,tag,associativity);
+    if (hit_way >= 0)
     {
-        //Case-0:if L1 hit do nothing return HIT
-        if (L1_Cachetable[index][hit_loop].tag == tag && L1_Cachetable[index][hit_loop].valid_bit == 1)
-        {
-            L1_Cachetable[index][hit_loop].LRU = lru_counter;//Accessed
+        L1_Cachetable[set_of(index,hit_way)][hit_way].LRU = lru_counter;//Accessed
 
-            L1_Cachetable[index][hit_loop].dirty_bit=1;
+        L1_Cachetable[set_of(index,hit_way)][hit_way].dirty_bit=1;
 
-            L1_V_status = W_L1_HIT;
-            return L1_V_status;
-        }
+        L1_V_status = W_L1_HIT;
+        return L1_V_status;
     }
 
 
@@ -366,7 +606,7 @@ cache_sim::L1_Victim_write_cache(unsigned int address, unsigned long cache_l1_si
         //sort_Victim();
         for(unsigned victim_hit_loop=0;victim_hit_loop<victim_block_size;victim_hit_loop++)
         {
-            if (victim_Cache[victim_hit_loop].tag == tag ) {
+            if (victim_tags[victim_hit_loop]==tag && victim_Cache[victim_hit_loop].valid_bit == 1) {
                 L1_V_status=W_L1_MISS_BUT_VICTIM_HIT_SWAPPED;
                 swap_with_victim(index, associativity,victim_hit_loop);
                 swap_requests++;
@@ -382,14 +622,15 @@ cache_sim::L1_Victim_write_cache(unsigned int address, unsigned long cache_l1_si
         {
             //Case 1-if L1 is empty
             //->push block to L1
-            if (L1_Cachetable[index][miss_loop_L1].tag == UNDEFINED  && L1_Cachetable[index][miss_loop_L1].valid_bit==0 )//L1 is empty
+            if (L1_Cachetable[set_of(index,miss_loop_L1)][miss_loop_L1].valid_bit==0 )//L1 is empty
             {
-                L1_Cachetable[index][miss_loop_L1].tag = tag;
-                L1_Cachetable[index][miss_loop_L1].index=index;
-                L1_Cachetable[index][miss_loop_L1].valid_bit = 1;
-                L1_Cachetable[index][miss_loop_L1].dirty_bit = 1;
-                L1_Cachetable[index][miss_loop_L1].address = address;
-                L1_Cachetable[index][miss_loop_L1].LRU = lru_counter;
+                set_tag(set_of(index,miss_loop_L1),miss_loop_L1,tag);
+                L1_Cachetable[set_of(index,miss_loop_L1)][miss_loop_L1].index=index;
+                L1_Cachetable[set_of(index,miss_loop_L1)][miss_loop_L1].valid_bit = 1;
+                L1_Cachetable[set_of(index,miss_loop_L1)][miss_loop_L1].dirty_bit = 1;
+                L1_Cachetable[set_of(index,miss_loop_L1)][miss_loop_L1].offset = address&(block_size-1);
+                L1_Cachetable[set_of(index,miss_loop_L1)][miss_loop_L1].LRU = lru_counter;
+                mru_way[index] = miss_loop_L1;
                 L1_V_status=W_L1_MISS_L1_EMPTY_REPLACED;
                 return L1_V_status;
 
@@ -402,52 +643,59 @@ cache_sim::L1_Victim_write_cache(unsigned int address, unsigned long cache_l1_si
             //-> replace the newly evicted block from L1 in Victim
             //else
             //->if victim is not full just replace the block;
-            if(L1_Cachetable[index][miss_loop_L1].tag!=UNDEFINED && L1_Cachetable[index][miss_loop_L1].valid_bit==1 && Cache_index_is_Full(index,associativity))
+            if(L1_Cachetable[set_of(index,miss_loop_L1)][miss_loop_L1].valid_bit==1 && Cache_index_is_Full(index,associativity))
             {
                 //sort_Victim();
 
                 unsigned L1_evict_block_id = evict_blocK(index, associativity);
-                for(int i=0;i<victim_block_size;i++) {
+                for(unsigned i=0;i<victim_block_size;i++) {
                     //Place available in Victim
-                    if(victim_Cache[i].tag==UNDEFINED)
+                    if(victim_Cache[i].valid_bit==0)
                     {
-                        victim_Cache[i].tag = L1_Cachetable[index][L1_evict_block_id].tag;
+                        victim_tags[i] = tag_of(set_of(index,L1_evict_block_id),L1_evict_block_id);
                         victim_Cache[i].LRU = lru_counter;
-                        victim_Cache[i].valid_bit = L1_Cachetable[index][L1_evict_block_id].valid_bit;
-                        victim_Cache[i].dirty_bit = L1_Cachetable[index][L1_evict_block_id].dirty_bit;
-                        victim_Cache[i].address = L1_Cachetable[index][L1_evict_block_id].address;
+                        victim_Cache[i].valid_bit = L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].valid_bit;
+                        victim_Cache[i].dirty_bit = L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].dirty_bit;
+                        victim_Cache[i].offset = L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].offset;
+                        victim_Cache[i].index = L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].index;
                         swap_requests++;
                        // sort_Victim();
                         //Dont forget to replace the new block in L1
-                        L1_Cachetable[index][L1_evict_block_id].tag=tag;
-                        L1_Cachetable[index][L1_evict_block_id].LRU=lru_counter;
-                        L1_Cachetable[index][L1_evict_block_id].valid_bit=1;
-                        L1_Cachetable[index][L1_evict_block_id].dirty_bit=1;
-                        L1_Cachetable[index][L1_evict_block_id].address=address;
+                        set_tag(set_of(index,L1_evict_block_id),L1_evict_block_id,tag);
+                        L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].index=index;
+                        L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].LRU=lru_counter;
+                        mru_way[index] = L1_evict_block_id;
+                        L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].valid_bit=1;
+                        L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].dirty_bit=1;
+                        L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].offset = address&(block_size-1);
                         L1_V_status=W_L1_FULL_VICTIM_EMPTY_EVICTED2VICTIM_L1_REPLACED;
                         return L1_V_status;
                     }
                     //Victim full
-                    if(victim_Cache[i].tag!=UNDEFINED  && no_empty_blocks_in_victim())
+                    if(victim_Cache[i].valid_bit==1  && no_empty_blocks_in_victim())
                     {
                         unsigned evict_index_from_victim=evict_block_from_victim();
+                        record_eviction(victim_Cache[evict_index_from_victim],victim_tags[evict_index_from_victim]);
                         if(victim_Cache[evict_index_from_victim].dirty_bit==1)
                         {
                             evict_count++;
                         }
-                        victim_Cache[evict_index_from_victim].tag = L1_Cachetable[index][L1_evict_block_id].tag;
+                        victim_tags[evict_index_from_victim] = tag_of(set_of(index,L1_evict_block_id),L1_evict_block_id);
                         victim_Cache[evict_index_from_victim].LRU =lru_counter;
-                        victim_Cache[evict_index_from_victim].valid_bit = L1_Cachetable[index][L1_evict_block_id].valid_bit;
-                        victim_Cache[evict_index_from_victim].dirty_bit = L1_Cachetable[index][L1_evict_block_id].dirty_bit;
-                        victim_Cache[evict_index_from_victim].address = L1_Cachetable[index][L1_evict_block_id].address;
+                        victim_Cache[evict_index_from_victim].valid_bit = L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].valid_bit;
+                        victim_Cache[evict_index_from_victim].dirty_bit = L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].dirty_bit;
+                        victim_Cache[evict_index_from_victim].offset = L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].offset;
+                        victim_Cache[evict_index_from_victim].index = L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].index;
                         swap_requests++;
                         //sort_Victim();
                         //dont forget to replace the new block in L1
-                        L1_Cachetable[index][L1_evict_block_id].tag=tag;
-                        L1_Cachetable[index][L1_evict_block_id].LRU=lru_counter;
-                        L1_Cachetable[index][L1_evict_block_id].valid_bit=1;
-                        L1_Cachetable[index][L1_evict_block_id].dirty_bit=1;
-                        L1_Cachetable[index][L1_evict_block_id].address=address;
+                        set_tag(set_of(index,L1_evict_block_id),L1_evict_block_id,tag);
+                        L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].index=index;
+                        L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].LRU=lru_counter;
+                        mru_way[index] = L1_evict_block_id;
+                        L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].valid_bit=1;
+                        L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].dirty_bit=1;
+                        L1_Cachetable[set_of(index,L1_evict_block_id)][L1_evict_block_id].offset = address&(block_size-1);
                         L1_V_status=W_L1_FULL_VICTIM_FULL_EVICTEDFROMVICTIM_L1_REPLACED;
                         return L1_V_status;
                     }
@@ -473,8 +721,8 @@ cache_sim::L1_Victim_write_cache(unsigned int address, unsigned long cache_l1_si
 unsigned int cache_sim::evict_block_from_victim()
 {
     int block=0;//taking block as 0
-    unsigned  min_blk_timestamp= numeric_limits<unsigned >::max();
-    for(int i=0;i<victim_block_size;i++)
+    unsigned long min_blk_timestamp= numeric_limits<unsigned long>::max();
+    for(unsigned i=0;i<victim_block_size;i++)
     {
 
         if(victim_Cache[i].LRU<min_blk_timestamp)
@@ -489,13 +737,17 @@ unsigned int cache_sim::evict_block_from_victim()
 unsigned int cache_sim::evict_blocK(unsigned int index, unsigned long associativity)
 {
     int block=0;//taking block as 0
-  unsigned  min_blk_timestamp= numeric_limits<unsigned >::max();
-    for(int i=0;i<associativity;i++)
+  unsigned long min_blk_timestamp= numeric_limits<unsigned long>::max();
+    if(dead_block_policy!=DEAD_BLOCK_OFF)
+    {
+        return dead_block_victim(index,associativity);
+    }
+    for(unsigned i=0;i<associativity;i++)
     {
 
-        if(L1_Cachetable[index][i].LRU<min_blk_timestamp)
+        if(L1_Cachetable[set_of(index,i)][i].LRU<min_blk_timestamp)
         {
-            min_blk_timestamp=L1_Cachetable[index][i].LRU;
+            min_blk_timestamp=L1_Cachetable[set_of(index,i)][i].LRU;
             block=i;
         }
     }
@@ -504,34 +756,34 @@ unsigned int cache_sim::evict_blocK(unsigned int index, unsigned long associativ
 
 void cache_sim::swap_with_victim(unsigned int index, unsigned int assoc,unsigned victimblock)
 {
-    vector<vector<L1_block>> hold_Cache;
-    hold_Cache=L1_Cachetable;
-
-
     int lru_block=0;//taking block as 0
-    unsigned  min_blk_timestamp= numeric_limits<unsigned >::max();
-    for(int i=0;i<assoc;i++)
+    unsigned long min_blk_timestamp= numeric_limits<unsigned long>::max();
+    for(unsigned i=0;i<assoc;i++)
     {
 
-        if(L1_Cachetable[index][i].LRU<min_blk_timestamp)
+        if(L1_Cachetable[set_of(index,i)][i].LRU<min_blk_timestamp)
         {
-            min_blk_timestamp=L1_Cachetable[index][i].LRU;
+            min_blk_timestamp=L1_Cachetable[set_of(index,i)][i].LRU;
             lru_block=i;
         }
     }
-    L1_Cachetable[index][lru_block].tag = victim_Cache[victimblock].tag;
-    L1_Cachetable[index][lru_block].LRU = lru_counter;
-    L1_Cachetable[index][lru_block].valid_bit = victim_Cache[victimblock].valid_bit;
-    L1_Cachetable[index][lru_block].dirty_bit = victim_Cache[victimblock].dirty_bit;
-    L1_Cachetable[index][lru_block].address = victim_Cache[victimblock].address;
-    L1_Cachetable[index][lru_block].index = victim_Cache[victimblock].index;
+    //only the replaced block has to survive the swap, no need to copy the whole table
+    L1_block hold_block=L1_Cachetable[set_of(index,lru_block)][lru_block];
+    unsigned long hold_tag=tag_of(set_of(index,lru_block),lru_block);
+    set_tag(set_of(index,lru_block),lru_block,victim_tags[victimblock]);
+    L1_Cachetable[set_of(index,lru_block)][lru_block].LRU = lru_counter;
+    mru_way[index] = lru_block;
+    L1_Cachetable[set_of(index,lru_block)][lru_block].valid_bit = victim_Cache[victimblock].valid_bit;
+    L1_Cachetable[set_of(index,lru_block)][lru_block].dirty_bit = victim_Cache[victimblock].dirty_bit;
+    L1_Cachetable[set_of(index,lru_block)][lru_block].offset = victim_Cache[victimblock].offset;
+    L1_Cachetable[set_of(index,lru_block)][lru_block].index = victim_Cache[victimblock].index;
     ///////////////////////////
     unsigned lru_victim_block=evict_block_from_victim();
-    victim_Cache[lru_victim_block].index = hold_Cache[index][lru_block].index;
-    victim_Cache[lru_victim_block].tag = hold_Cache[index][lru_block].tag;
-    victim_Cache[lru_victim_block].valid_bit = hold_Cache[index][lru_block].valid_bit;
-    victim_Cache[lru_victim_block].dirty_bit = hold_Cache[index][lru_block].dirty_bit;
-    victim_Cache[lru_victim_block].address = hold_Cache[index][lru_block].address;
+    victim_Cache[lru_victim_block].index = hold_block.index;
+    victim_tags[lru_victim_block] = hold_tag;
+    victim_Cache[lru_victim_block].valid_bit = hold_block.valid_bit;
+    victim_Cache[lru_victim_block].dirty_bit = hold_block.dirty_bit;
+    victim_Cache[lru_victim_block].offset = hold_block.offset;
     victim_Cache[lru_victim_block].LRU = lru_counter;
 
         ////////////////
@@ -542,9 +794,17 @@ void cache_sim::sort_Victim()
 
 {
     if(!victim_Cache.empty()) {
-
-        std::sort(victim_Cache.begin(), victim_Cache.end(),
-                  [](const L1 &left, const L1 &right) { return (left.LRU < right.LRU); });
+        //the tags live apart from the blocks and have to move with them
+        vector<pair<L1_block,unsigned long>> entries;
+        for(unsigned i=0;i<victim_Cache.size();i++)
+            entries.push_back(make_pair(victim_Cache[i],victim_tags[i]));
+        std::sort(entries.begin(), entries.end(),
+                  [](const pair<L1_block,unsigned long> &left, const pair<L1_block,unsigned long> &right) { return (left.first.LRU < right.first.LRU); });
+        for(unsigned i=0;i<entries.size();i++)
+        {
+            victim_Cache[i]=entries[i].first;
+            victim_tags[i]=entries[i].second;
+        }
     }
 }
 
@@ -552,7 +812,7 @@ bool cache_sim::Cache_index_is_Full(unsigned int index, unsigned long associativ
 {
     for(unsigned i=0;i<associativity;i++)
     {
-        if(L1_Cachetable[index][i].tag==UNDEFINED && L1_Cachetable[index][i].valid_bit==0)
+        if(L1_Cachetable[set_of(index,i)][i].valid_bit==0)
         {
             return false;
 
@@ -563,9 +823,9 @@ bool cache_sim::Cache_index_is_Full(unsigned int index, unsigned long associativ
 
 bool cache_sim::no_empty_blocks_in_victim()
 {
-    for(int i=0;i<victim_block_size;i++)
+    for(unsigned i=0;i<victim_block_size;i++)
     {
-        if(victim_Cache[i].tag==UNDEFINED)
+        if(victim_Cache[i].valid_bit==0)
         {
             return false;
         }
@@ -573,24 +833,372 @@ bool cache_sim::no_empty_blocks_in_victim()
     return true;
 }
 
+/*
+ * Hit search behind the way predictor: the most recently used way of the set is probed first
+ * and the other ways only when that probe fails, as a way-predicted L1 would
+ * @params::index,tag,associativity
+ * @return way holding the block or -1 on a miss
+ */
+int cache_sim::find_way(unsigned long index, unsigned long tag, unsigned long associativity)
+{
+    way_lookups++;
+    unsigned predicted=mru_way[index];
+    if(L1_Cachetable[set_of(index,predicted)][predicted].valid_bit==1 && tag_of(set_of(index,predicted),predicted)==tag)
+    {
+        first_probe_hits++;
+        return predicted;
+    }
+    for(unsigned way=0;way<associativity;way++)
+    {
+        if(way!=predicted && L1_Cachetable[set_of(index,way)][way].valid_bit==1 && tag_of(set_of(index,way),way)==tag)
+        {
+            second_probe_hits++;
+            mru_way[index]=way;
+            return way;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Rebuilds the block address of a resident block
+ * @params::tag of the block,row of L1_Cachetable it was filled into
+ * @return address of the first byte of the block
+ */
+unsigned long cache_sim::block_address(unsigned long tag, unsigned long row)
+{
+    unsigned int block_offset=log2(block_size_l1);
+    if(index_policy!=INDEX_MODULO)
+    {
+        //hashed policies already keep the whole block address in the tag
+        return tag<<block_offset;
+    }
+    unsigned int index=log2(sets_l1);
+    return ((tag<<index)|row)<<block_offset;
+}
+
+/*
+ * Remembers the block that just left this cache so the level below can receive it
+ */
+void cache_sim::record_eviction(const L1_block &block, unsigned long tag)
+{
+    if(block.valid_bit!=1)
+    {
+        return;
+    }
+    evicted_valid=true;
+    evicted_address=block_address(tag,block.index);
+    evicted_dirty=block.dirty_bit;
+}
+
+/*
+ * Drops the block holding "address" from L1 or the VC without writing it back
+ * @params::address,cache_l1_size,associativity,block_size,set to the dirty bit of the dropped block
+ * @return true if the block was resident
+ */
+bool cache_sim::invalidate_block(unsigned long address, unsigned long cache_l1_size, unsigned long associativity,
+                                 unsigned long block_size, unsigned *was_dirty)
+{
+    unsigned long index = get_index(address,cache_l1_size,associativity,block_size);
+    unsigned long tag = get_tag(address,cache_l1_size,associativity,block_size);
+    map_ways(address,cache_l1_size,associativity,block_size);
+    for(unsigned way=0;way<associativity;way++)
+    {
+        L1_block &block=L1_Cachetable[set_of(index,way)][way];
+        if(block.valid_bit==1 && tag_of(set_of(index,way),way)==tag)
+        {
+            *was_dirty=block.dirty_bit;
+            block=L1_block();
+            return true;
+        }
+    }
+    for(unsigned i=0;i<victim_Cache.size();i++)
+    {
+        if(victim_tags[i]==tag && victim_Cache[i].valid_bit==1 &&
+           (index_policy!=INDEX_MODULO || victim_Cache[i].index==index))
+        {
+            *was_dirty=victim_Cache[i].dirty_bit;
+            victim_Cache[i]=L1_block();
+            victim_Cache[i].LRU=numeric_limits<unsigned long>::max();
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Sets the dirty bit of a resident block, used when a modified block moves up from an exclusive level
+ * @return true if the block was resident
+ */
+bool cache_sim::mark_dirty(unsigned long address, unsigned long cache_l1_size, unsigned long associativity,
+                           unsigned long block_size)
+{
+    unsigned long index = get_index(address,cache_l1_size,associativity,block_size);
+    unsigned long tag = get_tag(address,cache_l1_size,associativity,block_size);
+    map_ways(address,cache_l1_size,associativity,block_size);
+    for(unsigned way=0;way<associativity;way++)
+    {
+        if(L1_Cachetable[set_of(index,way)][way].valid_bit==1 && tag_of(set_of(index,way),way)==tag)
+        {
+            L1_Cachetable[set_of(index,way)][way].dirty_bit=1;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Turns the dead-block predictor on for the read_Cache/write_Cache paths
+ * @params::DEAD_BLOCK_EVICT replaces predicted-dead blocks first, DEAD_BLOCK_BYPASS also skips allocating
+ *          blocks of regions whose blocks die on their first use,log2 of the region size the predictor learns per
+ */
+void cache_sim::set_dead_block_predictor(dead_block_policy_t policy, unsigned region_bits)
+{
+    dead_block_policy=policy;
+    dead_block_region_bits=region_bits;
+    if(policy!=DEAD_BLOCK_OFF)
+    {
+        dead_block_table=vector<dead_block_entry_t>(DEAD_BLOCK_TABLE_SIZE);
+        bypass_shadow=vector<unsigned long>(L1_Cachetable.size(),NO_TAG);
+    }
+}
+
+/*
+ * Returns the predictor entry of the region "address" falls in.
+ * The traces carry no PC, so the address region is the signature
+ */
+cache_sim::dead_block_entry_t &cache_sim::dead_block_entry_of(unsigned long address)
+{
+    unsigned long region=address>>dead_block_region_bits;
+    return dead_block_table[(region^(region>>12)^(region>>24))%DEAD_BLOCK_TABLE_SIZE];
+}
+
+/*
+ * A block is dead once it has seen as many references as the last blocks of its region did
+ */
+bool cache_sim::predict_dead(unsigned long address, unsigned ref_count)
+{
+    dead_block_entry_t &entry=dead_block_entry_of(address);
+    return entry.confidence>=DEAD_BLOCK_CONFIDENT && entry.learned_refs!=0 && ref_count>=entry.learned_refs;
+}
+
+void cache_sim::dead_block_fill(L1_block &block, unsigned long address)
+{
+    block.ref_count=1;
+    block.predicted_dead=0;
+    if(predict_dead(address,block.ref_count))
+    {
+        block.predicted_dead=1;
+        dead_predictions++;
+    }
+}
+
+/*
+ * A reference to a block predicted dead proves the prediction wrong
+ */
+void cache_sim::dead_block_hit(L1_block &block, unsigned long address)
+{
+    if(block.ref_count<0xFFFFF)
+        block.ref_count++;
+    if(block.predicted_dead==1)
+    {
+        dead_mispredictions++;
+        dead_block_entry_of(address).confidence=0;
+        block.predicted_dead=0;
+        return;
+    }
+    if(predict_dead(address,block.ref_count))
+    {
+        block.predicted_dead=1;
+        dead_predictions++;
+    }
+}
+
+/*
+ * Trains the region of a block leaving the cache with the number of references it received
+ */
+void cache_sim::dead_block_evicted(const L1_block &block, unsigned long tag)
+{
+    if(block.valid_bit!=1)
+    {
+        return;
+    }
+    dead_evictions++;
+    if(block.predicted_dead==1)
+    {
+        dead_correct++;
+    }
+    dead_block_entry_t &entry=dead_block_entry_of(block_address(tag,block.index));
+    if(entry.learned_refs==block.ref_count)
+    {
+        if(entry.confidence<DEAD_BLOCK_CONFIDENCE_MAX)
+            entry.confidence++;
+    }
+    else
+    {
+        entry.learned_refs=block.ref_count;
+        entry.confidence=0;
+    }
+}
+
+/*
+ * Decides on a miss whether the block is dead on arrival and should not be allocated.
+ * The last bypassed tag of every set is remembered, missing on it again means the bypass was wrong
+ * @return true if the access bypasses the cache
+ */
+bool cache_sim::dead_block_bypass(unsigned long address, unsigned long index, unsigned long tag)
+{
+    dead_block_entry_t &entry=dead_block_entry_of(address);
+    if(bypass_shadow[index]==tag)
+    {
+        dead_bypass_mispredictions++;
+        bypass_shadow[index]=NO_TAG;
+        entry.confidence=0;
+        return false;
+    }
+    if(entry.learned_refs==1 && entry.confidence>=DEAD_BLOCK_CONFIDENCE_MAX)
+    {
+        bypass_shadow[index]=tag;
+        dead_bypasses++;
+        bypassed=true;
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Replacement with the predictor on: an empty way, else the LRU predicted-dead block, else the LRU block
+ */
+unsigned cache_sim::dead_block_victim(unsigned index, unsigned long associativity)
+{
+    unsigned victim=0;
+    bool victim_dead=false;
+    for(unsigned way=0;way<associativity;way++)
+    {
+        L1_block &block=L1_Cachetable[set_of(index,way)][way];
+        if(block.valid_bit==0)
+        {
+            return way;
+        }
+        bool dead=(block.predicted_dead==1);
+        if((dead && !victim_dead) || (dead==victim_dead && block.LRU<L1_Cachetable[set_of(index,victim)][victim].LRU))
+        {
+            victim=way;
+            victim_dead=dead;
+        }
+    }
+    return victim;
+}
+
+/*
+ * Zeroes every statistic but keeps the cache contents and predictor state, used after warm-up
+ */
+void cache_sim::clear_stats()
+{
+    memory_traffic=0;
+    L1_reads=0;
+    L1_writes=0;
+    L1_read_misses=0;
+    L1_writes_misses=0;
+    swap_requests=0;
+    swap_request_rate=0;
+    swaps=0;
+    L1_VC_miss_rate=0;
+    L2_reads=0;
+    L2_read_misses=0;
+    L2_writes=0;
+    L2_writes_misses=0;
+    L2_miss_rate=0;
+    writebacks_L2=0;
+    total_memory_traffic=0;
+    evict_count=0;
+    dead_predictions=0;
+    dead_correct=0;
+    dead_mispredictions=0;
+    dead_evictions=0;
+    dead_bypasses=0;
+    dead_bypass_mispredictions=0;
+    way_lookups=0;
+    first_probe_hits=0;
+    second_probe_hits=0;
+}
+
+/*
+ * Bytes of simulator state held for this cache: the tables, the packed tags and the predictor state
+ */
+unsigned long cache_sim::footprint_bytes()
+{
+    unsigned long bytes=sizeof(cache_sim)+tags.footprint_bytes();
+    for(unsigned i=0;i<L1_Cachetable.size();i++)
+    {
+        bytes+=sizeof(vector<L1_block>)+L1_Cachetable[i].capacity()*sizeof(L1_block);
+    }
+    bytes+=victim_Cache.capacity()*sizeof(L1_block)+victim_tags.capacity()*sizeof(unsigned long);
+    bytes+=mru_way.capacity()*sizeof(unsigned short)+way_index.capacity()*sizeof(unsigned long);
+    bytes+=dead_block_table.capacity()*sizeof(dead_block_entry_t)+bypass_shadow.capacity()*sizeof(unsigned long);
+    return bytes;
+}
+
+/*
+ * The first-probe hit rate stands in for the energy and latency saved by way prediction,
+ * a mispredicted hit pays a second probe of the remaining ways
+ */
+void cache_sim::print_way_prediction_stats()
+{
+    unsigned long hits=first_probe_hits+second_probe_hits;
+    cout<<"===== Way prediction ====="<<endl;
+    cout<<"a. number of lookups: "<<dec<<way_lookups<<endl;
+    cout<<"b. number of first-probe hits: "<<dec<<first_probe_hits<<endl;
+    cout<<"c. number of second-probe hits: "<<dec<<second_probe_hits<<endl;
+    printf("d. first-probe hit rate: ");
+    printf("%.4f",way_lookups==0?0.0:(double)first_probe_hits/(double)way_lookups);
+    cout<<"\n";
+    printf("e. prediction accuracy on hits: ");
+    printf("%.4f",hits==0?0.0:(double)first_probe_hits/(double)hits);
+    cout<<"\n";
+}
+
+void cache_sim::print_dead_block_stats()
+{
+    unsigned long resolved=dead_correct+dead_mispredictions+dead_bypasses;
+    unsigned long dead_blocks=dead_evictions+dead_bypasses;
+    cout<<"===== Dead-block predictor ====="<<endl;
+    cout<<"a. number of dead predictions: "<<dec<<dead_predictions<<endl;
+    cout<<"b. number of predicted blocks evicted unreferenced: "<<dec<<dead_correct<<endl;
+    cout<<"c. number of predicted blocks referenced again: "<<dec<<dead_mispredictions<<endl;
+    cout<<"d. number of bypasses: "<<dec<<dead_bypasses<<endl;
+    cout<<"e. number of bypassed blocks missed again: "<<dec<<dead_bypass_mispredictions<<endl;
+    printf("f. prediction accuracy: ");
+    printf("%.4f",resolved==0?0.0:(double)(dead_correct+dead_bypasses-dead_bypass_mispredictions)/(double)resolved);
+    cout<<"\n";
+    printf("g. coverage of dead blocks: ");
+    printf("%.4f",dead_blocks==0?0.0:(double)(dead_correct+dead_bypasses)/(double)dead_blocks);
+    cout<<"\n";
+}
+
 void cache_sim::print_CacheTable(unsigned long rows, unsigned long columns)
 {
-    for(int i=0;i<L1_Cachetable.size();i++) {
-        std::sort(L1_Cachetable[i].begin(), L1_Cachetable[i].end(),
-                  [](const L1 &left, const L1 &right) { return (left.LRU > right.LRU); });
+    //ways are listed from MRU to LRU, the table itself keeps its order so the packed tags stay in place
+    vector<vector<unsigned>> order(L1_Cachetable.size());
+    for(unsigned i=0;i<L1_Cachetable.size();i++) {
+        for(unsigned j=0;j<L1_Cachetable[i].size();j++)
+            order[i].push_back(j);
+        std::sort(order[i].begin(), order[i].end(),
+                  [&](unsigned left, unsigned right) { return (L1_Cachetable[i][left].LRU > L1_Cachetable[i][right].LRU); });
     }
 
     //vector<vector<L1_block>>sorted_table(L1_Cachetable.size());
     cout<<"===== L1 contents ====="<<endl;
 //    std::sort(L1_Cachetable.begin(), L1_Cachetable.end(),
 //              [](const L1 &left, const L1 &right) { return (left.LRU < right.LRU); });
-    for(int i=0;i<rows;i++)
+    for(unsigned i=0;i<rows;i++)
     {
         cout<<"set  "<<dec<<i<<": ";
-        for (int j=0;j<columns;j++)
+        for (unsigned j=0;j<columns;j++)
         {
-            cout << " " << hex<<L1_Cachetable[i][j].tag ;
-            if(L1_Cachetable[i][j].dirty_bit==1)
+            unsigned way=order[i][j];
+            cout << " " << hex<<(L1_Cachetable[i][way].valid_bit==1?tag_of(i,way):UNDEFINED) ;
+            if(L1_Cachetable[i][way].dirty_bit==1)
             {
                 cout<<" D ";
             }
@@ -605,7 +1213,10 @@ void cache_sim::print_CacheTable(unsigned long rows, unsigned long columns)
         cout<<"\n===== VC contents ======"<<endl;
        sort_Victim();
         for (int i = victim_Cache.size()-1;i>=0; i--) {
-            cout << hex <<victim_Cache[i].address<< " ";
+            if(victim_Cache[i].valid_bit==1)
+                cout << hex <<(block_address(victim_tags[i],victim_Cache[i].index)|victim_Cache[i].offset)<< " ";
+            else
+                cout << hex <<UNDEFINED<< " ";
         }
     }
     cout<<"\n"<<endl;
@@ -1,9 +1,13 @@
+#ifndef SIM_CACHE_H
+#define SIM_CACHE_H
+
 #include <iostream>
 #include <vector>
 #include "math.h"
 #include <fstream>
 
-#define UNDEFINED 0xFFF
+#define UNDEFINED 0xFFF           //printed for empty blocks
+#define NO_TAG (~0UL)             //wider than any stored tag
 using namespace std;
 
 typedef enum
@@ -31,54 +35,137 @@ typedef enum
 
 }hit_miss_policy_L1V;
 
+/*
+ * Set-index functions for the L1 table.
+ * INDEX_MODULO is the classic low-order bits after the block offset,
+ * the other three spread power-of-two strides over the sets
+ */
+typedef enum
+{
+    INDEX_MODULO,
+    INDEX_XOR_FOLD,      //low index bits XOR-ed with every higher index-wide field
+    INDEX_PRIME_MODULO,  //block address modulo the largest prime <= number of sets
+    INDEX_SKEWED,        //every way uses its own XOR-fold hash (skewed-associative)
+
+}index_policy_t;
+
+/*
+ * Dead-block prediction for the read_Cache/write_Cache paths
+ */
+typedef enum
+{
+    DEAD_BLOCK_OFF,
+    DEAD_BLOCK_EVICT,  //predicted-dead blocks are replaced before the LRU block
+    DEAD_BLOCK_BYPASS, //as above, and blocks predicted dead on arrival are not allocated
+
+}dead_block_policy_t;
+
+#define DEAD_BLOCK_TABLE_SIZE 4096
+#define DEAD_BLOCK_CONFIDENT 2      //confidence needed before a block is predicted dead
+#define DEAD_BLOCK_CONFIDENCE_MAX 3 //confidence needed before a block bypasses the cache
+
+/*
+ * Tags of the L1 table packed at the width the geometry needs: the address bits above the index
+ * and the block offset. The width is first sized for 32-bit addresses and grows the first time a
+ * wider tag is stored, so only traces with 48- or 57-bit addresses pay for the extra bits
+ */
+class tag_store
+{
+    vector<unsigned long> words;
+    unsigned long entries=0;
+    unsigned width=1;
+
+    void widen(unsigned bits);
+public:
+    //"count" tags of "bits" bits, all 0
+    void resize(unsigned long count,unsigned bits);
+    unsigned long get(unsigned long entry) const;
+    void set(unsigned long entry,unsigned long tag);
+    unsigned tag_bits() const { return width; }
+    unsigned long footprint_bytes() const { return words.capacity()*sizeof(unsigned long); }
+};
 
 class cache_sim
         {
         public:
             ofstream outfile;
-            unsigned memory_traffic=0;
-            unsigned L1_reads=0;
-            unsigned L1_writes=0;
-            unsigned L1_read_misses=0;
-            unsigned L1_writes_misses=0;
-            unsigned swap_requests=0;
+            unsigned long memory_traffic=0;
+            unsigned long L1_reads=0;
+            unsigned long L1_writes=0;
+            unsigned long L1_read_misses=0;
+            unsigned long L1_writes_misses=0;
+            unsigned long swap_requests=0;
             unsigned swap_request_rate=0;
-            unsigned swaps=0;
+            unsigned long swaps=0;
             float L1_VC_miss_rate=0;
             //unsigned writebacks_L1_VC=0;
-            unsigned L2_reads=0;
-            unsigned L2_read_misses=0;
-            unsigned L2_writes=0;
-            unsigned L2_writes_misses=0;
-            unsigned L2_miss_rate=0;
-            unsigned writebacks_L2=0;
-            unsigned total_memory_traffic=0;
-
-
-    unsigned evict_count=0;
-    unsigned int lru_counter=0;
+            unsigned long L2_reads=0;
+            unsigned long L2_read_misses=0;
+            unsigned long L2_writes=0;
+            unsigned long L2_writes_misses=0;
+            float L2_miss_rate=0;
+            unsigned long writebacks_L2=0;
+            unsigned long total_memory_traffic=0;
+
+
+    unsigned long evict_count=0;
+    unsigned long lru_counter=0;
+    //set by every access that pushes a valid block out of this cache (out of the VC when one is attached)
+    bool evicted_valid=false;
+    unsigned long evicted_address=0;
+    unsigned evicted_dirty=0;
     unsigned victim_block_size=UNDEFINED;
     //Victim-Cache
     typedef struct L1_block //L1 properties
     {
-        unsigned valid_bit=0;
-        unsigned tag=UNDEFINED;
-        unsigned dirty_bit=0;
-        unsigned LRU=0;
-        unsigned address=UNDEFINED;
-        unsigned index=UNDEFINED;
-
+        //the tag is kept in "tags" (victim_tags for the VC), the flags share one word
+        unsigned valid_bit:1;
+        unsigned dirty_bit:1;
+        unsigned predicted_dead:1;      //dead-block predictor only
+        unsigned ref_count:20;          //references since the fill, dead-block predictor only
+        unsigned index;                 //row the block was filled into
+        unsigned offset;                //offset of the filling access, only listed in the VC contents
+        unsigned long LRU;
+
+        L1_block():valid_bit(0),dirty_bit(0),predicted_dead(0),ref_count(0),index(0),offset(0),LRU(0) {}
     }L1;
 
+    typedef struct dead_block_entry
+    {
+        unsigned learned_refs=0; //references the last evicted block of the region received
+        unsigned confidence=0;
+    }dead_block_entry_t;
+
     hit_miss_policy_L1V L1_V_status;
+    index_policy_t index_policy=INDEX_MODULO;
+    unsigned long prime_sets=0;//only used by INDEX_PRIME_MODULO
+    vector<unsigned long> way_index;//per-way set of the current access, only used by INDEX_SKEWED
+    dead_block_policy_t dead_block_policy=DEAD_BLOCK_OFF;
+    unsigned dead_block_region_bits=12;
+    vector<dead_block_entry_t> dead_block_table;
+    vector<unsigned long> bypass_shadow;//last bypassed tag per set
+    bool bypassed=false;//set when the current access did not allocate
+    unsigned long dead_predictions=0;
+    unsigned long dead_correct=0;
+    unsigned long dead_mispredictions=0;
+    unsigned long dead_evictions=0;
+    unsigned long dead_bypasses=0;
+    unsigned long dead_bypass_mispredictions=0;
+    vector<unsigned short> mru_way;//way predictor, the way of every set probed first
+    unsigned long way_lookups=0;
+    unsigned long first_probe_hits=0;
+    unsigned long second_probe_hits=0;
     vector<vector<L1_block>> L1_Cachetable;///Defining the 2D array
     vector<L1_block> victim_Cache;
+    tag_store tags;                     //tag of way w of row r at r*l1_assoc+w
+    vector<unsigned long> victim_tags;
     unsigned sets_l1;
     unsigned sets_l2;
     unsigned l1_assoc;
     unsigned l2_assoc;
     unsigned cache_size_l1;
     unsigned cache_size_l2;
+    unsigned block_size_l1;
 
 
 
@@ -88,17 +175,25 @@ class cache_sim
     public:
     cache_sim(unsigned long int associativity,unsigned long int l1_size,unsigned long int block_size,unsigned VC_NUM_blocks);
     cache_sim(unsigned assoc_1,unsigned assoc_2, unsigned  l1_size,unsigned  L2_size,unsigned block_size);
-    unsigned long get_tag(unsigned int address, unsigned long cache_l1_size, unsigned long int associativity, unsigned long int block_size);
-    unsigned long get_offset(unsigned int address, unsigned long cache_l1_size, unsigned long int associativity, unsigned long int block_size);
-    unsigned long get_index(unsigned int address,unsigned long int cache_l1_size,unsigned long int associativity,unsigned long int block_size);
+    unsigned long get_tag(unsigned long address, unsigned long cache_l1_size, unsigned long int associativity, unsigned long int block_size);
+    unsigned long get_offset(unsigned long address, unsigned long cache_l1_size, unsigned long int associativity, unsigned long int block_size);
+    unsigned long get_index(unsigned long address,unsigned long int cache_l1_size,unsigned long int associativity,unsigned long int block_size);
+    unsigned long get_way_index(unsigned long address,unsigned way,unsigned long int cache_l1_size,unsigned long int associativity,unsigned long int block_size);
+    void set_index_policy(index_policy_t policy,unsigned long int cache_l1_size,unsigned long int associativity,unsigned long int block_size);
+    void map_ways(unsigned long address,unsigned long int cache_l1_size,unsigned long int associativity,unsigned long int block_size);
+    unsigned long set_of(unsigned long index,unsigned way);
+    unsigned tag_bits_for(unsigned long int cache_l1_size,unsigned long int associativity,unsigned long int block_size);
+    unsigned long tag_of(unsigned long row,unsigned way) { return tags.get(row*l1_assoc+way); }
+    void set_tag(unsigned long row,unsigned way,unsigned long tag) { tags.set(row*l1_assoc+way,tag); }
     unsigned evict_blocK(unsigned index,unsigned long int associativity);
+    int find_way(unsigned long index,unsigned long tag,unsigned long associativity);
     bool Cache_index_is_Full(unsigned index,unsigned long int associativity);
-    hit_miss_policy_L1V L1_Victim_read_cache(unsigned int address, unsigned long cache_l1_size, unsigned long int associativity, unsigned long int block_size);
-    hit_miss_policy_L1V L1_Victim_write_cache(unsigned int address, unsigned long cache_l1_size, unsigned long int associativity, unsigned long int block_size);
-    hit_miss_policy_t read_Cache(unsigned int address, unsigned long cache_l1_size, unsigned long int associativity, unsigned long int block_size);
+    hit_miss_policy_L1V L1_Victim_read_cache(unsigned long address, unsigned long cache_l1_size, unsigned long int associativity, unsigned long int block_size);
+    hit_miss_policy_L1V L1_Victim_write_cache(unsigned long address, unsigned long cache_l1_size, unsigned long int associativity, unsigned long int block_size);
+    hit_miss_policy_t read_Cache(unsigned long address, unsigned long cache_l1_size, unsigned long int associativity, unsigned long int block_size);
     //hit_miss_policy_t read_Cache(unsigned address,unsigned long cache_l1_size,int associativity,long block_size);
     void print_CacheTable(unsigned long int rows,unsigned long int columns);
-    hit_miss_policy_t write_Cache(unsigned int address, unsigned long cache_l1_size, unsigned long int associativity, unsigned long int block_size);
+    hit_miss_policy_t write_Cache(unsigned long address, unsigned long cache_l1_size, unsigned long int associativity, unsigned long int block_size);
     void sort_Victim();
     bool no_empty_blocks_in_victim();
 
@@ -106,6 +201,22 @@ class cache_sim
 
     void swap_with_victim(unsigned index,unsigned assoc,unsigned victim_block);
     unsigned evict_block_from_victim();
+    unsigned long block_address(unsigned long tag,unsigned long row);
+    void record_eviction(const L1_block &block,unsigned long tag);
+    bool invalidate_block(unsigned long address,unsigned long int cache_l1_size,unsigned long int associativity,unsigned long int block_size,unsigned *was_dirty);
+    void set_dead_block_predictor(dead_block_policy_t policy,unsigned region_bits);
+    dead_block_entry_t &dead_block_entry_of(unsigned long address);
+    bool predict_dead(unsigned long address,unsigned ref_count);
+    void dead_block_fill(L1_block &block,unsigned long address);
+    void dead_block_hit(L1_block &block,unsigned long address);
+    void dead_block_evicted(const L1_block &block,unsigned long tag);
+    bool dead_block_bypass(unsigned long address,unsigned long index,unsigned long tag);
+    unsigned dead_block_victim(unsigned index,unsigned long associativity);
+    void print_dead_block_stats();
+    void print_way_prediction_stats();
+    void clear_stats();
+    unsigned long footprint_bytes();
+    bool mark_dirty(unsigned long address,unsigned long int cache_l1_size,unsigned long int associativity,unsigned long int block_size);
 
 
 
@@ -130,12 +241,12 @@ class L1_L2_Cache:public cache_sim
 
      hit_miss_policy_t read_Cache_L1_l2(unsigned address,unsigned long cache_l1_size,int associativity,long block_size);
      hit_miss_policy_t write_Cache_L1_L2(unsigned address,unsigned long cacahe_l1_size,int assocaitiviy,long blocK_size );
-     unsigned get_tag_L2(unsigned int address, unsigned long cache_l2_size, unsigned long int associativity, unsigned long int block_size);
-     unsigned get_index_L2(unsigned int address,unsigned long int cache_l2_size,unsigned long int associativity,unsigned long int block_size);
+     unsigned get_tag_L2(unsigned long address, unsigned long cache_l2_size, unsigned long int associativity, unsigned long int block_size);
+     unsigned get_index_L2(unsigned long address,unsigned long int cache_l2_size,unsigned long int associativity,unsigned long int block_size);
 
 
 
  };
 // Put additional data structures here as per your requirement
 
-
+#endif //SIM_CACHE_H
@@ -0,0 +1,192 @@
+//
+// Created by Sweta Subhra Datta
+//
+#include "tlb_sim.h"
+#include <iostream>
+#include "math.h"
+#include <stdio.h>
+
+using namespace std;
+
+/*
+ * Builds both TLB levels and the walker
+ * @params::tlb parameters,cache hierarchy the walker reads through
+ */
+tlb_sim::tlb_sim(const tlb_params &tlb_config, cache_hierarchy *hierarchy)
+{
+    params=tlb_config;
+    caches=hierarchy;
+    page_offset_bits=log2(params.page_size);
+    //48 bit virtual addresses, 9 bits of VPN resolved per level
+    walk_levels=(48-page_offset_bits+PT_LEVEL_BITS-1)/PT_LEVEL_BITS;
+
+    unsigned long l1_sets=params.l1_entries/params.l1_assoc;
+    unsigned long l2_sets=(params.l2_assoc==0)?0:params.l2_entries/params.l2_assoc;
+    L1_TLB=vector<vector<tlb_entry_t>>(l1_sets,vector<tlb_entry_t>(params.l1_assoc));
+    if(l2_sets!=0)
+    {
+        L2_TLB=vector<vector<tlb_entry_t>>(l2_sets,vector<tlb_entry_t>(params.l2_assoc));
+    }
+}
+
+/*
+ * Translates one trace address: L1 TLB, then L2 TLB, then a page walk
+ * @params::virtual address
+ * @return where the translation was found
+ */
+tlb_status_t tlb_sim::translate(unsigned long address)
+{
+    unsigned long vpn=address>>page_offset_bits;
+    tlb_lru_counter++;
+
+    l1_tlb_accesses++;
+    if(lookup(L1_TLB,vpn))
+    {
+        return L1_TLB_HIT;
+    }
+    l1_tlb_misses++;
+
+    if(!L2_TLB.empty())
+    {
+        l2_tlb_accesses++;
+        translation_cycles+=params.l2_hit_cycles;
+        if(lookup(L2_TLB,vpn))
+        {
+            fill(L1_TLB,vpn);
+            return L2_TLB_HIT;
+        }
+        l2_tlb_misses++;
+    }
+
+    unsigned long cycles=page_walk(vpn);
+    walk_cycles+=cycles;
+    translation_cycles+=cycles;
+    if(!L2_TLB.empty())
+    {
+        fill(L2_TLB,vpn);
+    }
+    fill(L1_TLB,vpn);
+    return TLB_MISS_WALKED;
+}
+
+/*
+ * Searches one TLB level and refreshes the LRU stamp on a hit
+ */
+bool tlb_sim::lookup(vector<vector<tlb_entry_t>> &tlb, unsigned long vpn)
+{
+    unsigned long set=vpn%tlb.size();
+    for(unsigned way=0;way<tlb[set].size();way++)
+    {
+        if(tlb[set][way].valid_bit==1 && tlb[set][way].vpn==vpn)
+        {
+            tlb[set][way].LRU=tlb_lru_counter;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Installs a translation, replacing an invalid entry first and the LRU entry otherwise
+ */
+void tlb_sim::fill(vector<vector<tlb_entry_t>> &tlb, unsigned long vpn)
+{
+    unsigned long set=vpn%tlb.size();
+    unsigned victim=0;
+    for(unsigned way=0;way<tlb[set].size();way++)
+    {
+        if(tlb[set][way].valid_bit==0)
+        {
+            victim=way;
+            break;
+        }
+        if(tlb[set][way].LRU<tlb[set][victim].LRU)
+        {
+            victim=way;
+        }
+    }
+    tlb[set][victim].valid_bit=1;
+    tlb[set][victim].vpn=vpn;
+    tlb[set][victim].LRU=tlb_lru_counter;
+}
+
+/*
+ * Returns the physical address of the page table entry that resolves "vpn" at "level" (0 is the root).
+ * Page table pages are allocated on first use, one 4KB frame per distinct prefix
+ */
+unsigned long tlb_sim::pte_address(unsigned level, unsigned long vpn)
+{
+    unsigned remaining=PT_LEVEL_BITS*(walk_levels-1-level);
+    unsigned long entry=(vpn>>remaining)&((1<<PT_LEVEL_BITS)-1);
+    unsigned long prefix=vpn>>(remaining+PT_LEVEL_BITS);
+    unsigned long key=((unsigned long)level<<56)|prefix;
+    map<unsigned long,unsigned>::iterator frame=page_table_frames.find(key);
+    if(frame==page_table_frames.end())
+    {
+        frame=page_table_frames.insert(make_pair(key,next_frame++)).first;
+    }
+    return PAGE_TABLE_BASE+((unsigned long)frame->second<<12)+entry*PTE_SIZE;
+}
+
+/*
+ * Walks the radix table, sending every PTE read through the data side of the hierarchy
+ * @return cycles spent in the walk
+ */
+unsigned long tlb_sim::page_walk(unsigned long vpn)
+{
+    unsigned long cycles=0;
+    page_walks++;
+    for(unsigned level=0;level<walk_levels;level++)
+    {
+        unsigned long pte=pte_address(level,vpn);
+        bool hit=caches->access(caches->data_entry,pte,false);
+        walk_references++;
+        if(hit)
+        {
+            cycles+=params.walk_hit_cycles;
+        }
+        else
+        {
+            walk_reference_misses++;
+            cycles+=params.walk_miss_cycles;
+        }
+    }
+    return cycles;
+}
+
+/*
+ * Zeroes the statistics, TLB contents and page table stay as they are
+ */
+void tlb_sim::clear_stats()
+{
+    l1_tlb_accesses=0;
+    l1_tlb_misses=0;
+    l2_tlb_accesses=0;
+    l2_tlb_misses=0;
+    page_walks=0;
+    walk_references=0;
+    walk_reference_misses=0;
+    walk_cycles=0;
+    translation_cycles=0;
+}
+
+void tlb_sim::print_stats()
+{
+    cout<<"===== TLB results ====="<<endl;
+    cout<<"page size: "<<dec<<params.page_size<<endl;
+    cout<<"a. number of L1 TLB accesses: "<<dec<<l1_tlb_accesses<<endl;
+    cout<<"b. number of L1 TLB misses: "<<dec<<l1_tlb_misses<<endl;
+    printf("c. L1 TLB miss rate: ");
+    printf("%.4f",l1_tlb_accesses==0?0.0:(double)l1_tlb_misses/(double)l1_tlb_accesses);
+    cout<<"\n";
+    cout<<"d. number of L2 TLB accesses: "<<dec<<l2_tlb_accesses<<endl;
+    cout<<"e. number of L2 TLB misses: "<<dec<<l2_tlb_misses<<endl;
+    printf("f. L2 TLB miss rate: ");
+    printf("%.4f",l2_tlb_accesses==0?0.0:(double)l2_tlb_misses/(double)l2_tlb_accesses);
+    cout<<"\n";
+    cout<<"g. number of page walks: "<<dec<<page_walks<<endl;
+    cout<<"h. number of page table references: "<<dec<<walk_references<<endl;
+    cout<<"i. number of page table references missing L1: "<<dec<<walk_reference_misses<<endl;
+    cout<<"j. total page walk cycles: "<<dec<<walk_cycles<<endl;
+    cout<<"k. total translation cycles: "<<dec<<translation_cycles<<endl;
+}
@@ -0,0 +1,86 @@
+//
+// Created by Sweta Subhra Datta
+//
+#ifndef TLB_SIM_H
+#define TLB_SIM_H
+
+#include <vector>
+#include <map>
+#include "cache_hierarchy.h"
+
+using namespace std;
+
+#define PAGE_SIZE_4K 4096
+#define PAGE_SIZE_2M (2*1024*1024)
+#define PTE_SIZE 8              //bytes per page table entry
+#define PT_LEVEL_BITS 9         //512 entries per page table page
+#define PAGE_TABLE_BASE 0xF0000000 //physical region the page table pages are carved from
+
+typedef enum
+{
+    L1_TLB_HIT,
+    L2_TLB_HIT,
+    TLB_MISS_WALKED,
+
+}tlb_status_t;
+
+class tlb_params
+{
+public:
+    unsigned long int l1_entries=64;
+    unsigned long int l1_assoc=4;
+    unsigned long int l2_entries=1536;
+    unsigned long int l2_assoc=12;
+    unsigned long int page_size=PAGE_SIZE_4K;
+    unsigned long int l2_hit_cycles=7;      //extra cycles of an L1 TLB miss that hits in the L2 TLB
+    unsigned long int walk_hit_cycles=4;    //cost of a page table reference that hits in the first data cache level
+    unsigned long int walk_miss_cycles=100; //cost of a page table reference that misses the first data cache level
+};
+
+/*
+ * Two level TLB with a radix page table walker in front of cache_sim.
+ * Page table references of the walker are issued to the data side of the cache hierarchy,
+ * so translation competes with the trace for cache capacity.
+ */
+class tlb_sim
+{
+public:
+    typedef struct tlb_entry
+    {
+        unsigned valid_bit=0;
+        unsigned long vpn=0;
+        unsigned long LRU=0;
+    }tlb_entry_t;
+
+    unsigned long l1_tlb_accesses=0;
+    unsigned long l1_tlb_misses=0;
+    unsigned long l2_tlb_accesses=0;
+    unsigned long l2_tlb_misses=0;
+    unsigned long page_walks=0;
+    unsigned long walk_references=0;
+    unsigned long walk_reference_misses=0;
+    unsigned long walk_cycles=0;
+    unsigned long translation_cycles=0;
+
+    tlb_params params;
+    unsigned page_offset_bits;
+    unsigned walk_levels;
+    unsigned long tlb_lru_counter=0;
+    vector<vector<tlb_entry_t>> L1_TLB;
+    vector<vector<tlb_entry_t>> L2_TLB;
+    map<unsigned long,unsigned> page_table_frames;//(level,prefix) -> frame of the page table page
+    unsigned next_frame=0;
+
+    cache_hierarchy *caches;
+
+    tlb_sim(const tlb_params &params,cache_hierarchy *caches);
+    tlb_status_t translate(unsigned long address);
+    bool lookup(vector<vector<tlb_entry_t>> &tlb,unsigned long vpn);
+    void fill(vector<vector<tlb_entry_t>> &tlb,unsigned long vpn);
+    unsigned long page_walk(unsigned long vpn);
+    unsigned long pte_address(unsigned level,unsigned long vpn);
+    void clear_stats();
+    void print_stats();
+};
+
+#endif //TLB_SIM_H
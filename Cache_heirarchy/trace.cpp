@@ -0,0 +1,166 @@
+//
+// Created by Sweta Subhra Datta
+//
+#include "trace.h"
+#include "trace_stream.h"
+#include <string.h>
+
+using namespace std;
+
+trace_reader::~trace_reader()
+{
+    delete stream;
+    if(FP != NULL)
+    {
+        fclose(FP);
+    }
+}
+
+/*
+ * Opens a trace and detects its format from the first bytes
+ * @return false if the file cannot be opened
+ */
+bool trace_reader::open(const char *trace_file)
+{
+    FP = fopen(trace_file, "rb");
+    if(FP == NULL)
+    {
+        return false;
+    }
+    char magic[BINARY_TRACE_HEADER_SIZE];
+    size_t magic_size=fread(magic,1,BINARY_TRACE_HEADER_SIZE,FP);
+    if(magic_size==BINARY_TRACE_HEADER_SIZE && memcmp(magic,BINARY_TRACE_MAGIC,8)==0)
+    {
+        binary=true;
+    }
+    else if((magic_size>=2 && memcmp(magic,GZIP_MAGIC,2)==0) || (magic_size>=8 && memcmp(magic,VARINT_TRACE_MAGIC,8)==0))
+    {
+        fclose(FP);
+        FP=NULL;
+        stream=new trace_stream;
+        return stream->open(trace_file);
+    }
+    else
+    {
+        rewind(FP);
+    }
+    return true;
+}
+
+/*
+ * Reads the next record, malformed text lines are skipped
+ * @return false at the end of the trace
+ */
+bool trace_reader::next(char *rw, unsigned long *address)
+{
+    if(stream != NULL)
+    {
+        if(!stream->next(rw,address))
+            return false;
+        records_read++;
+        return true;
+    }
+    if(binary)
+    {
+        unsigned char bytes[BINARY_TRACE_RECORD_SIZE];
+        if(fread(bytes,1,BINARY_TRACE_RECORD_SIZE,FP)!=BINARY_TRACE_RECORD_SIZE)
+        {
+            return false;
+        }
+        unsigned long long word=0;
+        for(int b=BINARY_TRACE_RECORD_SIZE-1;b>=0;b--)
+        {
+            word=(word<<8)|bytes[b];
+        }
+        *rw=(word&BINARY_TRACE_WRITE_BIT)?'w':((word&BINARY_TRACE_FETCH_BIT)?'i':'r');
+        *address=word&~(BINARY_TRACE_WRITE_BIT|BINARY_TRACE_FETCH_BIT);
+        records_read++;
+        return true;
+    }
+    // exported miss streams add the original record index as a third column
+    char line[128];
+    char str[2];
+    while(fgets(line, sizeof(line), FP) != NULL)
+    {
+        if(sscanf(line, "%1s %lx", str, address) == 2)
+        {
+            *rw = str[0];
+            records_read++;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Moves past "records" records without returning them. Binary traces seek, text and
+ * compressed traces are read record by record so malformed lines are not counted
+ * @return number of records actually skipped
+ */
+unsigned long long trace_reader::skip(unsigned long long records)
+{
+    if(binary)
+    {
+        long long end_offset;
+        fseek(FP,0,SEEK_END);
+        end_offset=ftell(FP);
+        unsigned long long available=(end_offset-BINARY_TRACE_HEADER_SIZE)/BINARY_TRACE_RECORD_SIZE-records_read;
+        if(records>available)
+        {
+            records=available;
+        }
+        records_read+=records;
+        fseek(FP,BINARY_TRACE_HEADER_SIZE+records_read*BINARY_TRACE_RECORD_SIZE,SEEK_SET);
+        return records;
+    }
+    char rw;
+    unsigned long address;
+    unsigned long long skipped=0;
+    while(skipped<records && next(&rw,&address))
+    {
+        skipped++;
+    }
+    return skipped;
+}
+
+/*
+ * Reads a whole trace into memory, for runs that replay it several times
+ * @params::trace file,records are appended here
+ * @return false if the file cannot be opened
+ */
+bool load_trace(const char *trace_file, vector<trace_record_t> &records)
+{
+    trace_reader reader;
+    if(!reader.open(trace_file))
+    {
+        return false;
+    }
+    trace_record_t record;
+    while(reader.next(&record.rw,&record.address))
+    {
+        records.push_back(record);
+    }
+    return true;
+}
+
+void write_binary_header(FILE *FP, unsigned long long records)
+{
+    unsigned char header[BINARY_TRACE_HEADER_SIZE];
+    memcpy(header,BINARY_TRACE_MAGIC,8);
+    for(int b=0;b<8;b++)
+    {
+        header[8+b]=(records>>(8*b))&0xFF;
+    }
+    fwrite(header,1,BINARY_TRACE_HEADER_SIZE,FP);
+}
+
+void write_binary_record(FILE *FP, char rw, unsigned long address)
+{
+    unsigned long long word=address|((rw=='w')?BINARY_TRACE_WRITE_BIT:0)|((rw=='i')?BINARY_TRACE_FETCH_BIT:0);
+    unsigned char bytes[BINARY_TRACE_RECORD_SIZE];
+    for(int b=0;b<BINARY_TRACE_RECORD_SIZE;b++)
+    {
+        bytes[b]=(word>>(8*b))&0xFF;
+    }
+    fwrite(bytes,1,BINARY_TRACE_RECORD_SIZE,FP);
+}
@@ -0,0 +1,57 @@
+//
+// Created by Sweta Subhra Datta
+//
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <vector>
+#include <stdio.h>
+
+using namespace std;
+
+/*
+ * One record of a trace, 'r' (load), 'w' (store) or 'i' (instruction fetch) and the byte address
+ */
+typedef struct trace_record
+{
+    unsigned long address;
+    char rw;
+}trace_record_t;
+
+/*
+ * Binary traces: the 8 byte magic, an 8 byte record count (0 if unknown), then one
+ * little-endian 8 byte word per record holding the address with bit 63 set for writes and
+ * bit 62 set for instruction fetches.
+ * Fixed size records let a reader seek straight to any record
+ */
+#define BINARY_TRACE_MAGIC "CSTRACE1"
+#define BINARY_TRACE_HEADER_SIZE 16
+#define BINARY_TRACE_RECORD_SIZE 8
+#define BINARY_TRACE_WRITE_BIT (1ULL<<63)
+#define BINARY_TRACE_FETCH_BIT (1ULL<<62)
+
+class trace_stream;
+
+/*
+ * Sequential reader for text ("r|w|i <hex address> [index]") and binary traces, the format is detected on open.
+ * gzip and delta-varint traces are handed to a trace_stream that decodes them on a helper thread
+ */
+class trace_reader
+{
+public:
+    FILE *FP=NULL;
+    bool binary=false;
+    trace_stream *stream=NULL;
+    unsigned long long records_read=0; //records consumed so far, skipped ones included
+
+    ~trace_reader();
+    bool open(const char *trace_file);
+    bool next(char *rw,unsigned long *address);
+    unsigned long long skip(unsigned long long records);
+};
+
+bool load_trace(const char *trace_file,vector<trace_record_t> &records);
+void write_binary_header(FILE *FP,unsigned long long records);
+void write_binary_record(FILE *FP,char rw,unsigned long address);
+
+#endif //TRACE_H
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "workload_gen.h"
+#include "trace.h"
+#include "trace_stream.h"
+
+/*
+ * Writes a synthetic trace in the "r|w <hex address>" format read by the simulator.
+ *   trace_gen --accesses=N [--seed=S] [--mix=stream:3:1M,zipf:1:64M,...] [--write-ratio=F]
+ *             [--item-size=B] [--stride=B] [--zipf-theta=F] [--base=HEX] [--output=file] [--format=text|binary|varint]
+ *   trace_gen --input=<trace> --format=binary --output=file     converts an existing trace, fetch records included
+ * varint is the compact delta encoding of trace_stream.h, the simulator reads it (and gzip files) directly
+ * The same options and seed always give the same trace
+ */
+int main(int argc,char* argv[])
+{
+    workload_params params;
+    const char *output_file = NULL;
+    const char *input_file = NULL;
+    bool binary = false;
+    bool varint = false;
+    for(int arg=1;arg<argc;arg++)
+    {
+        if(strncmp(argv[arg],"--accesses=",11)==0)
+            params.accesses=strtoull(argv[arg]+11,NULL,10);
+        else if(strncmp(argv[arg],"--seed=",7)==0)
+            params.seed=strtoull(argv[arg]+7,NULL,10);
+        else if(strncmp(argv[arg],"--write-ratio=",14)==0)
+            params.write_ratio=atof(argv[arg]+14);
+        else if(strncmp(argv[arg],"--item-size=",12)==0)
+            params.item_size=parse_size(argv[arg]+12);
+        else if(strncmp(argv[arg],"--stride=",9)==0)
+            params.stride=parse_size(argv[arg]+9);
+        else if(strncmp(argv[arg],"--zipf-theta=",13)==0)
+            params.zipf_theta=atof(argv[arg]+13);
+        else if(strncmp(argv[arg],"--base=",7)==0)
+            params.base=strtoul(argv[arg]+7,NULL,16);
+        else if(strncmp(argv[arg],"--output=",9)==0)
+            output_file=argv[arg]+9;
+        else if(strncmp(argv[arg],"--input=",8)==0)
+            input_file=argv[arg]+8;
+        else if(strcmp(argv[arg],"--format=text")==0)
+            binary=varint=false;
+        else if(strcmp(argv[arg],"--format=binary")==0)
+        {
+            binary=true;
+            varint=false;
+        }
+        else if(strcmp(argv[arg],"--format=varint")==0)
+        {
+            varint=true;
+            binary=false;
+        }
+        else if(strncmp(argv[arg],"--mix=",6)==0)
+        {
+            if(!parse_pattern_mix(argv[arg]+6,&params))
+            {
+                printf("Error: Bad pattern mix %s\n", argv[arg]);
+                exit(EXIT_FAILURE);
+            }
+        }
+        else
+        {
+            printf("Error: Unknown option %s\n", argv[arg]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if(params.item_size<WORKLOAD_WORD_SIZE || (params.item_size&(params.item_size-1))!=0 ||
+       params.zipf_theta<=0 || params.zipf_theta==1.0)
+    {
+        printf("Error: item size must be a power of two >= %d and zipf theta in (0,1) or > 1\n", WORKLOAD_WORD_SIZE);
+        exit(EXIT_FAILURE);
+    }
+
+    FILE *FP = stdout;
+    if(output_file != NULL)
+    {
+        FP = fopen(output_file, "wb");
+        if(FP == NULL)
+        {
+            printf("Error: Unable to open file %s\n", output_file);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    trace_reader input;
+    if(input_file != NULL && !input.open(input_file))
+    {
+        printf("Error: Unable to open file %s\n", input_file);
+        exit(EXIT_FAILURE);
+    }
+    if(binary)
+    {
+        // the count is only known up front for generated traces
+        write_binary_header(FP, input_file == NULL ? params.accesses : 0);
+    }
+    else if(varint)
+    {
+        write_varint_header(FP);
+    }
+    unsigned long previous_address = 0;
+
+    workload_gen generator(params);
+    // records are formatted by hand into a large buffer, printf would dominate the run time
+    static const char hex_digits[]="0123456789abcdef";
+    static char buffer[1<<16];
+    size_t used=0;
+    for(unsigned long long i=0;input_file != NULL || i<params.accesses;i++)
+    {
+        char rw;
+        unsigned long addr;
+        if(input_file == NULL)
+            generator.next(&rw,&addr);
+        else if(!input.next(&rw,&addr))
+            break;
+        if(binary)
+        {
+            write_binary_record(FP,rw,addr);
+            continue;
+        }
+        if(varint)
+        {
+            if(addr>>61)
+            {
+                printf("Error: Address %lx does not fit the varint format\n", addr);
+                exit(EXIT_FAILURE);
+            }
+            write_varint_record(FP,rw,addr,&previous_address);
+            continue;
+        }
+        char digits[16];
+        int n=0;
+        do
+        {
+            digits[n++]=hex_digits[addr&0xF];
+            addr>>=4;
+        }while(addr!=0);
+        if(used+n+3>sizeof(buffer))
+        {
+            fwrite(buffer,1,used,FP);
+            used=0;
+        }
+        buffer[used++]=rw;
+        buffer[used++]=' ';
+        while(n>0)
+        {
+            buffer[used++]=digits[--n];
+        }
+        buffer[used++]='\n';
+    }
+    fwrite(buffer,1,used,FP);
+    if(FP != stdout)
+    {
+        fclose(FP);
+    }
+    return 0;
+}
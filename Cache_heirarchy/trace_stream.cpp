@@ -0,0 +1,298 @@
+//
+// Created by Sweta Subhra Datta
+//
+#include "trace_stream.h"
+#include <string.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace std;
+
+trace_stream::~trace_stream()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping=true;
+    }
+    changed.notify_all();
+    if(helper.joinable())
+    {
+        helper.join();
+    }
+#ifdef HAVE_ZLIB
+    if(gz != NULL)
+    {
+        gzclose((gzFile)gz);
+    }
+#endif
+    if(FP != NULL)
+    {
+        fclose(FP);
+    }
+}
+
+/*
+ * Opens a gzip or delta-varint trace and starts the helper thread decoding it
+ * @return false if the file cannot be read, or is gzip and zlib was not found at build time
+ */
+bool trace_stream::open(const char *trace_file)
+{
+    FP = fopen(trace_file, "rb");
+    if(FP == NULL)
+    {
+        return false;
+    }
+    char magic[2]={0,0};
+    size_t magic_size=fread(magic,1,2,FP);
+    rewind(FP);
+    if(magic_size==2 && memcmp(magic,GZIP_MAGIC,2)==0)
+    {
+#ifdef HAVE_ZLIB
+        fclose(FP);
+        FP = NULL;
+        gz = gzopen(trace_file, "rb");
+        if(gz == NULL)
+        {
+            return false;
+        }
+        gzbuffer((gzFile)gz, TRACE_STREAM_CHUNK_BYTES);
+#else
+        printf("Error: %s is gzip compressed and the simulator was built without zlib\n", trace_file);
+        return false;
+#endif
+    }
+    chunks=vector<vector<trace_record_t> >(TRACE_STREAM_CHUNKS);
+    for(unsigned i=0;i<TRACE_STREAM_CHUNKS;i++)
+    {
+        chunks[i].reserve(TRACE_STREAM_CHUNK_RECORDS);
+        free_chunks.push_back(i);
+    }
+    helper=thread(&trace_stream::decode,this);
+    return true;
+}
+
+/*
+ * Hands out the records the helper decoded, waits for it when the reader has caught up
+ * @return false at the end of the trace
+ */
+bool trace_stream::next(char *rw, unsigned long *address)
+{
+    while(current<0 || position>=chunks[current].size())
+    {
+        unique_lock<mutex> guard(lock);
+        if(current>=0)
+        {
+            free_chunks.push_back(current);
+            current=-1;
+            changed.notify_all();
+        }
+        changed.wait(guard,[this]{return finished || !full_chunks.empty();});
+        if(full_chunks.empty())
+        {
+            return false;
+        }
+        current=full_chunks.front();
+        full_chunks.pop_front();
+        position=0;
+    }
+    *rw=chunks[current][position].rw;
+    *address=chunks[current][position].address;
+    position++;
+    return true;
+}
+
+/*
+ * @return bytes read, 0 at the end of the file
+ */
+size_t trace_stream::read_bytes(unsigned char *buffer, size_t size)
+{
+#ifdef HAVE_ZLIB
+    if(gz != NULL)
+    {
+        int n=gzread((gzFile)gz,buffer,size);
+        return (n<0)?0:n;
+    }
+#endif
+    return fread(buffer,1,size,FP);
+}
+
+/*
+ * Waits for a free record chunk
+ * @return chunk number, -1 once the reader is closed
+ */
+unsigned trace_stream::claim_chunk()
+{
+    unique_lock<mutex> guard(lock);
+    changed.wait(guard,[this]{return stopping || !free_chunks.empty();});
+    if(stopping)
+    {
+        return (unsigned)-1;
+    }
+    unsigned chunk=free_chunks.front();
+    free_chunks.pop_front();
+    chunks[chunk].clear();
+    return chunk;
+}
+
+void trace_stream::publish_chunk(unsigned chunk)
+{
+    lock_guard<mutex> guard(lock);
+    full_chunks.push_back(chunk);
+    changed.notify_all();
+}
+
+/*
+ * Helper thread: fixed-size reads, the bytes of a record split across two reads are carried over
+ */
+void trace_stream::decode()
+{
+    vector<unsigned char> buffer(TRACE_STREAM_CHUNK_BYTES);
+    size_t start=0;
+    size_t end=0;
+    bool eof=false;
+    bool header_checked=false;
+    unsigned chunk=claim_chunk();
+    while(chunk!=(unsigned)-1)
+    {
+        if(!eof)
+        {
+            memmove(&buffer[0],&buffer[start],end-start);
+            end-=start;
+            start=0;
+            size_t n=(end<buffer.size())?read_bytes(&buffer[end],buffer.size()-end):0;
+            eof=(n==0 && end<buffer.size());
+            end+=n;
+        }
+        if(!header_checked)
+        {
+            //a gzip file may hold any of the three formats
+            if(end>=BINARY_TRACE_HEADER_SIZE && memcmp(&buffer[0],BINARY_TRACE_MAGIC,8)==0)
+            {
+                format=STREAM_BINARY;
+                start=BINARY_TRACE_HEADER_SIZE;
+            }
+            else if(end>=8 && memcmp(&buffer[0],VARINT_TRACE_MAGIC,8)==0)
+            {
+                format=STREAM_VARINT;
+                start=8;
+            }
+            header_checked=true;
+        }
+        size_t consumed=decode_records(&buffer[start],end-start,eof,chunks[chunk]);
+        start+=consumed;
+        if(chunks[chunk].size()==TRACE_STREAM_CHUNK_RECORDS)
+        {
+            publish_chunk(chunk);
+            chunk=claim_chunk();
+        }
+        else if(eof)
+        {
+            publish_chunk(chunk);
+            break;
+        }
+        else if(consumed==0 && start==0 && end==buffer.size())
+        {
+            //a text line longer than the whole buffer, it could never parse
+            start=end;
+        }
+    }
+    lock_guard<mutex> guard(lock);
+    finished=true;
+    changed.notify_all();
+}
+
+/*
+ * Decodes complete records until the bytes or the chunk run out
+ * @params::bytes,number of bytes,true if no more bytes follow,records are appended here
+ * @return bytes consumed
+ */
+size_t trace_stream::decode_records(const unsigned char *bytes, size_t size, bool last, vector<trace_record_t> &out)
+{
+    size_t pos=0;
+    trace_record_t record;
+    while(out.size()<TRACE_STREAM_CHUNK_RECORDS && pos<size)
+    {
+        if(format==STREAM_BINARY)
+        {
+            if(size-pos<BINARY_TRACE_RECORD_SIZE)
+                break;
+            unsigned long long word=0;
+            for(int b=BINARY_TRACE_RECORD_SIZE-1;b>=0;b--)
+            {
+                word=(word<<8)|bytes[pos+b];
+            }
+            pos+=BINARY_TRACE_RECORD_SIZE;
+            record.rw=(word&BINARY_TRACE_WRITE_BIT)?'w':((word&BINARY_TRACE_FETCH_BIT)?'i':'r');
+            record.address=word&~(BINARY_TRACE_WRITE_BIT|BINARY_TRACE_FETCH_BIT);
+            out.push_back(record);
+        }
+        else if(format==STREAM_VARINT)
+        {
+            unsigned long long value=0;
+            unsigned shift=0;
+            size_t p=pos;
+            while(p<size && (bytes[p]&0x80))
+            {
+                value|=(unsigned long long)(bytes[p]&0x7F)<<shift;
+                shift+=7;
+                p++;
+            }
+            if(p==size)
+                break;
+            value|=(unsigned long long)bytes[p]<<shift;
+            pos=p+1;
+            static const char types[4]={'r','w','i','r'};
+            record.rw=types[value&3];
+            unsigned long long zigzag=value>>2;
+            long long delta=(long long)(zigzag>>1)^-(long long)(zigzag&1);
+            previous_address+=delta;
+            record.address=previous_address;
+            out.push_back(record);
+        }
+        else
+        {
+            const unsigned char *newline=(const unsigned char*)memchr(bytes+pos,'\n',size-pos);
+            if(newline==NULL && !last)
+                break;
+            size_t length=(newline==NULL)?size-pos:newline-(bytes+pos);
+            char line[128];
+            size_t copied=(length<sizeof(line)-1)?length:sizeof(line)-1;
+            memcpy(line,bytes+pos,copied);
+            line[copied]='\0';
+            pos+=length+(newline!=NULL);
+            char str[2];
+            if(sscanf(line, "%1s %lx", str, &record.address) == 2)
+            {
+                record.rw=str[0];
+                out.push_back(record);
+            }
+        }
+    }
+    return pos;
+}
+
+void write_varint_header(FILE *FP)
+{
+    fwrite(VARINT_TRACE_MAGIC,1,8,FP);
+}
+
+/*
+ * @params::file,'r' 'w' or 'i',address below 2^61,address of the previous record, updated
+ */
+void write_varint_record(FILE *FP, char rw, unsigned long address, unsigned long *previous)
+{
+    long long delta=(long long)(address-*previous);
+    *previous=address;
+    unsigned long long zigzag=((unsigned long long)delta<<1)^(unsigned long long)(delta>>63);
+    unsigned long long value=(zigzag<<2)|((rw=='w')?1:((rw=='i')?2:0));
+    unsigned char bytes[10];
+    int n=0;
+    while(value>=0x80)
+    {
+        bytes[n++]=(value&0x7F)|0x80;
+        value>>=7;
+    }
+    bytes[n++]=value;
+    fwrite(bytes,1,n,FP);
+}
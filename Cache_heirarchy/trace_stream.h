@@ -0,0 +1,76 @@
+//
+// Created by Sweta Subhra Datta
+//
+#ifndef TRACE_STREAM_H
+#define TRACE_STREAM_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <stdio.h>
+#include "trace.h"
+
+using namespace std;
+
+/*
+ * Delta-varint traces: the 8 byte magic, then one LEB128 varint per record holding
+ * zigzag(address - previous address) << 2 | type, type 0 'r', 1 'w', 2 'i'.
+ * Addresses must stay below 2^61. Sequential traces shrink to one or two bytes per record
+ */
+#define VARINT_TRACE_MAGIC "CSTRACEV"
+#define GZIP_MAGIC "\x1f\x8b"
+
+#define TRACE_STREAM_CHUNK_BYTES (1<<20)   //encoded bytes read per step
+#define TRACE_STREAM_CHUNK_RECORDS (1<<16) //records per decoded chunk
+#define TRACE_STREAM_CHUNKS 4              //decoded chunks in flight between the threads
+
+/*
+ * Decodes a compressed trace on a helper thread. The helper reads fixed-size chunks of the file,
+ * inflates them when the file is gzip (zlib builds only) and parses the text, binary or
+ * delta-varint records inside into a small ring of record chunks. Memory does not grow with the trace
+ */
+class trace_stream
+{
+public:
+    ~trace_stream();
+    bool open(const char *trace_file);
+    bool next(char *rw,unsigned long *address);
+
+private:
+    typedef enum
+    {
+        STREAM_TEXT,
+        STREAM_BINARY,
+        STREAM_VARINT,
+
+    }stream_format_t;
+
+    FILE *FP=NULL;
+    void *gz=NULL;                         //gzFile when the file is gzip compressed
+    stream_format_t format=STREAM_TEXT;
+    unsigned long previous_address=0;      //delta-varint decoder state
+
+    thread helper;
+    mutex lock;
+    condition_variable changed;
+    vector<vector<trace_record_t> > chunks;
+    deque<unsigned> free_chunks;
+    deque<unsigned> full_chunks;
+    bool finished=false;                   //the helper published its last chunk
+    bool stopping=false;                   //the reader is closed before the end of the trace
+    int current=-1;                        //chunk being consumed
+    size_t position=0;
+
+    size_t read_bytes(unsigned char *buffer,size_t size);
+    void decode();
+    size_t decode_records(const unsigned char *bytes,size_t size,bool last,vector<trace_record_t> &out);
+    unsigned claim_chunk();
+    void publish_chunk(unsigned chunk);
+};
+
+void write_varint_header(FILE *FP);
+void write_varint_record(FILE *FP,char rw,unsigned long address,unsigned long *previous);
+
+#endif //TRACE_STREAM_H
@@ -0,0 +1,208 @@
+//
+// Created by Sweta Subhra Datta
+//
+#include "workload_gen.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "math.h"
+
+using namespace std;
+
+static const char *pattern_names[NUM_PATTERNS]={"stream","strided","uniform","zipf","chase"};
+
+const char *pattern_name(access_pattern_t pattern)
+{
+    return pattern_names[pattern];
+}
+
+/*
+ * Reads a byte count with an optional K, M or G suffix
+ * @return 0 if the text is not a size
+ */
+unsigned long parse_size(const char *text)
+{
+    char *end;
+    unsigned long size=strtoul(text,&end,10);
+    if(*end=='K' || *end=='k')
+        size<<=10;
+    else if(*end=='M' || *end=='m')
+        size<<=20;
+    else if(*end=='G' || *end=='g')
+        size<<=30;
+    else if(*end!='\0')
+        return 0;
+    return size;
+}
+
+/*
+ * Parses "<pattern>:<weight>[:<footprint>],..." e.g. "stream:3:1M,zipf:1:64M,chase:1".
+ * Patterns that are not listed get weight 0
+ * @return false if an entry is malformed
+ */
+bool parse_pattern_mix(const char *mix, workload_params *params)
+{
+    for(unsigned p=0;p<NUM_PATTERNS;p++)
+    {
+        params->weights[p]=0;
+    }
+    char buffer[256];
+    strncpy(buffer,mix,sizeof(buffer)-1);
+    buffer[sizeof(buffer)-1]='\0';
+    for(char *entry=strtok(buffer,",");entry!=NULL;entry=strtok(NULL,","))
+    {
+        char name[16];
+        char footprint[32]="";
+        unsigned weight=1;
+        if(sscanf(entry,"%15[a-z]:%u:%31s",name,&weight,footprint)<1)
+        {
+            return false;
+        }
+        unsigned p=0;
+        while(p<NUM_PATTERNS && strcmp(name,pattern_names[p])!=0)
+        {
+            p++;
+        }
+        if(p==NUM_PATTERNS)
+        {
+            return false;
+        }
+        params->weights[p]=weight;
+        if(footprint[0]!='\0')
+        {
+            params->footprint[p]=parse_size(footprint);
+            if(params->footprint[p]==0)
+                return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Lays out one region per pattern and precomputes the Zipf constants
+ */
+workload_gen::workload_gen(const workload_params &workload_config)
+{
+    params=workload_config;
+    rng_state=params.seed;
+    unsigned long offset=0;
+    for(unsigned p=0;p<NUM_PATTERNS;p++)
+    {
+        total_weight+=params.weights[p];
+        //power of two item counts keep the scramble and the chase walk bijective
+        items[p]=1;
+        while(items[p]*2*params.item_size<=params.footprint[p])
+        {
+            items[p]*=2;
+        }
+        region[p]=params.base+offset;
+        offset+=items[p]*params.item_size;
+        cursor[p]=0;
+    }
+    if(total_weight==0)
+    {
+        params.weights[PATTERN_STREAM]=1;
+        total_weight=1;
+    }
+
+    //Gray et al. "Quickly generating billion-record synthetic databases": zeta(n) is summed
+    //exactly for the first million ranks and integrated for the tail
+    unsigned long n=items[PATTERN_ZIPF];
+    double theta=params.zipf_theta;
+    unsigned long exact=(n<(1UL<<20))?n:(1UL<<20);
+    for(unsigned long i=1;i<=exact;i++)
+    {
+        zeta_n+=1.0/pow((double)i,theta);
+    }
+    if(n>exact)
+    {
+        zeta_n+=(pow(n+0.5,1.0-theta)-pow(exact+0.5,1.0-theta))/(1.0-theta);
+    }
+    double zeta_2=1.0+1.0/pow(2.0,theta);
+    zipf_alpha=1.0/(1.0-theta);
+    zipf_eta=(1.0-pow(2.0/n,1.0-theta))/(1.0-zeta_2/zeta_n);
+}
+
+/*
+ * splitmix64, the whole trace follows from the seed
+ */
+unsigned long long workload_gen::random()
+{
+    unsigned long long z=(rng_state+=0x9E3779B97F4A7C15ULL);
+    z=(z^(z>>30))*0xBF58476D1CE4E5B9ULL;
+    z=(z^(z>>27))*0x94D049BB133111EBULL;
+    return z^(z>>31);
+}
+
+double workload_gen::random_unit()
+{
+    return (random()>>11)*(1.0/9007199254740992.0);
+}
+
+/*
+ * @return rank of the next Zipf item, 0 is the hottest
+ */
+unsigned long workload_gen::zipf_rank()
+{
+    unsigned long n=items[PATTERN_ZIPF];
+    double u=random_unit();
+    double uz=u*zeta_n;
+    if(uz<1.0)
+        return 0;
+    if(uz<1.0+pow(0.5,params.zipf_theta))
+        return 1;
+    unsigned long rank=(unsigned long)(n*pow(zipf_eta*u-zipf_eta+1.0,zipf_alpha));
+    return (rank>=n)?n-1:rank;
+}
+
+/*
+ * Bijection on [0,count) for a power of two count, so hot ranks and chase nodes
+ * are spread over the region instead of being adjacent
+ */
+unsigned long workload_gen::scramble(unsigned long item, unsigned long count)
+{
+    unsigned long mask=count-1;
+    item=(item*0x9E3779B97F4A7C15ULL)&mask;
+    item^=item>>7;
+    item=(item*0xBF58476D1CE4E5B9ULL)&mask;
+    return item;
+}
+
+/*
+ * Produces the next record
+ * @params::set to 'r' or 'w',set to the address
+ */
+void workload_gen::next(char *rw, unsigned long *address)
+{
+    unsigned pick=random()%total_weight;
+    unsigned p=0;
+    while(pick>=params.weights[p])
+    {
+        pick-=params.weights[p];
+        p++;
+    }
+    unsigned long span=items[p]*params.item_size;
+    switch(p)
+    {
+        case PATTERN_STREAM:
+            *address=region[p]+cursor[p];
+            cursor[p]=(cursor[p]+WORKLOAD_WORD_SIZE)&(span-1);
+            break;
+        case PATTERN_STRIDED:
+            *address=region[p]+cursor[p];
+            cursor[p]=(cursor[p]+params.stride)&(span-1);
+            break;
+        case PATTERN_UNIFORM:
+            *address=region[p]+((random()&(span-1))&~(unsigned long)(WORKLOAD_WORD_SIZE-1));
+            break;
+        case PATTERN_ZIPF:
+            *address=region[p]+scramble(zipf_rank(),items[p])*params.item_size;
+            break;
+        default:
+            //full period LCG modulo a power of two: every node once per lap
+            cursor[p]=(cursor[p]*6364136223846793005ULL+1442695040888963407ULL)&(items[p]-1);
+            *address=region[p]+scramble(cursor[p],items[p])*params.item_size;
+            break;
+    }
+    *rw=(random_unit()<params.write_ratio)?'w':'r';
+}
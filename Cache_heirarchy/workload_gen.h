@@ -0,0 +1,70 @@
+//
+// Created by Sweta Subhra Datta
+//
+#ifndef WORKLOAD_GEN_H
+#define WORKLOAD_GEN_H
+
+#include <string>
+
+using namespace std;
+
+/*
+ * Access patterns the synthetic workload mixes
+ */
+typedef enum
+{
+    PATTERN_STREAM,  //sequential words through the footprint
+    PATTERN_STRIDED, //fixed stride through the footprint
+    PATTERN_UNIFORM, //uniformly random words of the footprint
+    PATTERN_ZIPF,    //Zipf distributed items, a few hot items take most accesses
+    PATTERN_CHASE,   //dependent walk visiting every item once per lap in a scrambled order
+
+}access_pattern_t;
+
+#define NUM_PATTERNS 5
+#define WORKLOAD_WORD_SIZE 4
+
+class workload_params
+{
+public:
+    unsigned long long accesses=1000000;
+    unsigned long long seed=1;
+    double write_ratio=0.3;
+    unsigned long int item_size=64;          //granularity of Zipf items and pointer-chase nodes
+    unsigned long int stride=256;
+    double zipf_theta=0.99;                  //skew of the Zipf pattern, must not be 1
+    unsigned long int base=0x10000000;       //address of the first pattern region
+    unsigned weights[NUM_PATTERNS]={1,0,0,0,0};
+    unsigned long int footprint[NUM_PATTERNS]={1<<20,1<<20,1<<20,1<<20,1<<20};//bytes per pattern
+};
+
+/*
+ * Deterministic generator of r/w address records. Every pattern owns its own region,
+ * the state is a few words per pattern so the length of the trace costs no memory
+ */
+class workload_gen
+{
+public:
+    workload_params params;
+    unsigned long long rng_state;
+    unsigned total_weight=0;
+    unsigned long int region[NUM_PATTERNS];
+    unsigned long int items[NUM_PATTERNS];   //footprint in items, a power of two
+    unsigned long int cursor[NUM_PATTERNS];
+    double zeta_n=0;
+    double zipf_alpha=0;
+    double zipf_eta=0;
+
+    workload_gen(const workload_params &params);
+    void next(char *rw,unsigned long *address);
+    unsigned long long random();
+    double random_unit();
+    unsigned long zipf_rank();
+    unsigned long scramble(unsigned long item,unsigned long count);
+};
+
+bool parse_pattern_mix(const char *mix,workload_params *params);
+unsigned long parse_size(const char *text);
+const char *pattern_name(access_pattern_t pattern);
+
+#endif //WORKLOAD_GEN_H
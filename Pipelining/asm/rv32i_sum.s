@@ -0,0 +1,35 @@
+# RV32I test program for load_elf: sums the words of "array" into "total" and copies
+# the array reversed to "reversed". rv32i_sum.elf holds it assembled with llvm-mc -triple=riscv32,
+# the text at 0x10000000 and the data at 0x2000. Addresses are absolute so no relocation is needed
+	.option	norelax
+	.text
+	.globl _start
+_start:
+	li	a0, 0x2000		# array
+	li	a1, 0x2040		# last word of reversed
+	li	t0, 8
+	add	t1, zero, zero
+loop:
+	lw	t2, 0(a0)
+	add	t1, t1, t2
+	sw	t2, 0(a1)
+	addi	a0, a0, 4
+	addi	a1, a1, -4
+	addi	t0, t0, -1
+	bnez	t0, loop
+	lui	a2, 0x2
+	sw	t1, 0x20(a2)		# total
+	xor	a3, t1, a0
+	blt	zero, t1, done
+	jal	ra, loop		# never reached, links ra so it has no equivalent
+done:
+	ecall
+
+	.data
+array:
+	.word	10, 20, 30, 40, 50, 60, 70, 80
+total:
+	.word	0
+	.bss
+reversed:
+	.space	32
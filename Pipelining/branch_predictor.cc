@@ -0,0 +1,191 @@
+#include "branch_predictor.h"
+
+/* =============================================================
+
+   DIRECTION PREDICTORS
+
+   ============================================================= */
+
+//2-bit saturating counters, taken when >= 2
+static inline bool counter_taken(unsigned char counter){
+        return counter >= 2;
+}
+
+static inline void counter_update(unsigned char *counter, bool taken){
+        if (taken && *counter < 3) (*counter)++;
+        else if (!taken && *counter > 0) (*counter)--;
+}
+
+/* instructions are word aligned, the low PC bits carry no information */
+static inline unsigned pc_bits(unsigned pc){
+        return pc >> 2;
+}
+
+bimodal_predictor::bimodal_predictor(unsigned index_bits){
+        //weakly not taken
+        counters.assign(1u << index_bits, 1);
+        mask = (1u << index_bits) - 1;
+}
+
+bool bimodal_predictor::predict(unsigned pc, branch_history_t *history){
+        *history = 0;
+        return counter_taken(counters[pc_bits(pc) & mask]);
+}
+
+void bimodal_predictor::update(unsigned pc, bool taken, branch_history_t history){
+        counter_update(&counters[pc_bits(pc) & mask], taken);
+}
+
+gshare_predictor::gshare_predictor(unsigned index_bits, unsigned history_bits){
+        counters.assign(1u << index_bits, 1);
+        mask = (1u << index_bits) - 1;
+        if (history_bits > index_bits) history_bits = index_bits;
+        history = 0;
+        history_mask = (1u << history_bits) - 1;
+}
+
+bool gshare_predictor::predict(unsigned pc, branch_history_t *history){
+        *history = this->history;
+        return counter_taken(counters[(pc_bits(pc) ^ this->history) & mask]);
+}
+
+/* the counter trained is the one the prediction read, whatever branches resolved since */
+void gshare_predictor::update(unsigned pc, bool taken, branch_history_t history){
+        counter_update(&counters[(pc_bits(pc) ^ (unsigned)history) & mask], taken);
+        this->history = ((this->history << 1) | taken) & history_mask;
+}
+
+/* =============================================================
+
+   TAGE-LITE
+
+   ============================================================= */
+
+static const unsigned tage_history_lengths[tage_predictor::TABLES] = {4, 8, 16, 32};
+static const unsigned TAGE_TAG_BITS = 8;
+//useful counters are halved every so many updates, so stale entries can be replaced
+static const unsigned TAGE_USEFUL_PERIOD = 4096;
+
+/* xor of the "length" most recent outcomes taken "bits" at a time */
+static unsigned fold_history(unsigned long long history, unsigned length, unsigned bits){
+        unsigned long long h = length < 64 ? history & ((1ull << length) - 1) : history;
+        unsigned folded = 0;
+        for (; h != 0; h >>= bits) folded ^= (unsigned)(h & ((1ull << bits) - 1));
+        return folded;
+}
+
+tage_predictor::tage_predictor(unsigned base_bits, unsigned table_bits){
+        base.assign(1u << base_bits, 1);
+        base_mask = (1u << base_bits) - 1;
+        tage_entry_t empty = {0, 0, 0};
+        for (unsigned t = 0; t < TABLES; t++) tables[t].assign(1u << table_bits, empty);
+        this->table_bits = table_bits;
+        table_mask = (1u << table_bits) - 1;
+        history = 0;
+        updates = 0;
+}
+
+unsigned tage_predictor::table_index(unsigned table, unsigned pc, branch_history_t history){
+        return (pc_bits(pc) ^ (pc_bits(pc) >> table_bits) ^ fold_history(history, tage_history_lengths[table], table_bits)) & table_mask;
+}
+
+unsigned short tage_predictor::table_tag(unsigned table, unsigned pc, branch_history_t history){
+        unsigned folded = fold_history(history, tage_history_lengths[table], TAGE_TAG_BITS) ^
+                          (fold_history(history, tage_history_lengths[table], TAGE_TAG_BITS - 1) << 1);
+        return (pc_bits(pc) ^ folded) & ((1u << TAGE_TAG_BITS) - 1);
+}
+
+void tage_predictor::lookup(unsigned pc, branch_history_t history, unsigned *provider, unsigned *alternate){
+        *provider = *alternate = TABLES;
+        for (unsigned t = TABLES; t-- > 0;){
+                if (tables[t][table_index(t, pc, history)].tag != table_tag(t, pc, history)) continue;
+                if (*provider == TABLES) *provider = t;
+                else {
+                        *alternate = t;
+                        return;
+                }
+        }
+}
+
+bool tage_predictor::base_prediction(unsigned pc){
+        return counter_taken(base[pc_bits(pc) & base_mask]);
+}
+
+bool tage_predictor::predict(unsigned pc, branch_history_t *history){
+        unsigned provider, alternate;
+        *history = this->history;
+        lookup(pc, this->history, &provider, &alternate);
+        if (provider == TABLES) return base_prediction(pc);
+        return tables[provider][table_index(provider, pc, this->history)].counter >= 0;
+}
+
+/* the provider, the alternate and the allocated entries are those of the history the prediction used */
+void tage_predictor::update(unsigned pc, bool taken, branch_history_t history){
+        unsigned provider, alternate;
+        lookup(pc, history, &provider, &alternate);
+        bool alternate_prediction = alternate == TABLES ? base_prediction(pc) :
+                                    tables[alternate][table_index(alternate, pc, history)].counter >= 0;
+        bool prediction = alternate_prediction;
+
+        if (provider == TABLES){
+                counter_update(&base[pc_bits(pc) & base_mask], taken);
+        } else {
+                tage_entry_t &entry = tables[provider][table_index(provider, pc, history)];
+                prediction = entry.counter >= 0;
+                //the entry earns its place when it corrects the shorter history
+                if (prediction != alternate_prediction){
+                        if (prediction == taken && entry.useful < 3) entry.useful++;
+                        else if (prediction != taken && entry.useful > 0) entry.useful--;
+                }
+                if (taken && entry.counter < 3) entry.counter++;
+                else if (!taken && entry.counter > -4) entry.counter--;
+        }
+
+        //a misprediction takes a free entry in one longer table, or ages their entries
+        if (prediction != taken){
+                unsigned first = provider == TABLES ? 0 : provider + 1;
+                bool allocated = false;
+                for (unsigned t = first; t < TABLES && !allocated; t++){
+                        tage_entry_t &entry = tables[t][table_index(t, pc, history)];
+                        if (entry.useful == 0){
+                                entry.tag = table_tag(t, pc, history);
+                                entry.counter = taken ? 0 : -1;
+                                allocated = true;
+                        }
+                }
+                for (unsigned t = first; t < TABLES && !allocated; t++){
+                        tage_entry_t &entry = tables[t][table_index(t, pc, history)];
+                        if (entry.useful > 0) entry.useful--;
+                }
+        }
+
+        if (++updates % TAGE_USEFUL_PERIOD == 0){
+                for (unsigned t = 0; t < TABLES; t++)
+                        for (unsigned i = 0; i < tables[t].size(); i++) tables[t][i].useful >>= 1;
+        }
+        this->history = (this->history << 1) | taken;
+}
+
+/* =============================================================
+
+   BRANCH TARGET BUFFER
+
+   ============================================================= */
+
+branch_target_buffer::branch_target_buffer(unsigned size){
+        btb_entry_t empty = {UNDEFINED, UNDEFINED};
+        entries.assign(size, empty);
+}
+
+bool branch_target_buffer::lookup(unsigned pc, unsigned *target){
+        const btb_entry_t &entry = entries[pc_bits(pc) & (entries.size() - 1)];
+        if (entry.pc != pc) return false;
+        *target = entry.target;
+        return true;
+}
+
+void branch_target_buffer::update(unsigned pc, unsigned target){
+        btb_entry_t &entry = entries[pc_bits(pc) & (entries.size() - 1)];
+        entry.pc = pc;
+        entry.target = target;
+}
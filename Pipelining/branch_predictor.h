@@ -0,0 +1,123 @@
+#ifndef BRANCH_PREDICTOR_H_
+#define BRANCH_PREDICTOR_H_
+
+#include <vector>
+using namespace std;
+
+#define UNDEFINED 0xFFFFFFFF
+
+/* global history a branch was predicted with. The IF stage keeps it with the branch through the
+   pipeline latches, so the outcome trains the entry the prediction came from */
+typedef unsigned long long branch_history_t;
+
+/* direction of the conditional branches fetched by the IF stage of sim_pipe. A predictor is asked
+   once per branch when it is fetched, and told the outcome when the branch resolves in MEM.
+   Branches resolve in program order, so the global history is that of the resolved branches:
+   younger branches fetched before a branch resolves are predicted without its outcome */
+class branch_predictor{
+public:
+        virtual ~branch_predictor() {}
+
+        //returns true if the branch at "pc" is predicted taken, and in "history" the global history used
+        virtual bool predict(unsigned pc, branch_history_t *history) = 0;
+
+        //trains the predictor with the outcome of the branch at "pc", predicted with "history"
+        virtual void update(unsigned pc, bool taken, branch_history_t history) = 0;
+
+        //name printed with the statistics
+        virtual const char *name() = 0;
+};
+
+/* every branch goes the same way */
+class static_predictor : public branch_predictor{
+        bool taken;
+public:
+        static_predictor(bool predict_taken=false) : taken(predict_taken) {}
+
+        bool predict(unsigned pc, branch_history_t *history) { *history = 0; return taken; }
+        void update(unsigned pc, bool outcome, branch_history_t history) {}
+        const char *name() { return taken ? "static taken" : "static not taken"; }
+};
+
+/* a 2-bit saturating counter per entry, indexed by the PC */
+class bimodal_predictor : public branch_predictor{
+        vector<unsigned char> counters;
+        unsigned mask;
+public:
+        //"index_bits" selects 2^index_bits counters
+        bimodal_predictor(unsigned index_bits=10);
+
+        bool predict(unsigned pc, branch_history_t *history);
+        void update(unsigned pc, bool taken, branch_history_t history);
+        const char *name() { return "bimodal"; }
+};
+
+/* 2-bit counters indexed by the PC xor the outcomes of the last branches */
+class gshare_predictor : public branch_predictor{
+        vector<unsigned char> counters;
+        unsigned mask;
+        unsigned history;
+        unsigned history_mask;
+public:
+        //"history_bits" outcomes are kept, at most "index_bits"
+        gshare_predictor(unsigned index_bits=10, unsigned history_bits=8);
+
+        bool predict(unsigned pc, branch_history_t *history);
+        void update(unsigned pc, bool taken, branch_history_t history);
+        const char *name() { return "gshare"; }
+};
+
+/* TAGE with a bimodal base and four tagged tables over history lengths 4, 8, 16 and 32. The
+   longest matching table provides the prediction, a misprediction allocates an entry in a longer one */
+class tage_predictor : public branch_predictor{
+public:
+        static const unsigned TABLES = 4;
+private:
+        typedef struct{
+                unsigned short tag;
+                signed char counter;   //3-bit signed, taken when >= 0
+                unsigned char useful;  //2-bit
+        } tage_entry_t;
+
+        vector<unsigned char> base;
+        unsigned base_mask;
+        vector<tage_entry_t> tables[TABLES];
+        unsigned table_bits;
+        unsigned table_mask;
+        branch_history_t history;
+        unsigned updates;
+
+        unsigned table_index(unsigned table, unsigned pc, branch_history_t history);
+        unsigned short table_tag(unsigned table, unsigned pc, branch_history_t history);
+        //finds the longest and the next longest matching table under "history", TABLES if none
+        void lookup(unsigned pc, branch_history_t history, unsigned *provider, unsigned *alternate);
+        bool base_prediction(unsigned pc);
+public:
+        //2^base_bits base counters and 2^table_bits entries per tagged table
+        tage_predictor(unsigned base_bits=10, unsigned table_bits=8);
+
+        bool predict(unsigned pc, branch_history_t *history);
+        void update(unsigned pc, bool taken, branch_history_t history);
+        const char *name() { return "TAGE-lite"; }
+};
+
+/* direct-mapped branch target buffer, the IF stage redirects fetch only on a hit */
+class branch_target_buffer{
+        typedef struct{
+                unsigned pc;      //UNDEFINED if the entry is empty
+                unsigned target;
+        } btb_entry_t;
+
+        vector<btb_entry_t> entries;
+public:
+        //"entries" must be a power of 2
+        branch_target_buffer(unsigned entries=64);
+
+        //returns true and sets "target" if the branch at "pc" has an entry
+        bool lookup(unsigned pc, unsigned *target);
+
+        //records the target of a taken branch
+        void update(unsigned pc, unsigned target);
+};
+
+#endif /*BRANCH_PREDICTOR_H_*/
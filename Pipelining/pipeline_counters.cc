@@ -0,0 +1,67 @@
+#include "pipeline_counters.h"
+#include <iostream>
+
+static const char *stage_names[PIPELINE_STAGES] = {"IF", "ID", "EX", "MEM", "WB"};
+
+void pipeline_counters::reset(unsigned registers){
+        raw_stalls.assign(registers, 0);
+        structural_stalls.assign(unit_names.size(), 0);
+        waw_stalls = 0;
+        load_use_stalls = 0;
+        control_stalls = 0;
+        memory_stalls = 0;
+        for (unsigned s = 0; s < PIPELINE_STAGES; s++) occupied[s] = bubbles[s] = 0;
+}
+
+void pipeline_counters::add_unit(const string &name){
+        unit_names.push_back(name);
+        structural_stalls.push_back(0);
+}
+
+unsigned pipeline_counters::total_raw_stalls(){
+        unsigned total = 0;
+        for (unsigned r = 0; r < raw_stalls.size(); r++) total += raw_stalls[r];
+        return total;
+}
+
+unsigned pipeline_counters::total_structural_stalls(){
+        unsigned total = 0;
+        for (unsigned u = 0; u < structural_stalls.size(); u++) total += structural_stalls[u];
+        return total;
+}
+
+unsigned pipeline_counters::total_stalls(){
+        return total_raw_stalls() + waw_stalls + load_use_stalls + control_stalls + total_structural_stalls() + memory_stalls;
+}
+
+vector<pair<string, unsigned> > pipeline_counters::export_counters(){
+        vector<pair<string, unsigned> > counters;
+        counters.push_back(make_pair(string("stalls"), total_stalls()));
+        counters.push_back(make_pair(string("stalls.raw"), total_raw_stalls()));
+        counters.push_back(make_pair(string("stalls.waw"), waw_stalls));
+        counters.push_back(make_pair(string("stalls.load_use"), load_use_stalls));
+        counters.push_back(make_pair(string("stalls.control"), control_stalls));
+        counters.push_back(make_pair(string("stalls.structural"), total_structural_stalls()));
+        counters.push_back(make_pair(string("stalls.memory"), memory_stalls));
+        //only the registers and units that stalled, a full file of zeroes says nothing
+        for (unsigned r = 0; r < raw_stalls.size(); r++){
+                if (raw_stalls[r] == 0) continue;
+                string name = r < 32 ? "R" + to_string(r) : "F" + to_string(r - 32);
+                counters.push_back(make_pair("stalls.raw." + name, raw_stalls[r]));
+        }
+        for (unsigned u = 0; u < structural_stalls.size(); u++){
+                if (structural_stalls[u] == 0) continue;
+                counters.push_back(make_pair("stalls.structural." + unit_names[u], structural_stalls[u]));
+        }
+        for (unsigned s = 0; s < PIPELINE_STAGES; s++){
+                counters.push_back(make_pair("stage." + string(stage_names[s]) + ".occupied", occupied[s]));
+                counters.push_back(make_pair("stage." + string(stage_names[s]) + ".bubbles", bubbles[s]));
+        }
+        return counters;
+}
+
+void pipeline_counters::print(){
+        vector<pair<string, unsigned> > counters = export_counters();
+        for (unsigned i = 0; i < counters.size(); i++)
+                cout << counters[i].first << "=" << dec << counters[i].second << endl;
+}
@@ -0,0 +1,47 @@
+#ifndef PIPELINE_COUNTERS_H_
+#define PIPELINE_COUNTERS_H_
+
+#include <string>
+#include <vector>
+#include <utility>
+using namespace std;
+
+#define PIPELINE_STAGES 5
+
+/* performance counters of the pipelined simulators. Each stall cycle is charged to the one cause
+   that held the pipeline, and every cycle each stage is counted as occupied or as a bubble.
+   Stages are numbered like stage_t: IF, ID, EX, MEM, WB */
+class pipeline_counters{
+public:
+        vector<unsigned> raw_stalls;         //RAW stalls on a non-load result, by the register waited on
+        unsigned waw_stalls;                 //stalls keeping a shorter operation from writing a register before an older one
+        unsigned load_use_stalls;            //stalls on the result of a load
+        unsigned control_stalls;             //fetch waiting on a branch, or squashed on a misprediction
+        vector<unsigned> structural_stalls;  //stalls waiting for a busy functional unit, by unit
+        vector<string> unit_names;
+        unsigned memory_stalls;              //stalls waiting for data memory
+        unsigned occupied[PIPELINE_STAGES];  //cycles the stage worked on an instruction
+        unsigned bubbles[PIPELINE_STAGES];   //cycles the stage held a bubble
+
+        pipeline_counters() { reset(0); }
+
+        //zeroes every counter, keeping "registers" RAW counters; functional units are kept
+        void reset(unsigned registers);
+
+        //adds a structural counter for a functional unit
+        void add_unit(const string &name);
+
+        void count_stage(unsigned stage, bool busy) { if (busy) occupied[stage]++; else bubbles[stage]++; }
+
+        unsigned total_raw_stalls();
+        unsigned total_structural_stalls();
+        unsigned total_stalls();
+
+        //every counter as a key and its value, totals first. Registers 32 and up are named F0, F1...
+        vector<pair<string, unsigned> > export_counters();
+
+        //prints the counters as key=value lines
+        void print();
+};
+
+#endif /*PIPELINE_COUNTERS_H_*/
@@ -0,0 +1,80 @@
+#ifndef PIPEVIEW_TRACE_H_
+#define PIPEVIEW_TRACE_H_
+
+#include <stdio.h>
+
+#define UNDEFINED 0xFFFFFFFF
+
+/* clock cycles at which one instruction went through each stage of the O3PipeView timeline,
+   UNDEFINED for a stage it never reached. A squashed instruction has no retire cycle */
+typedef struct{
+        unsigned seq;       //program order of the instruction among the traced ones
+        unsigned pc;
+        unsigned fetch;
+        unsigned decode;
+        unsigned rename;
+        unsigned dispatch;
+        unsigned issue;
+        unsigned complete;
+        unsigned retire;
+        unsigned store;     //for stores, cycle the data is written to memory
+} pipeview_record_t;
+
+/* writes instruction timelines in the O3PipeView text format of gem5, read by o3-pipeview.py and
+   Konata. Cycle c ends at tick (c+1)*ticks_per_cycle, since tick 0 marks a stage as not reached;
+   the viewers assume 1000 ticks per cycle. Lines are formatted into a buffer written out in blocks.
+   A simulator holds a pointer to the trace and checks it for NULL, so tracing off costs nothing */
+class pipeview_trace{
+        FILE *file;
+        unsigned long long ticks_per_cycle;
+        char buffer[1 << 16];
+        unsigned used;
+
+        unsigned long long tick(unsigned cycle) { return cycle == UNDEFINED ? 0 : (cycle + 1ull) * ticks_per_cycle; }
+
+        void flush(){
+                if (used != 0) fwrite(buffer, 1, used, file);
+                used = 0;
+        }
+
+public:
+        pipeview_trace() : file(NULL), ticks_per_cycle(1000), used(0) {}
+
+        ~pipeview_trace() { close(); }
+
+        //starts a new trace in "filename", returns false if it cannot be created
+        bool open(const char *filename, unsigned long long ticks=1000){
+                close();
+                file = fopen(filename, "w");
+                ticks_per_cycle = ticks;
+                return file != NULL;
+        }
+
+        //writes out what is buffered and closes the file
+        void close(){
+                if (file == NULL) return;
+                flush();
+                fclose(file);
+                file = NULL;
+        }
+
+        //appends the timeline of one instruction, "disassembly" is shown next to it by the viewers
+        void write(const pipeview_record_t &record, const char *disassembly){
+                if (file == NULL) return;
+                //a record takes well under 512 bytes with the disassembly cut to 64 characters
+                if (sizeof(buffer) - used < 512) flush();
+                used += snprintf(buffer + used, sizeof(buffer) - used,
+                                 "O3PipeView:fetch:%llu:0x%08x:0:%u:%.64s\n"
+                                 "O3PipeView:decode:%llu\n"
+                                 "O3PipeView:rename:%llu\n"
+                                 "O3PipeView:dispatch:%llu\n"
+                                 "O3PipeView:issue:%llu\n"
+                                 "O3PipeView:complete:%llu\n"
+                                 "O3PipeView:retire:%llu:store:%llu\n",
+                                 tick(record.fetch), record.pc, record.seq, disassembly,
+                                 tick(record.decode), tick(record.rename), tick(record.dispatch),
+                                 tick(record.issue), tick(record.complete), tick(record.retire), tick(record.store));
+        }
+};
+
+#endif /*PIPEVIEW_TRACE_H_*/
@@ -0,0 +1,266 @@
+#include "rv32i.h"
+#include <elf.h>
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+
+using namespace std;
+
+/* =============================================================
+
+   RV32I DECODER
+
+   ============================================================= */
+
+typedef enum {FORMAT_R, FORMAT_I, FORMAT_S, FORMAT_B, FORMAT_U, FORMAT_J, FORMAT_SYSTEM} rv32i_format_t;
+
+typedef enum {RV_ADD, RV_SUB, RV_XOR, RV_ADDI, RV_LW, RV_SW, RV_BEQ, RV_BNE, RV_BLT, RV_BGE,
+              RV_LUI, RV_AUIPC, RV_JAL, RV_ECALL, RV_EBREAK} rv32i_op_t;
+
+/* an instruction matches an entry when (word & mask) == match */
+typedef struct{
+        unsigned mask;
+        unsigned match;
+        rv32i_format_t format;
+        rv32i_op_t op;
+} rv32i_pattern_t;
+
+//the RV32I instructions with an equivalent in the simulators' instruction set
+static const rv32i_pattern_t rv32i_patterns[] = {
+        {0xFE00707F, 0x00000033, FORMAT_R, RV_ADD},
+        {0xFE00707F, 0x40000033, FORMAT_R, RV_SUB},
+        {0xFE00707F, 0x00004033, FORMAT_R, RV_XOR},
+        {0x0000707F, 0x00000013, FORMAT_I, RV_ADDI},
+        {0x0000707F, 0x00002003, FORMAT_I, RV_LW},
+        {0x0000707F, 0x00002023, FORMAT_S, RV_SW},
+        {0x0000707F, 0x00000063, FORMAT_B, RV_BEQ},
+        {0x0000707F, 0x00001063, FORMAT_B, RV_BNE},
+        {0x0000707F, 0x00004063, FORMAT_B, RV_BLT},
+        {0x0000707F, 0x00005063, FORMAT_B, RV_BGE},
+        {0x0000007F, 0x00000037, FORMAT_U, RV_LUI},
+        {0x0000007F, 0x00000017, FORMAT_U, RV_AUIPC},
+        {0x0000007F, 0x0000006F, FORMAT_J, RV_JAL},
+        {0xFFFFFFFF, 0x00000073, FORMAT_SYSTEM, RV_ECALL},
+        {0xFFFFFFFF, 0x00100073, FORMAT_SYSTEM, RV_EBREAK},
+};
+
+/* sign-extended immediate of each instruction format */
+static unsigned rv32i_immediate(unsigned word, rv32i_format_t format){
+        switch(format){
+                case FORMAT_I:
+                        return (unsigned)((int)word >> 20);
+                case FORMAT_S:
+                        return (unsigned)(((int)word >> 25) << 5) | ((word >> 7) & 0x1F);
+                case FORMAT_B:
+                        return (unsigned)(((int)word >> 31) << 12) | (((word >> 7) & 0x1) << 11) |
+                               (((word >> 25) & 0x3F) << 5) | (((word >> 8) & 0xF) << 1);
+                case FORMAT_U:
+                        return word & 0xFFFFF000;
+                case FORMAT_J:
+                        return (unsigned)(((int)word >> 31) << 20) | (((word >> 12) & 0xFF) << 12) |
+                               (((word >> 20) & 0x1) << 11) | (((word >> 21) & 0x3FF) << 1);
+                default:
+                        return 0;
+        }
+}
+
+/* decodes the instruction word at index "index" of a text of "text_size" words starting at "text_address".
+   Unused register fields are x0 and unused immediates 0, so a stage that reads them anyway stays in bounds.
+   Writes to x0 become NOP, branches must compare against x0 and jumps must not link.
+   Returns false, leaving an EOP in "decoded", if the instruction has no equivalent */
+bool rv32i_decode(unsigned word, unsigned index, unsigned text_address, unsigned text_size, decoded_instruction_t *decoded){
+        decoded->opcode = DECODED_EOP;
+        decoded->src1 = decoded->src2 = decoded->dest = 0;
+        decoded->immediate = 0;
+        decoded->target = UNDEFINED;
+
+        const rv32i_pattern_t *pattern = NULL;
+        for (unsigned p = 0; p < sizeof(rv32i_patterns) / sizeof(rv32i_patterns[0]); p++){
+                if ((word & rv32i_patterns[p].mask) == rv32i_patterns[p].match){
+                        pattern = &rv32i_patterns[p];
+                        break;
+                }
+        }
+        if (pattern == NULL) return false;
+
+        unsigned rd = (word >> 7) & 0x1F;
+        unsigned rs1 = (word >> 15) & 0x1F;
+        unsigned rs2 = (word >> 20) & 0x1F;
+        unsigned immediate = rv32i_immediate(word, pattern->format);
+
+        //branch and jump offsets are relative to the instruction, the simulators count from the next one
+        if (pattern->format == FORMAT_B || pattern->format == FORMAT_J){
+                if (immediate & 0x3) return false;
+                unsigned target = index + ((int)immediate >> 2);
+                if (target >= text_size) return false;
+                decoded->target = target;
+                decoded->immediate = (target - index - 1) << 2;
+        }
+
+        switch (pattern->op){
+                case RV_ADD:
+                case RV_SUB:
+                case RV_XOR:
+                        if (rd == 0){
+                                decoded->opcode = DECODED_NOP;
+                                return true;
+                        }
+                        decoded->opcode = pattern->op == RV_ADD ? DECODED_ADD : pattern->op == RV_SUB ? DECODED_SUB : DECODED_XOR;
+                        decoded->dest = rd;
+                        decoded->src1 = rs1;
+                        decoded->src2 = rs2;
+                        return true;
+                case RV_ADDI:
+                case RV_LW:
+                        if (rd == 0){
+                                decoded->opcode = DECODED_NOP;
+                                return true;
+                        }
+                        decoded->opcode = pattern->op == RV_ADDI ? DECODED_ADDI : DECODED_LW;
+                        decoded->dest = rd;
+                        decoded->src1 = rs1;
+                        decoded->immediate = immediate;
+                        return true;
+                case RV_SW:
+                        decoded->opcode = DECODED_SW;
+                        decoded->src1 = rs2;
+                        decoded->src2 = rs1;
+                        decoded->immediate = immediate;
+                        return true;
+                case RV_LUI:
+                case RV_AUIPC:
+                        //x0 reads as zero, so both become an ADDI of a value known at decode time
+                        if (rd == 0){
+                                decoded->opcode = DECODED_NOP;
+                                return true;
+                        }
+                        decoded->opcode = DECODED_ADDI;
+                        decoded->dest = rd;
+                        decoded->immediate = pattern->op == RV_LUI ? immediate : text_address + (index << 2) + immediate;
+                        return true;
+                case RV_BEQ:
+                case RV_BNE:
+                        if (rs1 != 0 && rs2 != 0) break;
+                        decoded->opcode = pattern->op == RV_BEQ ? DECODED_BEQZ : DECODED_BNEZ;
+                        decoded->src1 = rs2 == 0 ? rs1 : rs2;
+                        return true;
+                case RV_BLT:
+                        //rs1 < 0 or 0 < rs2
+                        if (rs2 == 0){
+                                decoded->opcode = DECODED_BLTZ;
+                                decoded->src1 = rs1;
+                                return true;
+                        }
+                        if (rs1 != 0) break;
+                        decoded->opcode = DECODED_BGTZ;
+                        decoded->src1 = rs2;
+                        return true;
+                case RV_BGE:
+                        //rs1 >= 0 or 0 >= rs2
+                        if (rs2 == 0){
+                                decoded->opcode = DECODED_BGEZ;
+                                decoded->src1 = rs1;
+                                return true;
+                        }
+                        if (rs1 != 0) break;
+                        decoded->opcode = DECODED_BLEZ;
+                        decoded->src1 = rs2;
+                        return true;
+                case RV_JAL:
+                        if (rd != 0) break;
+                        decoded->opcode = DECODED_JUMP;
+                        return true;
+                case RV_ECALL:
+                case RV_EBREAK:
+                        //no environment to call into, both end the program
+                        return true;
+        }
+        decoded->target = UNDEFINED;
+        decoded->immediate = 0;
+        return false;
+}
+
+/* =============================================================
+
+   ELF32 LOADER
+
+   ============================================================= */
+
+/* reads a little-endian RV32I ELF32 executable with a single executable segment */
+bool read_elf32(const char *filename, elf_image_t *image){
+        ifstream fin(filename, ios::in | ios::binary);
+        if (!fin.is_open()){
+                cerr << "error: open file " << filename << " failed!" << endl;
+                return false;
+        }
+        vector<unsigned char> file((istreambuf_iterator<char>(fin)), istreambuf_iterator<char>());
+
+        Elf32_Ehdr header;
+        if (file.size() < sizeof(header) || memcmp(&file[0], ELFMAG, SELFMAG) != 0){
+                cerr << "error: " << filename << " is not an ELF file" << endl;
+                return false;
+        }
+        memcpy(&header, &file[0], sizeof(header));
+        if (header.e_ident[EI_CLASS] != ELFCLASS32 || header.e_ident[EI_DATA] != ELFDATA2LSB ||
+            header.e_type != ET_EXEC || header.e_machine != EM_RISCV){
+                cerr << "error: " << filename << " is not a little-endian RV32 executable" << endl;
+                return false;
+        }
+        if (header.e_phentsize != sizeof(Elf32_Phdr) ||
+            header.e_phoff + (unsigned long long)header.e_phnum * sizeof(Elf32_Phdr) > file.size()){
+                cerr << "error: " << filename << " has a truncated program header table" << endl;
+                return false;
+        }
+
+        image->entry = header.e_entry;
+        image->text.clear();
+        image->data.clear();
+        bool text_found = false;
+        for (unsigned i = 0; i < header.e_phnum; i++){
+                Elf32_Phdr segment;
+                memcpy(&segment, &file[header.e_phoff + i * sizeof(Elf32_Phdr)], sizeof(segment));
+                if (segment.p_type != PT_LOAD || segment.p_memsz == 0) continue;
+                if ((unsigned long long)segment.p_offset + segment.p_filesz > file.size() || segment.p_filesz > segment.p_memsz){
+                        cerr << "error: " << filename << " has a truncated segment at 0x" << hex << segment.p_vaddr << dec << endl;
+                        return false;
+                }
+                if (segment.p_flags & PF_X){
+                        if (text_found || (segment.p_vaddr & 0x3) || (segment.p_filesz & 0x3)){
+                                cerr << "error: " << filename << " needs a single word-aligned executable segment" << endl;
+                                return false;
+                        }
+                        text_found = true;
+                        image->text_address = segment.p_vaddr;
+                        image->text.resize(segment.p_filesz >> 2);
+                        if (!image->text.empty()) memcpy(&image->text[0], &file[segment.p_offset], segment.p_filesz);
+                        continue;
+                }
+                elf_segment_t data;
+                data.address = segment.p_vaddr;
+                data.memory_size = segment.p_memsz;
+                data.bytes.assign(file.begin() + segment.p_offset, file.begin() + segment.p_offset + segment.p_filesz);
+                image->data.push_back(data);
+        }
+        if (!text_found || image->entry < image->text_address || ((image->entry - image->text_address) >> 2) >= image->text.size()){
+                cerr << "error: the entry point of " << filename << " is not in an executable segment" << endl;
+                return false;
+        }
+        return true;
+}
+
+/* copies the data segments into a simulator's data memory, zeroing their .bss part */
+bool copy_elf_data(const elf_image_t &image, unsigned char *memory, unsigned memory_size){
+        for (unsigned i = 0; i < image.data.size(); i++){
+                const elf_segment_t &segment = image.data[i];
+                if (segment.address > memory_size || segment.memory_size > memory_size - segment.address){
+                        cerr << "error: segment at 0x" << hex << segment.address << " does not fit the data memory of 0x"
+                             << memory_size << " bytes" << dec << endl;
+                        return false;
+                }
+                if (!segment.bytes.empty()) memcpy(memory + segment.address, &segment.bytes[0], segment.bytes.size());
+                memset(memory + segment.address + segment.bytes.size(), 0, segment.memory_size - segment.bytes.size());
+        }
+        return true;
+}
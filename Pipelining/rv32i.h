@@ -0,0 +1,81 @@
+#ifndef RV32I_H_
+#define RV32I_H_
+
+#include <vector>
+using namespace std;
+
+#define UNDEFINED 0xFFFFFFFF
+
+/* opcodes produced by the RV32I decoder, numbered like the first entries of opcode_t in
+   sim_pipe.h and sim_pipe_fp.h so the pipelines can take them as they are */
+typedef enum {DECODED_LW, DECODED_SW, DECODED_ADD, DECODED_ADDI, DECODED_SUB, DECODED_SUBI, DECODED_XOR,
+              DECODED_BEQZ, DECODED_BNEZ, DECODED_BLTZ, DECODED_BGTZ, DECODED_BLEZ, DECODED_BGEZ,
+              DECODED_JUMP, DECODED_EOP, DECODED_NOP} decoded_opcode_t;
+
+/* one RV32I instruction lowered to the fields of the simulators' instruction_t */
+typedef struct{
+        decoded_opcode_t opcode;
+        unsigned src1;      //for SW, register to be written to memory
+        unsigned src2;      //for SW, base address register
+        unsigned dest;
+        unsigned immediate; //for branches, offset from the next instruction
+        unsigned target;    //for branches, index of the target instruction, UNDEFINED otherwise
+} decoded_instruction_t;
+
+/* a loadable segment of an ELF32 executable */
+typedef struct{
+        unsigned address;           //virtual address of the first byte
+        unsigned memory_size;       //bytes past the file image are zero (.bss)
+        vector<unsigned char> bytes;
+} elf_segment_t;
+
+/* the executable and data parts of an RV32I ELF32 executable */
+typedef struct{
+        unsigned entry;
+        unsigned text_address;       //address of the executable segment, instruction 0
+        vector<unsigned> text;       //instruction words of the executable segment
+        vector<elf_segment_t> data;  //every other loadable segment
+} elf_image_t;
+
+//reads a little-endian RV32I ELF32 executable with a single executable segment
+//returns false after printing the reason if the file cannot be used
+bool read_elf32(const char *filename, elf_image_t *image);
+
+//decodes the instruction word at index "index" of a text of "text_size" words starting at "text_address"
+//returns false if the instruction has no equivalent in the simulators' instruction set
+bool rv32i_decode(unsigned word, unsigned index, unsigned text_address, unsigned text_size, decoded_instruction_t *decoded);
+
+//copies the data segments into a simulator's data memory, zeroing their .bss part
+//returns false after printing the reason if a segment falls outside the memory
+bool copy_elf_data(const elf_image_t &image, unsigned char *memory, unsigned memory_size);
+
+/* decodes the text of "image" into a simulator's instruction memory, followed by an EOP
+   that ends programs running past the last instruction. Instructions without an equivalent
+   are stored as EOP, so the program stops if it reaches one
+   @return number of such instructions, "first_unsupported" is set to the address of the first */
+template<typename instruction_type>
+unsigned decode_elf_text(const elf_image_t &image, vector<instruction_type> &memory, unsigned *first_unsupported)
+{
+        unsigned unsupported=0;
+        *first_unsupported=UNDEFINED;
+        memory.clear();
+        memory.reserve(image.text.size()+1);
+        for(unsigned i=0; i<=image.text.size(); i++){
+                decoded_instruction_t decoded;
+                //the word past the text decodes as ECALL, the end of the program
+                if(!rv32i_decode(i<image.text.size()?image.text[i]:0x00000073, i, image.text_address, image.text.size(), &decoded)){
+                        if(unsupported++==0) *first_unsupported=image.text_address+(i<<2);
+                }
+                instruction_type instruction;
+                instruction.opcode=(decltype(instruction.opcode))decoded.opcode;
+                instruction.src1=decoded.src1;
+                instruction.src2=decoded.src2;
+                instruction.dest=decoded.dest;
+                instruction.immediate=decoded.immediate;
+                instruction.target=decoded.target;
+                memory.push_back(instruction);
+        }
+        return unsupported;
+}
+
+#endif /*RV32I_H_*/
@@ -1,4 +1,5 @@
 #include "sim_pipe.h"
+#include "rv32i.h"
 #include <stdlib.h>
 #include <iostream>
 #include <fstream>
@@ -6,6 +7,8 @@
 #include <string>
 #include <iomanip>
 #include <map>
+#include <algorithm>
+#include <iterator>
 
 
 //#define DEBUG
@@ -95,6 +98,13 @@ void sim_pipe::load_program(const char *filename, unsigned base_address) {
     /* parsing the assembly file line by line */
     string line;
     unsigned instruction_nr = 0;
+    // one decoded entry per line, sized up front so parsing never reallocates the store
+    instr_memory.clear();
+    instr_memory.reserve(count(istreambuf_iterator<char>(fin), istreambuf_iterator<char>(), '\n') + 1);
+    branch_labels.clear();
+    branch_labels.reserve(instr_memory.capacity());
+    fin.clear();
+    fin.seekg(0);
     while (getline(fin, line)) {
         // set the instruction field
         char *str = const_cast<char *>(line.c_str());
@@ -111,6 +121,9 @@ void sim_pipe::load_program(const char *filename, unsigned base_address) {
             search = opcodes.find(token);
             if (search == opcodes.end()) cout << "ERROR: invalid opcode: " << token << " !" << endl;
         }
+        instr_memory.push_back(instruction_t());
+        instr_memory[instruction_nr].target = UNDEFINED;
+        branch_labels.push_back(string());
         instr_memory[instruction_nr].opcode = search->second;
 
         //reading remaining parameters
@@ -160,11 +173,11 @@ void sim_pipe::load_program(const char *filename, unsigned base_address) {
                 par1 = strtok(NULL, " \t");
                 par2 = strtok(NULL, " \t");
                 instr_memory[instruction_nr].src1 = atoi(strtok(par1, "R"));
-                instr_memory[instruction_nr].label = par2;
+                branch_labels[instruction_nr] = par2;
                 break;
             case JUMP:
                 par2 = strtok(NULL, " \t");
-                instr_memory[instruction_nr].label = par2;
+                branch_labels[instruction_nr] = par2;
             default:
                 break;
 
@@ -174,8 +187,7 @@ void sim_pipe::load_program(const char *filename, unsigned base_address) {
         instruction_nr++;
     }
     //reconstructing the labels of the branch operations
-    int i = 0;
-    while (true) {
+    for (unsigned i = 0; i < instr_memory.size(); i++) {
         instruction_t instr = instr_memory[i];
         if (instr.opcode == EOP) break;
         if (instr.opcode == BLTZ || instr.opcode == BNEZ ||
@@ -183,13 +195,37 @@ void sim_pipe::load_program(const char *filename, unsigned base_address) {
             instr.opcode == BGEZ || instr.opcode == BLEZ ||
             instr.opcode == JUMP
                 ) {
-            instr_memory[i].immediate = (labels[instr.label] - i - 1) << 2;
+            instr_memory[i].target = labels[branch_labels[i]];
+            instr_memory[i].immediate = (instr_memory[i].target - i - 1) << 2;
         }
-        i++;
     }
 
 }
 
+static_assert((int)DECODED_NOP == (int)NOP && (int)DECODED_EOP == (int)EOP && (int)DECODED_JUMP == (int)JUMP,
+              "the RV32I decoder numbers its opcodes like opcode_t");
+
+/* loads an RV32I ELF32 executable, x0 reads as zero and the stack pointer x2 starts at the top of the data memory */
+void sim_pipe::load_elf(const char *filename) {
+    elf_image_t image;
+    if (!read_elf32(filename, &image) || !copy_elf_data(image, data_memory, data_memory_size)) exit(-1);
+
+    instr_base_address = image.text_address;
+    unsigned first_unsupported;
+    unsigned unsupported = decode_elf_text(image, instr_memory, &first_unsupported);
+    if (unsupported != 0)
+        cerr << "warning: " << dec << unsupported << " instructions of " << filename
+             << " have no equivalent and end the program, the first at 0x" << hex << first_unsupported << dec << endl;
+    branch_labels.assign(instr_memory.size(), string());
+
+    if (integer_register.empty()) {
+        integer_register = create_integer_Point_registers();
+    }
+    integer_register[0] = 0;
+    integer_register[2] = data_memory_size & ~0xFu;
+    enter_detailed_mode((image.entry - image.text_address) >> 2);
+}
+
 /* writes an integer value to data memory at the specified address (use little-endian format: https://en.wikipedia.org/wiki/Endianness) */
 void sim_pipe::write_memory(unsigned address, unsigned value) {
     int2char(value, data_memory + address);
@@ -229,9 +265,12 @@ void sim_pipe::print_registers() {
 }
 
 /* initializes the pipeline simulator */
-sim_pipe::sim_pipe(unsigned mem_size, unsigned mem_latency) {
+sim_pipe::sim_pipe(unsigned mem_size, unsigned mem_latency, bool forwarding) {
+    this->forwarding = forwarding;
     data_memory_size = mem_size;
     data_memory_latency = mem_latency;
+    fixed_memory.latency = data_memory_latency;
+    memory = &fixed_memory;
     data_memory = new unsigned char[data_memory_size];
     reset();
 }
@@ -248,6 +287,12 @@ sim_pipe::~sim_pipe() {
    ============================================================= */
 
 
+/* false for bubbles and the EOP, which do no work in a stage */
+static inline bool holds_instruction(const instruction_t &instr)
+{
+    return instr.opcode!=NOP && instr.opcode!=EOP;
+}
+
 /* body of the simulator */
 /**
  * Implementing the run function
@@ -256,84 +301,61 @@ sim_pipe::~sim_pipe() {
  */
 void sim_pipe::run(unsigned cycles)
 {
-
-
-
-
-    int total_no_clock_cycle_eapsed = 0;
-    if(cycles==0)
+    unsigned i=0;
+    while((cycles==0 || i<cycles) && !end_of_program_reached)
     {
-        runcycle= true;
-
+        clock_tick();
+        i++;
     }
+}
 
-
-   int i=0;
-   while(i<cycles || runcycle)
+/**
+ * Advances the pipeline by one clock cycle, stages run back to front so each reads the latch of the previous cycle
+ */
+void sim_pipe::clock_tick()
+{
+    counters.count_stage(ID, holds_instruction(IF_ID_PIPELINE_COLUMN.IR));
+    counters.count_stage(EXE, holds_instruction(ID_EX_PIPELINE_CLOUMN.IR));
+    counters.count_stage(MEM, holds_instruction(EX_MEM_PIPELINE_COLUMN.IR));
+    counters.count_stage(WB, holds_instruction(MEM_WB_REGISTER_COLUMN.IR));
+    Instruction_writeback();
+    Instruction_memory();
+    if(memory_bubble)
     {
-
-        //Intruction Fetech STage work on IF/ID column
-
-           Instruction_writeback(instruction_no-4);
-           Instruction_memory(instruction_no-3);
-
-           Instruction_execute(instruction_no-2);
-
-
-           Instruction_decode(instruction_no-1);
-           Instruction_fetch(instruction_no);
-//           if(runcycle)
-//           {
-//               unsigned d=IF_ID_PIPELINE_COLUMN.NPC;
-//               cout<<IF_ID_PIPELINE_COLUMN.NPC;
-//           }
-
-           i++;
+        //MEM is waiting for data memory, the stages behind it hold
+        counters.memory_stalls++;
+        counters.count_stage(IF, false);
         clock_cycles=clock_cycles+1;
-        instruction_no++;
-
-
-
+        return;
+    }
+    Instruction_execute();
+    Instruction_decode();
+    Instruction_fetch();
+    clock_cycles=clock_cycles+1;
+    if(MEM_WB_REGISTER_COLUMN.IR.opcode==EOP)
+    {
+        //every instruction before the EOP has written back
+        end_of_program_reached=true;
     }
-
-
-    no_of_instruction_executed++;
-
 }
 
 /* reset the state of the pipeline simulator */
 void sim_pipe::reset()
 {
-    //Setting everything to UNDEFINED
-
+    //Setting everything to UNDEFINED, the latches hold bubbles
+    integer_register=create_integer_Point_registers();
+    enter_detailed_mode(0);
     PC_ADDER=UNDEFINED;
-    IF_ID_PIPELINE_COLUMN.NPC=UNDEFINED;
-    ID_EX_PIPELINE_CLOUMN.NPC=UNDEFINED;
-    ID_EX_PIPELINE_CLOUMN.B=UNDEFINED;
-    ID_EX_PIPELINE_CLOUMN.IMM=UNDEFINED;
-    EX_MEM_PIPELINE_COLUMN.B=UNDEFINED;
-    EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT=UNDEFINED;
-    EX_MEM_PIPELINE_COLUMN.COND=UNDEFINED;
-//    for(int i=0;i<1;++i)
-//    {
-//        instr_memory[i].opcode=NOP;
-//        instr_memory[i].src1=UNDEFINED;
-//        instr_memory[i].src2=UNDEFINED;
-//        instr_memory[i].dest=UNDEFINED;
-//        instr_memory[i].immediate=UNDEFINED;
-//    }
-     instruction_no=0;
     no_of_instruction_executed=0;
-     clock_cycles=0;
-     runcycle=false;
-     data_hazard=false;
-     control_hazard=false;
-     structural_hazard=false;
-    for (int i = 0; i < data_memory_size; ++i) {
-        data_memory[i] = UNDEFINED;
+    clock_cycles=0;
+    fast_forwarded_instructions=0;
+    counters.reset(NUM_GP_REGISTERS);
+    next_seq=0;
+    branches=0;
+    mispredictions=0;
+    for (unsigned i = 0; i < data_memory_size; ++i) {
+        data_memory[i] = 0xFF;
     }
-
-
 }
 //return value of special purpose register
 unsigned sim_pipe::get_sp_register(sp_register_t reg, stage_t s)
@@ -437,7 +459,60 @@ unsigned sim_pipe::get_instructions_executed() {
 }
 
 unsigned sim_pipe::get_stalls() {
-    return count_stalls_inserted; //please modify
+    return counters.total_stalls();
+}
+
+unsigned sim_pipe::get_memory_stalls() {
+    return counters.memory_stalls;
+}
+
+unsigned sim_pipe::get_load_use_stalls() {
+    return counters.load_use_stalls;
+}
+
+unsigned sim_pipe::get_data_stalls() {
+    return counters.total_raw_stalls();
+}
+
+unsigned sim_pipe::get_control_stalls() {
+    return counters.control_stalls;
+}
+
+vector<pair<string, unsigned> > sim_pipe::get_counters() {
+    return counters.export_counters();
+}
+
+void sim_pipe::print_counters() {
+    counters.print();
+}
+
+void sim_pipe::set_branch_predictor(branch_predictor *predictor, unsigned btb_entries) {
+    this->predictor = predictor;
+    btb = branch_target_buffer(btb_entries);
+}
+
+unsigned sim_pipe::get_branches() {
+    return branches;
+}
+
+void sim_pipe::set_trace(pipeview_trace *trace) {
+    this->trace = trace;
+}
+
+unsigned sim_pipe::get_mispredictions() {
+    return mispredictions;
+}
+
+float sim_pipe::get_branch_accuracy() {
+    return branches == 0 ? 0 : 1 - (float)mispredictions / (float)branches;
+}
+
+float sim_pipe::get_MPKI() {
+    return no_of_instruction_executed == 0 ? 0 : (float)mispredictions * 1000 / (float)no_of_instruction_executed;
+}
+
+void sim_pipe::set_memory_backend(memory_backend *backend) {
+    memory = (backend == NULL) ? &fixed_memory : backend;
 }
 
 unsigned sim_pipe::get_clock_cycles() {
@@ -464,262 +539,381 @@ vector<unsigned int> sim_pipe::create_integer_Point_registers() {
 
 }
 
-void sim_pipe::Instruction_fetch(int instruction_index) {
-    IF_ID_PIPELINE_COLUMN.IR = instr_memory[instruction_index];
-    if(IF_ID_PIPELINE_COLUMN.IR.opcode==EOP)
+/* the registers an instruction reads, UNDEFINED where it reads none */
+static void source_registers(const instruction_t &instr, unsigned *first, unsigned *second)
+{
+    *first=UNDEFINED;
+    *second=UNDEFINED;
+    switch(instr.opcode)
     {
-        end_of_program_reached= true;
-
-        return;
+        case ADD:
+        case SUB:
+        case XOR:
+        case SW:
+            *first=instr.src1;
+            *second=instr.src2;
+            break;
+        case ADDI:
+        case SUBI:
+        case LW:
+        case BEQZ:
+        case BNEZ:
+        case BLTZ:
+        case BGTZ:
+        case BLEZ:
+        case BGEZ:
+            *first=instr.src1;
+            break;
+        default:
+            break;
     }
+}
 
-    if(Detect_Branch(MEM_WB_REGISTER_COLUMN.IR.opcode) && EX_MEM_PIPELINE_COLUMN.COND==1)
+/* the register an instruction writes in WB, UNDEFINED if none */
+static unsigned destination_register(const instruction_t &instr)
+{
+    switch(instr.opcode)
     {
-        IF_ID_PIPELINE_COLUMN.NPC=MEM_WB_REGISTER_COLUMN.ALU_OUTPUT;
-        PC_ADDER=MEM_WB_REGISTER_COLUMN.ALU_OUTPUT;
-    }
-
-    else {
-        if(!end_of_program_reached) {
-            PC_ADDER = PC_ADDER + 4;
-            IF_ID_PIPELINE_COLUMN.NPC = (PC_ADDER);
-        }
+        case ADD:
+        case ADDI:
+        case SUB:
+        case SUBI:
+        case XOR:
+        case LW:
+            return instr.dest;
+        default:
+            return UNDEFINED;
     }
-
 }
-void sim_pipe::Instruction_decode(int instruction_index)
-{
-
-    if(clock_cycles>=1) {
-        if (ID_EX_PIPELINE_CLOUMN.IR.opcode == EOP)
-        {
-            EX_MEM_PIPELINE_COLUMN.IR=ID_EX_PIPELINE_CLOUMN.IR;
-            ID_EX_PIPELINE_CLOUMN.A=UNDEFINED;
-            ID_EX_PIPELINE_CLOUMN.B=UNDEFINED;
-            ID_EX_PIPELINE_CLOUMN.IMM=UNDEFINED;
-            return;
-
-        }
-            if (!handle_hazard()) {
-
-                ID_EX_PIPELINE_CLOUMN.NPC = IF_ID_PIPELINE_COLUMN.NPC;
-                ID_EX_PIPELINE_CLOUMN.IR = IF_ID_PIPELINE_COLUMN.IR;
-
 
-                if (ID_EX_PIPELINE_CLOUMN.IR.opcode == LW) {
-                    ID_EX_PIPELINE_CLOUMN.A = integer_register[ID_EX_PIPELINE_CLOUMN.IR.src1];
-                    ID_EX_PIPELINE_CLOUMN.IMM = ID_EX_PIPELINE_CLOUMN.IR.immediate;
-                    ID_EX_PIPELINE_CLOUMN.B = UNDEFINED;
-
-                } else if (ID_EX_PIPELINE_CLOUMN.IR.opcode == SW) {
-                    ID_EX_PIPELINE_CLOUMN.A = integer_register[ID_EX_PIPELINE_CLOUMN.IR.src2];
-                    ID_EX_PIPELINE_CLOUMN.B = integer_register[ID_EX_PIPELINE_CLOUMN.IR.src1];
-                    ID_EX_PIPELINE_CLOUMN.IMM = ID_EX_PIPELINE_CLOUMN.IR.immediate;
+/* true if "instr" reads the register "producer" writes */
+static bool reads_result_of(const instruction_t &instr, const instruction_t &producer)
+{
+    unsigned dest=destination_register(producer);
+    if(dest==UNDEFINED)
+        return false;
+    unsigned first, second;
+    source_registers(instr, &first, &second);
+    return first==dest || second==dest;
+}
 
-                } else {
-                    ID_EX_PIPELINE_CLOUMN.A = integer_register[IF_ID_PIPELINE_COLUMN.IR.src1];
-                    ID_EX_PIPELINE_CLOUMN.B = integer_register[IF_ID_PIPELINE_COLUMN.IR.src2];
-                    ID_EX_PIPELINE_CLOUMN.IMM = IF_ID_PIPELINE_COLUMN.IR.immediate;
-                }
-            } else {
-                count_stalls_inserted = count_stalls_inserted + 1;
-            }
+void sim_pipe::Instruction_fetch() {
+    if(decode_stalled)
+    {
+        //IF/ID and the PC hold the instruction ID could not take
+        counters.count_stage(IF, false);
+        return;
+    }
+    if(predictor==NULL && Detect_ControlHazard())
+    {
+        //no instruction is fetched until the branch in flight sets the PC in MEM
+        IF_ID_PIPELINE_COLUMN=decltype(IF_ID_PIPELINE_COLUMN)();
+        counters.control_stalls++;
+        counters.count_stage(IF, false);
+        return;
+    }
+    counters.count_stage(IF, true);
+    unsigned index=(PC_ADDER-instr_base_address)>>2;
+    IF_ID_PIPELINE_COLUMN.IR = instruction_at(index);
+    IF_ID_PIPELINE_COLUMN.index = index;
+    IF_ID_PIPELINE_COLUMN.seq = UNDEFINED;
+    if(IF_ID_PIPELINE_COLUMN.IR.opcode==EOP)
+    {
+        //the PC stays on the EOP, fetching it again every cycle
+        IF_ID_PIPELINE_COLUMN.NPC = PC_ADDER;
+        return;
+    }
+    unsigned pc = PC_ADDER;
+    if(trace!=NULL)
+    {
+        IF_ID_PIPELINE_COLUMN.seq = next_seq++;
+        pipeview_record_t &record = in_flight(IF_ID_PIPELINE_COLUMN.seq);
+        record.seq = IF_ID_PIPELINE_COLUMN.seq;
+        record.pc = pc;
+        record.fetch = clock_cycles;
+        record.decode = record.rename = record.dispatch = record.issue = UNDEFINED;
+        record.complete = record.retire = record.store = UNDEFINED;
+    }
+    PC_ADDER = PC_ADDER + 4;
+    IF_ID_PIPELINE_COLUMN.NPC = PC_ADDER;
+    if(predictor!=NULL && Detect_Branch(IF_ID_PIPELINE_COLUMN.IR.opcode))
+        PC_ADDER = predict_next_pc(pc, IF_ID_PIPELINE_COLUMN.IR.opcode, &IF_ID_PIPELINE_COLUMN.history);
+    IF_ID_PIPELINE_COLUMN.predicted_pc = PC_ADDER;
+}
 
-        }
+/* the PC fetch continues from after the branch at "pc": its target if it is predicted taken and in the BTB.
+   "history" gets the global history the prediction used */
+unsigned sim_pipe::predict_next_pc(unsigned pc, opcode_t opcode, branch_history_t *history)
+{
+    unsigned target;
+    bool taken = predictor->predict(pc, history) || opcode==JUMP;
+    if(taken && btb.lookup(pc, &target))
+        return target;
+    return pc+4;
+}
 
+void sim_pipe::Instruction_decode()
+{
+    if(branch_squash)
+    {
+        //the instruction in IF/ID was fetched down the mispredicted path
+        decode_stalled=false;
+        ID_EX_PIPELINE_CLOUMN=decltype(ID_EX_PIPELINE_CLOUMN)();
+        return;
+    }
+    bool traced = (trace!=NULL && IF_ID_PIPELINE_COLUMN.seq!=UNDEFINED);
+    if(traced && in_flight(IF_ID_PIPELINE_COLUMN.seq).decode==UNDEFINED)
+        in_flight(IF_ID_PIPELINE_COLUMN.seq).decode = clock_cycles;
+    decode_stalled=handle_hazard();
+    if(decode_stalled)
+    {
+        ID_EX_PIPELINE_CLOUMN=decltype(ID_EX_PIPELINE_CLOUMN)();
+        return;
     }
+    if(traced)
+        in_flight(IF_ID_PIPELINE_COLUMN.seq).rename = in_flight(IF_ID_PIPELINE_COLUMN.seq).dispatch = clock_cycles;
+
+    ID_EX_PIPELINE_CLOUMN=decltype(ID_EX_PIPELINE_CLOUMN)();
+    ID_EX_PIPELINE_CLOUMN.IR = IF_ID_PIPELINE_COLUMN.IR;
+    ID_EX_PIPELINE_CLOUMN.index = IF_ID_PIPELINE_COLUMN.index;
+    ID_EX_PIPELINE_CLOUMN.NPC = IF_ID_PIPELINE_COLUMN.NPC;
+    ID_EX_PIPELINE_CLOUMN.predicted_pc = IF_ID_PIPELINE_COLUMN.predicted_pc;
+    ID_EX_PIPELINE_CLOUMN.history = IF_ID_PIPELINE_COLUMN.history;
+    ID_EX_PIPELINE_CLOUMN.seq = IF_ID_PIPELINE_COLUMN.seq;
+
+    const instruction_t &instr = ID_EX_PIPELINE_CLOUMN.IR;
+    switch (instr.opcode) {
+        case ADD:
+        case SUB:
+        case XOR:
+            ID_EX_PIPELINE_CLOUMN.A = integer_register[instr.src1];
+            ID_EX_PIPELINE_CLOUMN.B = integer_register[instr.src2];
+            break;
+        case ADDI:
+        case SUBI:
+        case LW:
+        case BEQZ:
+        case BNEZ:
+        case BLTZ:
+        case BGTZ:
+        case BLEZ:
+        case BGEZ:
+            ID_EX_PIPELINE_CLOUMN.A = integer_register[instr.src1];
+            ID_EX_PIPELINE_CLOUMN.IMM = instr.immediate;
+            break;
+        case SW:
+            ID_EX_PIPELINE_CLOUMN.A = integer_register[instr.src2];
+            ID_EX_PIPELINE_CLOUMN.B = integer_register[instr.src1];
+            ID_EX_PIPELINE_CLOUMN.IMM = instr.immediate;
+            break;
+        case JUMP:
+            ID_EX_PIPELINE_CLOUMN.IMM = instr.immediate;
+            break;
+        default:
+            //bubbles and EOP carry no operands
+            break;
+    }
+}
 
+/**
+ * Value of a source register as EX sees it. Without forwarding that is the value ID read.
+ * With forwarding the instruction that just left EX hands its result over (EX->EX), and
+ * the register file already holds what WB wrote this cycle (MEM->EX) and before
+ */
+unsigned sim_pipe::operand(unsigned reg, unsigned read_in_decode)
+{
+    if(!forwarding)
+        return read_in_decode;
+    if(destination_register(MEM_WB_REGISTER_COLUMN.IR)==reg)
+        return MEM_WB_REGISTER_COLUMN.IR.opcode==LW ? MEM_WB_REGISTER_COLUMN.LMD : MEM_WB_REGISTER_COLUMN.ALU_OUTPUT;
+    return integer_register[reg];
+}
 
-void sim_pipe::Instruction_execute(int instruction_index)
+void sim_pipe::Instruction_execute()
 {
+    const instruction_t &instr = ID_EX_PIPELINE_CLOUMN.IR;
+    EX_MEM_PIPELINE_COLUMN=decltype(EX_MEM_PIPELINE_COLUMN)();
+    if(branch_squash)
+        return;
+    EX_MEM_PIPELINE_COLUMN.IR = instr;
+    EX_MEM_PIPELINE_COLUMN.index = ID_EX_PIPELINE_CLOUMN.index;
+    EX_MEM_PIPELINE_COLUMN.predicted_pc = ID_EX_PIPELINE_CLOUMN.predicted_pc;
+    EX_MEM_PIPELINE_COLUMN.history = ID_EX_PIPELINE_CLOUMN.history;
+    EX_MEM_PIPELINE_COLUMN.seq = ID_EX_PIPELINE_CLOUMN.seq;
+    if(instr.opcode==NOP || instr.opcode==EOP)
+        return;
+    if(trace!=NULL && EX_MEM_PIPELINE_COLUMN.seq!=UNDEFINED)
+        in_flight(EX_MEM_PIPELINE_COLUMN.seq).issue = clock_cycles;
 
+    unsigned a = ID_EX_PIPELINE_CLOUMN.A;
+    unsigned b = ID_EX_PIPELINE_CLOUMN.B;
+    switch (instr.opcode) {
+        case ADD:
+        case SUB:
+        case XOR:
+            a = operand(instr.src1, a);
+            b = operand(instr.src2, b);
+            break;
+        case SW:
+            a = operand(instr.src2, a);
+            b = operand(instr.src1, b);
+            break;
+        case JUMP:
+            break;
+        default:
+            a = operand(instr.src1, a);
+            break;
+    }
 
-    if(clock_cycles>=2)
-    {
+    EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT = alu(instr.opcode, a, b, ID_EX_PIPELINE_CLOUMN.IMM, ID_EX_PIPELINE_CLOUMN.NPC);
+    EX_MEM_PIPELINE_COLUMN.B = b;
+    switch (instr.opcode) {
+        case BEQZ: EX_MEM_PIPELINE_COLUMN.COND = ((int)a == 0); break;
+        case BNEZ: EX_MEM_PIPELINE_COLUMN.COND = ((int)a != 0); break;
+        case BLTZ: EX_MEM_PIPELINE_COLUMN.COND = ((int)a < 0); break;
+        case BGTZ: EX_MEM_PIPELINE_COLUMN.COND = ((int)a > 0); break;
+        case BLEZ: EX_MEM_PIPELINE_COLUMN.COND = ((int)a <= 0); break;
+        case BGEZ: EX_MEM_PIPELINE_COLUMN.COND = ((int)a >= 0); break;
+        case JUMP: EX_MEM_PIPELINE_COLUMN.COND = 1; break;
+        default: break;
+    }
+}
 
-        EX_MEM_PIPELINE_COLUMN.IR = ID_EX_PIPELINE_CLOUMN.IR;
-        if(EX_MEM_PIPELINE_COLUMN.IR.opcode==EOP)
-        {
-            MEM_WB_REGISTER_COLUMN.IR=EX_MEM_PIPELINE_COLUMN.IR;
-            EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT=UNDEFINED;
-            EX_MEM_PIPELINE_COLUMN.B=UNDEFINED;
-            EX_MEM_PIPELINE_COLUMN.COND=UNDEFINED;
-            return;
-        }
-        opcode_t fetched_opcodes = EX_MEM_PIPELINE_COLUMN.IR.opcode;
-        unsigned alu_output=0;
-        //
-        if(fetched_opcodes==SW)
-        {
-            unsigned a = integer_register[EX_MEM_PIPELINE_COLUMN.IR.src2];
-            unsigned b = integer_register[EX_MEM_PIPELINE_COLUMN.IR.src1];
-            unsigned imm = EX_MEM_PIPELINE_COLUMN.IR.immediate;
-            unsigned npc = ID_EX_PIPELINE_CLOUMN.NPC;
-            alu_output = alu(fetched_opcodes, a, b, imm, npc);
+void sim_pipe::Instruction_memory()
+{
+    const instruction_t &instr = EX_MEM_PIPELINE_COLUMN.IR;
+    unsigned address = EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT;
+    branch_squash = false;
+
+    if (instr.opcode == LW || instr.opcode == SW) {
+        if (!memory_access_ready) {
+            //the access starts this cycle and holds MEM for the latency of the backend
+            memory_cycles_left = memory->access(address, instr.opcode == SW);
+            memory_access_ready = true;
         }
-        else
-        {
-            unsigned a = integer_register[EX_MEM_PIPELINE_COLUMN.IR.src1];
-            unsigned b = integer_register[EX_MEM_PIPELINE_COLUMN.IR.src2];
-            unsigned imm = EX_MEM_PIPELINE_COLUMN.IR.immediate;
-            unsigned npc = ID_EX_PIPELINE_CLOUMN.NPC;
-            alu_output = alu(fetched_opcodes, a, b, imm, npc);
+        if (memory_cycles_left > 0) {
+            memory_cycles_left--;
+            memory_bubble = true;
+            MEM_WB_REGISTER_COLUMN=decltype(MEM_WB_REGISTER_COLUMN)();
+            return;
         }
-
-        //
-
-        EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT=(alu_output);
-
-        EX_MEM_PIPELINE_COLUMN.B=ID_EX_PIPELINE_CLOUMN.B;
-
-
-
-
+        memory_access_ready = false;
     }
+    memory_bubble = false;
 
+    MEM_WB_REGISTER_COLUMN=decltype(MEM_WB_REGISTER_COLUMN)();
+    MEM_WB_REGISTER_COLUMN.IR = instr;
+    MEM_WB_REGISTER_COLUMN.index = EX_MEM_PIPELINE_COLUMN.index;
+    MEM_WB_REGISTER_COLUMN.seq = EX_MEM_PIPELINE_COLUMN.seq;
+    if (instr.opcode == NOP || instr.opcode == EOP)
+        return;
+    MEM_WB_REGISTER_COLUMN.ALU_OUTPUT = address;
+    if (trace != NULL && MEM_WB_REGISTER_COLUMN.seq != UNDEFINED) {
+        in_flight(MEM_WB_REGISTER_COLUMN.seq).complete = clock_cycles;
+        if (instr.opcode == SW)
+            in_flight(MEM_WB_REGISTER_COLUMN.seq).store = clock_cycles;
+    }
 
+    if (instr.opcode == LW) {
+        //an address outside the data memory reads as UNDEFINED
+        MEM_WB_REGISTER_COLUMN.LMD = (address <= data_memory_size - 4) ? char2int(data_memory + address) : UNDEFINED;
+    } else if (instr.opcode == SW) {
+        //a store outside the data memory is dropped
+        if (address <= data_memory_size - 4)
+            write_memory(address, EX_MEM_PIPELINE_COLUMN.B);
+    } else if (Detect_Branch(instr.opcode)) {
+        resolve_branch();
+    }
 }
 
-void sim_pipe::Instruction_memory(int instruction_index)
+/**
+ * Resolves the branch in MEM. Without a predictor fetch has waited for it and continues from the
+ * target, this same cycle, if it is taken. With one the predictor and the BTB learn the outcome,
+ * and on a misprediction the two instructions fetched behind the branch are squashed
+ */
+void sim_pipe::resolve_branch()
 {
-
-
-if(clock_cycles>=3) {
-    if (MEM_WB_REGISTER_COLUMN.IR.opcode == EOP)
-    {
-        MEM_WB_REGISTER_COLUMN.ALU_OUTPUT = UNDEFINED;
-        MEM_WB_REGISTER_COLUMN.LMD = (UNDEFINED);
+    bool taken = (EX_MEM_PIPELINE_COLUMN.COND == 1);
+    if (predictor == NULL) {
+        if (taken)
+            PC_ADDER = EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT;
         return;
     }
-
-    if (!structural_hazard) {
-        MEM_WB_REGISTER_COLUMN.IR = EX_MEM_PIPELINE_COLUMN.IR;
-
-        if (MEM_WB_REGISTER_COLUMN.IR.opcode == LW) {
-//        int2char(EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT,data_memory);
-//        char2int()
-
-            MEM_WB_REGISTER_COLUMN.LMD = char2int(data_memory);
-
-            //MEM_WB_REGISTER_COLUMN.ALU_OUTPUT = EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT;
-
-
-
-        } else if (MEM_WB_REGISTER_COLUMN.IR.opcode == SW) {
-            write_memory(EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT, EX_MEM_PIPELINE_COLUMN.B);
-            MEM_WB_REGISTER_COLUMN.ALU_OUTPUT = integer_register[EX_MEM_PIPELINE_COLUMN.IR.dest];
-
-            //  MEM_WB_REGISTER_COLUMN.ALU_OUTPUT = EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT;
-
-        } else {
-            MEM_WB_REGISTER_COLUMN.ALU_OUTPUT = EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT;
-        }
-
+    unsigned pc = instr_base_address + (EX_MEM_PIPELINE_COLUMN.index << 2);
+    unsigned next = taken ? EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT : pc + 4;
+    branches++;
+    if (EX_MEM_PIPELINE_COLUMN.IR.opcode != JUMP)
+        predictor->update(pc, taken, EX_MEM_PIPELINE_COLUMN.history);
+    if (taken)
+        btb.update(pc, EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT);
+    if (next == EX_MEM_PIPELINE_COLUMN.predicted_pc)
+        return;
+    mispredictions++;
+    //every wrong-path instruction becomes a bubble, the ones already there were counted when inserted
+    if (ID_EX_PIPELINE_CLOUMN.IR.opcode != NOP)
+        counters.control_stalls++;
+    if (IF_ID_PIPELINE_COLUMN.IR.opcode != NOP)
+        counters.control_stalls++;
+    if (trace != NULL) {
+        trace_instruction(ID_EX_PIPELINE_CLOUMN.seq);
+        trace_instruction(IF_ID_PIPELINE_COLUMN.seq);
     }
+    branch_squash = true;
+    PC_ADDER = next;
 }
-}
-
-
-
-
-void sim_pipe::Instruction_writeback(int instruction_index) {
 
-
-    if (MEM_WB_REGISTER_COLUMN.IR.opcode == EOP) {
-        runcycle = false;
+void sim_pipe::Instruction_writeback() {
+    const instruction_t &instr = MEM_WB_REGISTER_COLUMN.IR;
+    if (instr.opcode == NOP || instr.opcode == EOP)
         return;
+    unsigned dest = destination_register(instr);
+    if (dest != UNDEFINED)
+        integer_register[dest] = (instr.opcode == LW) ? MEM_WB_REGISTER_COLUMN.LMD : MEM_WB_REGISTER_COLUMN.ALU_OUTPUT;
+    no_of_instruction_executed++;
+    if (trace != NULL && MEM_WB_REGISTER_COLUMN.seq != UNDEFINED) {
+        in_flight(MEM_WB_REGISTER_COLUMN.seq).retire = clock_cycles;
+        trace_instruction(MEM_WB_REGISTER_COLUMN.seq);
     }
+}
 
-
-    if (clock_cycles >= 4) {
-
-        if (MEM_WB_REGISTER_COLUMN.IR.opcode == LW) {
-            integer_register[MEM_WB_REGISTER_COLUMN.IR.dest] = MEM_WB_REGISTER_COLUMN.LMD;
-        } else {
-            integer_register[MEM_WB_REGISTER_COLUMN.IR.dest] = MEM_WB_REGISTER_COLUMN.ALU_OUTPUT;
-        }
-
-    }
+/* writes the timeline of an instruction leaving the pipeline to the trace, squashed if it did not retire */
+void sim_pipe::trace_instruction(unsigned seq)
+{
+    if (seq == UNDEFINED)
+        return;
+    const pipeview_record_t &record = in_flight(seq);
+    trace->write(record, instr_names[instruction_at((record.pc - instr_base_address) >> 2).opcode]);
 }
+
 /**
- * This function is implemented to detect data hazard in the pipeline
+ * This function is implemented to detect data hazard in the pipeline: the instruction in ID reads
+ * a register an instruction ahead of it has not written back yet. They sit in EX/MEM and MEM/WB,
+ * the stages behind ID having already run this cycle. WB writes before ID reads within a cycle.
+ * With forwarding only a load that has just left EX is too late
  * @return
  */
-
 bool sim_pipe::Detect_DataHazard()
 {
-    opcode_t ID_Stage_op=ID_EX_PIPELINE_CLOUMN.IR.opcode;
-    opcode_t EX_STage_op=EX_MEM_PIPELINE_COLUMN.IR.opcode;
-    opcode_t MEM_Stage_op=MEM_WB_REGISTER_COLUMN.IR.opcode;
-    //Check the src and destination registers
-    //Put an extra check for NOP for that stage
-    ///////CHECKING FOR HAZARDS WITH EXECUTION AND DECODE
-    if(EX_STage_op!=SW && EX_MEM_PIPELINE_COLUMN.IR.src1!=UNDEFINED) {
-        if (ID_Stage_op != SW&& ID_EX_PIPELINE_CLOUMN.IR.src1!=UNDEFINED) {
-            if ((ID_EX_PIPELINE_CLOUMN.IR.src1 == EX_MEM_PIPELINE_COLUMN.IR.dest)
-                || (ID_EX_PIPELINE_CLOUMN.IR.src2 == EX_MEM_PIPELINE_COLUMN.IR.dest)
-                   && (EX_MEM_PIPELINE_COLUMN.IR.opcode != NOP))//For operations except store
-            {
-                data_hazard = true;
-                pipline_needs_stalling=true;
-                return data_hazard;
-            }
-        } else {
-            if ((ID_EX_PIPELINE_CLOUMN.IR.src1 == EX_MEM_PIPELINE_COLUMN.IR.dest)
-                || (ID_EX_PIPELINE_CLOUMN.IR.dest = EX_MEM_PIPELINE_COLUMN.IR.dest)) {
-                data_hazard = true;
-                pipline_needs_stalling=true;
-                return data_hazard;
-            }
-        }
+    const instruction_t &instr = IF_ID_PIPELINE_COLUMN.IR;
+    load_hazard = false;
+    if (reads_result_of(instr, EX_MEM_PIPELINE_COLUMN.IR)) {
+        load_hazard = (EX_MEM_PIPELINE_COLUMN.IR.opcode == LW);
+        hazard_register = destination_register(EX_MEM_PIPELINE_COLUMN.IR);
+        if (!forwarding || load_hazard)
+            return true;
     }
-
-    ///CHECKING FOR HAZARDS WITH MEMORY AND WRITEBACK
-
-    if(MEM_Stage_op!=SW)
-    {
-        if(ID_Stage_op!=SW)
-            if ((ID_EX_PIPELINE_CLOUMN.IR.src1 == MEM_WB_REGISTER_COLUMN.IR.dest)
-                || (ID_EX_PIPELINE_CLOUMN.IR.src2 == MEM_WB_REGISTER_COLUMN.IR.dest)
-                   )//For operations except store
-            {
-                data_hazard = true;
-                pipline_needs_stalling=true;
-                return data_hazard;
-            }
-
-        else
-            {
-                if ((ID_EX_PIPELINE_CLOUMN.IR.src1 == MEM_WB_REGISTER_COLUMN.IR.dest)
-                    || (ID_EX_PIPELINE_CLOUMN.IR.dest = MEM_WB_REGISTER_COLUMN.IR.dest)
-                      ) {
-                    data_hazard = true;
-                    pipline_needs_stalling=true;
-                    return data_hazard;
-                }
-            }
-         }
-    pipline_needs_stalling=false;
-    data_hazard= false;
-    return data_hazard;
-
+    if (!forwarding && reads_result_of(instr, MEM_WB_REGISTER_COLUMN.IR)) {
+        load_hazard = (MEM_WB_REGISTER_COLUMN.IR.opcode == LW);
+        hazard_register = destination_register(MEM_WB_REGISTER_COLUMN.IR);
+        return true;
+    }
+    return false;
 }
 
+/* a branch decoded this cycle or in EX keeps IF from fetching, its target is known in MEM */
 bool sim_pipe::Detect_ControlHazard()
 {
-    opcode_t branch_Check=ID_EX_PIPELINE_CLOUMN.IR.opcode;
-    if(Detect_Branch(branch_Check))
-    {
-      control_hazard=true;
-      pipline_needs_stalling=true;
-        return control_hazard;
-
-    }
-    control_hazard= false;
-    pipline_needs_stalling=false;
-    return control_hazard;
-
-
+    return Detect_Branch(ID_EX_PIPELINE_CLOUMN.IR.opcode) || Detect_Branch(EX_MEM_PIPELINE_COLUMN.IR.opcode);
 }
 
 bool sim_pipe::Detect_Branch(opcode_t opcode)
@@ -731,61 +925,178 @@ bool sim_pipe::Detect_Branch(opcode_t opcode)
     }
     return false;
 }
+
+/**
+ * Stalls ID on a data hazard, inserting a bubble into EX, and counts the stall by its cause
+ * @return true if ID stalls this cycle
+ */
 bool sim_pipe::handle_hazard()
 {
-    //Hazards are detcted in decode stage but the actual control occurs in execute stage
-    //Where we start stalling the pipeline
-    if(clock_cycles>=1)
-    {
-        if(pipline_needs_stalling&&ID_EX_PIPELINE_CLOUMN.IR.opcode!=NOP)
-        {
-
-            /**\
-             Ask professor if logic of bot data hazrds and control hazrds are correct
-             or not
-             */
-            if(Detect_DataHazard()&&Detect_ControlHazard())
-            {
-                EX_MEM_PIPELINE_COLUMN.IR.opcode=NOP;
-                EX_MEM_PIPELINE_COLUMN.IR=ID_EX_PIPELINE_CLOUMN.IR;
-                ID_EX_PIPELINE_CLOUMN.IR.opcode=NOP;
-                pipline_needs_stalling=false;
-                return true;
-            }
+    if(!Detect_DataHazard())
+        return false;
+    if(load_hazard)
+        counters.load_use_stalls++;
+    else
+        counters.raw_stalls[hazard_register]++;
+    return true;
+}
 
-            else if(Detect_ControlHazard())
-            {
-                EX_MEM_PIPELINE_COLUMN.IR=ID_EX_PIPELINE_CLOUMN.IR;
-                ID_EX_PIPELINE_CLOUMN.IR.opcode=NOP;
-                pipline_needs_stalling=false;
-                return true;
-            }
+/**
+ * Squashes the instructions that have not written back yet, registers are only written in WB
+ * and a store that already went through MEM writes the same value again when it is replayed
+ * @return index of the oldest squashed instruction, where functional execution resumes
+ */
+unsigned sim_pipe::squash_pipeline()
+{
+    if(MEM_WB_REGISTER_COLUMN.IR.opcode!=NOP)
+        return MEM_WB_REGISTER_COLUMN.index;
+    if(EX_MEM_PIPELINE_COLUMN.IR.opcode!=NOP)
+        return EX_MEM_PIPELINE_COLUMN.index;
+    if(ID_EX_PIPELINE_CLOUMN.IR.opcode!=NOP)
+        return ID_EX_PIPELINE_CLOUMN.index;
+    if(IF_ID_PIPELINE_COLUMN.IR.opcode!=NOP)
+        return IF_ID_PIPELINE_COLUMN.index;
+    return (PC_ADDER-instr_base_address)>>2;
+}
 
-            else if(Detect_DataHazard())
-            {
-                EX_MEM_PIPELINE_COLUMN.IR.opcode=NOP;//DONT DO ANYTHING WITH THAT INSTRUCTION
-                pipline_needs_stalling=false;
-                return true;
-            }
+/**
+ * Empties the latches and restarts the detailed pipeline at the given instruction,
+ * so the next run() fills the stages as at the start of a program
+ */
+void sim_pipe::enter_detailed_mode(unsigned instruction_index)
+{
+    if(trace!=NULL)
+    {
+        //the instructions in flight are squashed, the functional replay is not traced
+        trace_instruction(MEM_WB_REGISTER_COLUMN.seq);
+        trace_instruction(EX_MEM_PIPELINE_COLUMN.seq);
+        trace_instruction(ID_EX_PIPELINE_CLOUMN.seq);
+        trace_instruction(IF_ID_PIPELINE_COLUMN.seq);
+    }
+    IF_ID_PIPELINE_COLUMN=decltype(IF_ID_PIPELINE_COLUMN)();
+    ID_EX_PIPELINE_CLOUMN=decltype(ID_EX_PIPELINE_CLOUMN)();
+    EX_MEM_PIPELINE_COLUMN=decltype(EX_MEM_PIPELINE_COLUMN)();
+    MEM_WB_REGISTER_COLUMN=decltype(MEM_WB_REGISTER_COLUMN)();
+    PC_ADDER=instr_base_address+(instruction_index<<2);
+    memory_cycles_left=0;
+    memory_access_ready=false;
+    memory_bubble=false;
+    end_of_program_reached=false;
+    decode_stalled=false;
+    load_hazard=false;
+    branch_squash=false;
+}
 
-            else
+/**
+ * Functional interpreter sharing the register file and data memory with the pipeline,
+ * one instruction per iteration with no latches, hazards or cycle accounting.
+ * Instructions in flight in the detailed pipeline are squashed and replayed here
+ * @params:: instruction budget, PC at which to hand back to the detailed pipeline (UNDEFINED for none)
+ * @return number of instructions executed
+ */
+unsigned sim_pipe::fast_forward(unsigned instructions, unsigned stop_pc)
+{
+    if (integer_register.empty()) {
+        integer_register = create_integer_Point_registers();
+    }
+    unsigned index=squash_pipeline();
+
+    unsigned *regs=&integer_register[0];
+    const instruction_t *program=instr_memory.data();
+    unsigned program_size=instr_memory.size();
+    unsigned stop_index=(stop_pc==UNDEFINED || stop_pc<instr_base_address)?UNDEFINED:(stop_pc-instr_base_address)>>2;
+    unsigned executed=0;
+    bool fault=false;
+    while(executed<instructions && index<program_size && index!=stop_index)
+    {
+        const instruction_t &instr=program[index];
+        if(instr.opcode==EOP)
+            break;
+        unsigned next=index+1;
+        unsigned address;
+        switch(instr.opcode)
+        {
+            case ADD:
+            case ADDI:
+            case SUB:
+            case SUBI:
+            case XOR:
+                regs[instr.dest]=alu(instr.opcode, regs[instr.src1], regs[instr.src2], instr.immediate, 0);
+                break;
+            case LW:
+                address=regs[instr.src1]+instr.immediate;
+                if(address>data_memory_size-4)
+                {
+                    cout << "ERROR: load from 0x" << hex << address << " is outside the data memory" << dec << endl;
+                    fault=true;
+                    break;
+                }
+                regs[instr.dest]=char2int(data_memory+address);
+                break;
+            case SW:
+                address=regs[instr.src2]+instr.immediate;
+                if(address>data_memory_size-4)
+                {
+                    cout << "ERROR: store to 0x" << hex << address << " is outside the data memory" << dec << endl;
+                    fault=true;
+                    break;
+                }
+                write_memory(address, regs[instr.src1]);
+                break;
+            case BEQZ:
+                if((int)regs[instr.src1]==0) next=instr.target;
+                break;
+            case BNEZ:
+                if((int)regs[instr.src1]!=0) next=instr.target;
+                break;
+            case BLTZ:
+                if((int)regs[instr.src1]<0) next=instr.target;
+                break;
+            case BGTZ:
+                if((int)regs[instr.src1]>0) next=instr.target;
+                break;
+            case BLEZ:
+                if((int)regs[instr.src1]<=0) next=instr.target;
+                break;
+            case BGEZ:
+                if((int)regs[instr.src1]>=0) next=instr.target;
+                break;
+            case JUMP:
+                next=instr.target;
+                break;
+            default:
+                break;
+        }
+        if(fault)
+            break;
+        if(predictor!=NULL && Detect_Branch(instr.opcode))
+        {
+            //keeps the predictor and the BTB warm for the detailed pipeline
+            unsigned pc=instr_base_address+(index<<2);
+            branch_history_t history;
+            if(instr.opcode!=JUMP)
             {
-
-                //cout<<"Wrong hazard handling"<<endl;
-                return false;
+                predictor->predict(pc, &history);
+                predictor->update(pc, next!=index+1, history);
             }
-
-
-
-
+            if(next!=index+1)
+                btb.update(pc, instr_base_address+(next<<2));
         }
-        return false;
-
+        index=next;
+        executed++;
     }
-    return false;
-
+    fast_forwarded_instructions+=executed;
+    enter_detailed_mode(index);
+    return executed;
 }
 
+unsigned sim_pipe::get_instructions_fast_forwarded() {
+    return fast_forwarded_instructions;
+}
 
-
-
+/* returns the decoded instruction at "index", addresses past the loaded program read as EOP */
+const instruction_t &sim_pipe::instruction_at(unsigned index){
+    static const instruction_t past_end = {EOP, UNDEFINED, UNDEFINED, UNDEFINED, UNDEFINED, UNDEFINED};
+    if (index < instr_memory.size()) return instr_memory[index];
+    return past_end;
+}
@@ -5,9 +5,13 @@
 #include <string>
 //included extra
 #include <vector>
+#include <type_traits>
+#include "../Cache_heirarchy/memory_backend.h"
+#include "branch_predictor.h"
+#include "pipeline_counters.h"
+#include "pipeview_trace.h"
 using namespace std;
 
-#define PROGRAM_SIZE 50
 
 #define UNDEFINED 0xFFFFFFFF //used to initialize the registers
 #define NUM_SP_REGISTERS 9
@@ -18,18 +22,31 @@ using namespace std;
 
 typedef enum {PC, NPC,  IR, A, B, IMM, COND, ALU_OUTPUT, LMD} sp_register_t;
 
-typedef enum {LW, SW, ADD, ADDI, SUB, SUBI, XOR, BEQZ, BNEZ, BLTZ, BGTZ, BLEZ, BGEZ, JUMP, EOP, NOP} opcode_t;
+typedef enum : unsigned char {LW, SW, ADD, ADDI, SUB, SUBI, XOR, BEQZ, BNEZ, BLTZ, BGTZ, BLEZ, BGEZ, JUMP, EOP, NOP} opcode_t;
 
 typedef enum {IF, ID, EXE, MEM, WB} stage_t;
 
+// register number of a decoded instruction, one byte wide; 0xFF reads back as UNDEFINED
+struct reg_field_t{
+        unsigned char number;
+        reg_field_t() = default;
+        reg_field_t(unsigned reg) : number(reg > 0xFF ? 0xFF : reg) {}
+        operator unsigned() const { return number == 0xFF ? UNDEFINED : number; }
+};
+
+// decoded micro-op, copied through the pipeline latches every cycle: plain data, no heap
 typedef struct{
         opcode_t opcode; //opcode
-        unsigned src1; //first source register in the assembly instruction (for SW, register to be written to memory)
-        unsigned src2; //second source register in the assembly instruction
-        unsigned dest; //destination register
-        unsigned immediate; //immediate field
-        string label; //for conditional branches, label of the target instruction - used only for parsing/debugging purposes
+        reg_field_t src1; //first source register in the assembly instruction (for SW, register to be written to memory)
+        reg_field_t src2; //second source register in the assembly instruction
+        reg_field_t dest; //destination register
+        unsigned immediate; //immediate field (for branches, offset to the target)
+        unsigned target; //for branches, index of the target instruction resolved at load time, UNDEFINED otherwise
 } instruction_t;
+static_assert(sizeof(instruction_t) <= 16 && is_trivially_copyable<instruction_t>::value, "instruction_t must stay a 16-byte POD");
+
+// contents of an empty latch
+static const instruction_t BUBBLE_INSTRUCTION = {NOP, UNDEFINED, UNDEFINED, UNDEFINED, UNDEFINED, UNDEFINED};
 
 
 
@@ -47,31 +64,37 @@ class sim_pipe{
          * Data Members added by me
          */
         unsigned PC_ADDER;
-        int instruction_no=0;
         int no_of_instruction_executed=0;
         int clock_cycles=0;
-        bool runcycle=false;
-        bool data_hazard=false;
-        bool control_hazard=false;
-        bool structural_hazard=false;
         unsigned *latency;
 
 
     /**
 * Five structs for 5 pipeline registers
 * Save yourself from using arrays
-*
+* index is the position of IR in the instruction memory, where a squash resumes
+* predicted_pc is where fetch went after IR, checked when a branch resolves
+* history is the global history IR was predicted with, which its outcome trains
+* seq numbers the instructions traced, UNDEFINED when tracing is off
 */
     struct
     {
         unsigned NPC = (UNDEFINED);
-        instruction_t IR;
+        instruction_t IR = BUBBLE_INSTRUCTION;
+        unsigned index = UNDEFINED;
+        unsigned predicted_pc = UNDEFINED;
+        branch_history_t history = 0;
+        unsigned seq = UNDEFINED;
     }IF_ID_PIPELINE_COLUMN;
 
     struct
     {
         unsigned NPC=(UNDEFINED);
-        instruction_t IR;
+        instruction_t IR = BUBBLE_INSTRUCTION;
+        unsigned index = UNDEFINED;
+        unsigned predicted_pc = UNDEFINED;
+        branch_history_t history = 0;
+        unsigned seq = UNDEFINED;
         unsigned A=sp_register_t (UNDEFINED);
         unsigned  B=sp_register_t (UNDEFINED);
         unsigned IMM=sp_register_t (UNDEFINED);
@@ -79,7 +102,11 @@ class sim_pipe{
 
     struct
     {
-        instruction_t IR;
+        instruction_t IR = BUBBLE_INSTRUCTION;
+        unsigned index = UNDEFINED;
+        unsigned predicted_pc = UNDEFINED;
+        branch_history_t history = 0;
+        unsigned seq = UNDEFINED;
         unsigned COND=sp_register_t(UNDEFINED);
         unsigned ALU_OUTPUT=sp_register_t(UNDEFINED);
         unsigned B=sp_register_t (UNDEFINED);
@@ -87,7 +114,9 @@ class sim_pipe{
 
     struct
     {
-        instruction_t IR;
+        instruction_t IR = BUBBLE_INSTRUCTION;
+        unsigned index = UNDEFINED;
+        unsigned seq = UNDEFINED;
         unsigned  LMD=(UNDEFINED);
        unsigned ALU_OUTPUT=sp_register_t (UNDEFINED);
     }MEM_WB_REGISTER_COLUMN;
@@ -100,7 +129,9 @@ class sim_pipe{
          * END
          */
         //instruction memory 
-        instruction_t instr_memory[PROGRAM_SIZE];
+        vector<instruction_t> instr_memory;
+        vector<string> branch_labels; //label of each branch as written in the program, for debugging
+        const instruction_t &instruction_at(unsigned index);
 
         //base address in the instruction memory where the program is loaded
         unsigned instr_base_address;
@@ -116,17 +147,53 @@ class sim_pipe{
 	bool Detect_DataHazard();
 	bool Detect_ControlHazard();
 	bool handle_hazard();
-	bool pipline_needs_stalling=false;
-	bool count_stalls_inserted=0;
-	bool there_is_a_branch(opcode_t);
-    bool Hazard_Check=false;
 	bool Detect_Branch(opcode_t);
-	void read_memory(unsigned ,unsigned);
 	bool end_of_program_reached=false;
+
+	//hazards: with forwarding EX takes its operands from the instruction ahead of it,
+	//so only a load followed by a use of its result stalls ID
+	bool forwarding;
+	bool decode_stalled=false;   //ID holds its instruction this cycle, so IF holds too
+	bool load_hazard=false;      //the hazard found by Detect_DataHazard waits on a load
+	unsigned hazard_register=UNDEFINED;  //and on this register
+	unsigned operand(unsigned reg, unsigned read_in_decode);
+
+	//stalls by cause, per-stage occupancy
+	pipeline_counters counters;
+
+	//O3PipeView trace: the timelines of the instructions in flight, kept until they leave the pipeline
+	static const unsigned TRACED_IN_FLIGHT = 8;
+	pipeview_trace *trace=NULL;
+	pipeview_record_t traced_instructions[TRACED_IN_FLIGHT];
+	unsigned next_seq=0;
+	pipeview_record_t &in_flight(unsigned seq) { return traced_instructions[seq % TRACED_IN_FLIGHT]; }
+	void trace_instruction(unsigned seq);
+
+	//branch prediction: with a predictor IF follows the predicted path past each branch and MEM
+	//squashes it on a misprediction, without one IF waits for the branch to resolve
+	branch_predictor *predictor=NULL;
+	branch_target_buffer btb;
+	bool branch_squash=false;    //MEM found a misprediction this cycle, EX and ID drop the wrong path
+	unsigned predict_next_pc(unsigned pc, opcode_t opcode, branch_history_t *history);
+	void resolve_branch();
+	unsigned branches=0;
+	unsigned mispredictions=0;
+
+	unsigned fast_forwarded_instructions=0;
+	void clock_tick();
+	unsigned squash_pipeline();
+	void enter_detailed_mode(unsigned instruction_index);
 	
 	//memory latency in clock cycles
 	unsigned data_memory_latency;
 
+	//timing of the MEM stage: the backend gives the extra cycles of each access, during which every stage holds
+	fixed_latency_memory fixed_memory;
+	memory_backend *memory;
+	unsigned memory_cycles_left=0;    //stall cycles still to go for the access in MEM
+	bool memory_access_ready=false;   //the access in MEM has waited its latency and completes this cycle
+	bool memory_bubble=false;         //MEM/WB holds no new instruction while MEM waits
+
 public:
 
 	//instantiates the simulator with a data memory of given size (in bytes) and latency (in clock cycles)
@@ -134,7 +201,8 @@ public:
            - initialize the registers to UNDEFINED value 
 	   - initialize the data memory to all 0xFF values
 	*/
-	sim_pipe(unsigned data_mem_size, unsigned data_mem_latency);
+	//with "forwarding" results go from EX/MEM and MEM/WB straight back to EX instead of waiting for WB
+	sim_pipe(unsigned data_mem_size, unsigned data_mem_latency, bool forwarding=false);
 	
 	//de-allocates the simulator
 	~sim_pipe();
@@ -142,6 +210,10 @@ public:
 	//loads the assembly program in file "filename" in instruction memory at the specified address
 	void load_program(const char *filename, unsigned base_address=0x0);
 
+	//loads an RV32I ELF32 executable: the executable segment goes to instruction memory, the other
+	//segments to data memory at their addresses, and execution starts at the entry point
+	void load_elf(const char *filename);
+
 	//runs the simulator for "cycles" clock cycles (run the program to completion if cycles=0) 
 	void run(unsigned cycles=0);
 	//resets the state of the simulator
@@ -185,6 +257,59 @@ public:
 	//returns the number of stalls added by processor
 	unsigned get_stalls();
 
+	//returns the number of those stalls spent waiting for data memory
+	unsigned get_memory_stalls();
+
+	//returns the number of those stalls spent waiting for the result of a load
+	unsigned get_load_use_stalls();
+
+	//returns the number of those stalls spent waiting for the result of any other instruction (RAW)
+	unsigned get_data_stalls();
+
+	//returns the number of those stalls spent waiting for a branch to resolve, or on the
+	//instructions squashed after a misprediction
+	unsigned get_control_stalls();
+
+	//fetches past branches along the path "predictor" (not owned) predicts, taking targets from a
+	//BTB of "btb_entries" entries (a power of 2); NULL goes back to stalling fetch on every branch
+	void set_branch_predictor(branch_predictor *predictor, unsigned btb_entries=64);
+
+	//returns the number of branches and jumps resolved with a predictor
+	unsigned get_branches();
+
+	//returns the number of those whose next PC was mispredicted
+	unsigned get_mispredictions();
+
+	//returns the fraction of branches predicted correctly
+	float get_branch_accuracy();
+
+	//returns the mispredictions per thousand instructions
+	float get_MPKI();
+
+	//streams the stage timeline of every instruction to "trace" (not owned) in the O3PipeView format,
+	//squashed instructions included; NULL stops tracing
+	void set_trace(pipeview_trace *trace);
+
+	//returns every performance counter as a key and its current value: stalls by cause (RAW ones
+	//by register), and the cycles each stage spent on an instruction or on a bubble
+	vector<pair<string, unsigned> > get_counters();
+
+	//prints the performance counters as key=value lines
+	void print_counters();
+
+	//takes the MEM stage latency from "backend" (not owned) instead of data_memory_latency,
+	//NULL goes back to the fixed latency
+	void set_memory_backend(memory_backend *backend);
+
+	//executes up to "instructions" instructions functionally (no timing), stopping early at EOP or
+	//before the instruction at "stop_pc"; instructions in flight in the pipeline are squashed and
+	//replayed first, and the next run() refills the pipeline from where the interpreter stopped.
+	//Returns the number of instructions executed
+	unsigned fast_forward(unsigned instructions, unsigned stop_pc=UNDEFINED);
+
+	//returns the number of instructions executed by fast_forward
+	unsigned get_instructions_fast_forwarded();
+
 	//prints the content of the data memory within the specified address range
 	void print_memory(unsigned start_address, unsigned end_address);
 
@@ -197,14 +322,11 @@ public:
 	/**
 	 * Functions added by me to the header file
 	 */
-	 void Instruction_fetch(int instruction_index);
-	 void Instruction_decode(int instruction_index);
-	 void Instruction_execute(int instruction_index);
-	 void Instruction_memory(int instruction_index);
-	 void Instruction_writeback(int instruction_index);
-
-
-	 bool flag_got_EOP=false;
+	 void Instruction_fetch();
+	 void Instruction_decode();
+	 void Instruction_execute();
+	 void Instruction_memory();
+	 void Instruction_writeback();
 
 
 
@@ -9,6 +9,7 @@
  * 
  */
 #include "sim_pipe_fp.h"
+#include "rv32i.h"
 #include <stdlib.h>
 #include <iostream>
 #include <fstream>
@@ -16,6 +17,8 @@
 #include <string>
 #include <iomanip>
 #include <map>
+#include <algorithm>
+#include <iterator>
 
 //NOTE: structural hazards on MEM/WB stage not handled
 //====================================================
@@ -90,6 +93,27 @@ bool is_fp_alu(opcode_t opcode){
         return (opcode == ADDS || opcode == SUBS || opcode == MULTS || opcode == DIVS);
 }
 
+/* register written by an instruction, F registers numbered after the integer ones, UNDEFINED if none */
+static unsigned result_register(const instruction_t &instr){
+        switch(instr.opcode){
+                case ADD:
+                case ADDI:
+                case SUB:
+                case SUBI:
+                case XOR:
+                case LW:
+                        return instr.dest;
+                case LWS:
+                case ADDS:
+                case SUBS:
+                case MULTS:
+                case DIVS:
+                        return NUM_GP_REGISTERS + instr.dest;
+                default:
+                        return UNDEFINED;
+        }
+}
+
 /* implements the ALU operations */
 unsigned alu(unsigned opcode, unsigned a, unsigned b, unsigned imm, unsigned npc){
 	switch(opcode){
@@ -200,6 +224,7 @@ void sim_pipe_fp::init_exec_unit(exe_unit_t exec_unit, unsigned latency, unsigne
 		exec_units[num_units].latency = latency;
 		exec_units[num_units].busy = 0;
 		exec_units[num_units].instruction.opcode = NOP;
+		counters.add_unit(string(unit_names[exec_unit]) + to_string(num_units));
 		num_units++;
 	}
 }
@@ -229,20 +254,20 @@ unsigned sim_pipe_fp::get_free_unit(opcode_t opcode){
 			case JUMP:
 			case LWS: 
 			case SWS:
-				if (exec_units[u].type==INTEGER && exec_units[u].busy==0) return u;
+				if (exec_units[u].type==INTEGER && !unit_in_use(u)) return u;
 				break;
 			// FP adder
 			case ADDS:
 			case SUBS:
-				if (exec_units[u].type==ADDER && exec_units[u].busy==0) return u;
+				if (exec_units[u].type==ADDER && !unit_in_use(u)) return u;
 				break;
 			// Multiplier
 			case MULTS:
-				if (exec_units[u].type==MULTIPLIER && exec_units[u].busy==0) return u;
+				if (exec_units[u].type==MULTIPLIER && !unit_in_use(u)) return u;
 				break;
 			// Divider
 			case DIVS:
-				if (exec_units[u].type==DIVIDER && exec_units[u].busy==0) return u;
+				if (exec_units[u].type==DIVIDER && !unit_in_use(u)) return u;
 				break;
 			default:
 				cout << "ERROR:: operations not requiring exec unit!\n";
@@ -252,6 +277,24 @@ unsigned sim_pipe_fp::get_free_unit(opcode_t opcode){
 	return UNDEFINED;
 }
 
+/* returns the unit of the type "opcode" needs that frees up first */
+unsigned sim_pipe_fp::first_unit_to_free(opcode_t opcode){
+	exe_unit_t type = INTEGER;
+	if (opcode == ADDS || opcode == SUBS) type = ADDER;
+	else if (opcode == MULTS) type = MULTIPLIER;
+	else if (opcode == DIVS) type = DIVIDER;
+	unsigned first = UNDEFINED;
+	for (unsigned u=0; u<num_units; u++){
+		if (exec_units[u].type != type) continue;
+		if (first == UNDEFINED || exec_units[u].busy < exec_units[first].busy) first = u;
+	}
+	if (first == UNDEFINED){
+		cout << "ERROR:: simulator does not have any " << unit_names[type] << " unit!\n";
+		exit(-1);
+	}
+	return first;
+}
+
 /* decrease the amount of clock cycles during which the functional unit will be busy - to be called at each clock cycle  */
 void sim_pipe_fp::decrement_units_busy_time(){
 	for (unsigned u=0; u<num_units; u++){
@@ -277,6 +320,7 @@ void sim_pipe_fp::load_program(const char *filename, unsigned base_address){
 
    /* initializing the base instruction address */
    instr_base_address = base_address;
+   PC_ADDER = instr_base_address;
 
    /* creating a map with the valid opcodes and with the valid labels */
    map<string, opcode_t> opcodes; //for opcodes
@@ -294,6 +338,13 @@ void sim_pipe_fp::load_program(const char *filename, unsigned base_address){
    /* parsing the assembly file line by line */
    string line;
    unsigned instruction_nr = 0;
+   // one decoded entry per line, sized up front so parsing never reallocates the store
+   instr_memory.clear();
+   instr_memory.reserve(count(istreambuf_iterator<char>(fin), istreambuf_iterator<char>(), '\n') + 1);
+   branch_labels.clear();
+   branch_labels.reserve(instr_memory.capacity());
+   fin.clear();
+   fin.seekg(0);
    while (getline(fin,line)){
 
 	// set the instruction field
@@ -311,6 +362,8 @@ void sim_pipe_fp::load_program(const char *filename, unsigned base_address){
 		search = opcodes.find(token);
 		if (search == opcodes.end()) cout << "ERROR: invalid opcode: " << token << " !" << endl;
 	}
+	instr_memory.push_back(instruction_at(instruction_nr));
+	branch_labels.push_back(string());
 	instr_memory[instruction_nr].opcode = search->second;
 
 	//reading remaining parameters
@@ -366,11 +419,11 @@ void sim_pipe_fp::load_program(const char *filename, unsigned base_address){
 			par1 = strtok (NULL, " \t");
 			par2 = strtok (NULL, " \t");
 			instr_memory[instruction_nr].src1 = atoi(strtok(par1, "R"));
-			instr_memory[instruction_nr].label = par2;
+			branch_labels[instruction_nr] = par2;
 			break;
 		case JUMP:
 			par2 = strtok (NULL, " \t");
-			instr_memory[instruction_nr].label = par2;
+			branch_labels[instruction_nr] = par2;
 		default:
 			break;
 
@@ -380,8 +433,7 @@ void sim_pipe_fp::load_program(const char *filename, unsigned base_address){
 	instruction_nr++;
    }
    //reconstructing the labels of the branch operations
-   int i = 0;
-   while(true){
+   for (unsigned i = 0; i < instr_memory.size(); i++) {
    	instruction_t instr = instr_memory[i];
 	if (instr.opcode == EOP) break;
 	if (instr.opcode == BLTZ || instr.opcode == BNEZ ||
@@ -389,9 +441,9 @@ void sim_pipe_fp::load_program(const char *filename, unsigned base_address){
             instr.opcode == BGEZ || instr.opcode == BLEZ ||
             instr.opcode == JUMP
 	 ){
-		instr_memory[i].immediate = (labels[instr.label] - i - 1) << 2;
+		instr_memory[i].target = labels[branch_labels[i]];
+		instr_memory[i].immediate = (instr_memory[i].target - i - 1) << 2;
 	}
-        i++;
    }
 
 }
@@ -402,63 +454,87 @@ void sim_pipe_fp::load_program(const char *filename, unsigned base_address){
 
    ============================================================= */
 
+/* false for bubbles and the EOP, which do no work in a stage */
+static inline bool holds_instruction(const instruction_t &instr)
+{
+    return instr.opcode!=NOP && instr.opcode!=EOP;
+}
+
 /* simulator */
 void sim_pipe_fp::run(unsigned cycles)
 {
-    int total_no_clock_cycle_eapsed = 0;
-    if(cycles==0)
+    unsigned i=0;
+    while((cycles==0 || i<cycles) && !end_of_program_reached)
     {
-        runcycle= true;
-
+        clock_tick();
+        i++;
     }
+}
 
-
-    int i=0;
-    while(i<cycles || runcycle)
+/**
+ * Advances the pipeline by one clock cycle, stages run back to front so each reads the latch of the previous cycle.
+ * The program has ended once the EOP is decoded and every instruction ahead of it has written back
+ */
+void sim_pipe_fp::clock_tick()
+{
+    bool executing=false;
+    for (unsigned u=0; u<num_units; u++) executing = executing || unit_in_use(u);
+    counters.count_stage(ID, holds_instruction(IF_ID_PIPELINE_COLUMN.IR));
+    counters.count_stage(EXE, executing || holds_instruction(ID_EX_PIPELINE_CLOUMN.IR));
+    counters.count_stage(MEM, holds_instruction(EX_MEM_PIPELINE_COLUMN.IR));
+    counters.count_stage(WB, holds_instruction(MEM_WB_REGISTER_COLUMN.IR));
+    Instruction_writeback();
+    Instruction_memory();
+    if(memory_bubble)
     {
-
-        //Intruction Fetech STage work on IF/ID column
-
-        Instruction_writeback(instruction_no-4);
-        Instruction_memory(instruction_no-3);
-
-        Instruction_execute(instruction_no-2);
-
-
-        Instruction_decode(instruction_no-1);
-        Instruction_fetch(instruction_no);
-        if(runcycle)
-        {
-            unsigned d=IF_ID_PIPELINE_COLUMN.NPC;
-            cout<<IF_ID_PIPELINE_COLUMN.NPC;
-        }
-
-        i++;
+        //MEM is waiting for data memory, the stages behind it and the functional units hold
+        counters.memory_stalls++;
+        counters.count_stage(IF, false);
         clock_cycles=clock_cycles+1;
-        instruction_no++;
-
-
-
+        return;
     }
-
-
-    no_of_instruction_executed++;
+    Instruction_execute();
+    Instruction_decode();
+    Instruction_fetch();
+    clock_cycles=clock_cycles+1;
+    if(ID_EX_PIPELINE_CLOUMN.IR.opcode!=EOP || holds_instruction(EX_MEM_PIPELINE_COLUMN.IR) || holds_instruction(MEM_WB_REGISTER_COLUMN.IR))
+        return;
+    for (unsigned u=0; u<num_units; u++)
+        if (unit_in_use(u)) return;
+    end_of_program_reached=true;
 }
 	
 //reset the state of the sim_pipe_fpulator
 void sim_pipe_fp::reset(){
 	// init data memory
 	for (unsigned i=0; i<data_memory_size; i++) data_memory[i]=0xFF;
-	// init instruction memory
-	for (int i=0; i<PROGRAM_SIZE;i++){
-		instr_memory[i].opcode=(opcode_t)NOP;
-		instr_memory[i].src1=UNDEFINED;
-		instr_memory[i].src2=UNDEFINED;
-		instr_memory[i].dest=UNDEFINED;
-		instr_memory[i].immediate=UNDEFINED;
-	}
+	//init instruction memory, unloaded addresses read as NOP
+	instr_memory.clear();
+	branch_labels.clear();
 
 	/* complete the reset function here */
+	//registers UNDEFINED, latches and functional units empty
+	integer_register=create_integer_Point_registers();
+	floating_point_register=create_floating_point_registers();
+	IF_ID_PIPELINE_COLUMN=decltype(IF_ID_PIPELINE_COLUMN)();
+	ID_EX_PIPELINE_CLOUMN=decltype(ID_EX_PIPELINE_CLOUMN)();
+	EX_MEM_PIPELINE_COLUMN=decltype(EX_MEM_PIPELINE_COLUMN)();
+	MEM_WB_REGISTER_COLUMN=decltype(MEM_WB_REGISTER_COLUMN)();
+	for (unsigned u=0; u<num_units; u++){
+		exec_units[u].busy = 0;
+		exec_units[u].instruction = BUBBLE_INSTRUCTION;
+	}
+	PC_ADDER = UNDEFINED;
+	no_of_instruction_executed = 0;
+	clock_cycles = 0;
+	decode_stalled = false;
+	end_of_program_reached = false;
+	memory_cycles_left = 0;
+	memory_access_ready = false;
+	memory_bubble = false;
+	counters.reset(2*NUM_GP_REGISTERS);
+	next_seq = 0;
+	for (unsigned i=0; i<TRACED_IN_FLIGHT; i++) traced_instructions[i].seq = UNDEFINED;
 
 }
 
@@ -536,19 +612,55 @@ unsigned sim_pipe_fp::get_sp_register(sp_register_t reg, stage_t s){
     } // please modify
 }
 
+static_assert((int)DECODED_NOP == (int)NOP && (int)DECODED_EOP == (int)EOP && (int)DECODED_JUMP == (int)JUMP,
+              "the RV32I decoder numbers its opcodes like opcode_t");
+
+/* loads an RV32I ELF32 executable, x0 reads as zero and the stack pointer x2 starts at the top of the data memory */
+void sim_pipe_fp::load_elf(const char *filename){
+	elf_image_t image;
+	if (!read_elf32(filename, &image) || !copy_elf_data(image, data_memory, data_memory_size)) exit(-1);
+
+	instr_base_address = image.text_address;
+	unsigned first_unsupported;
+	unsigned unsupported = decode_elf_text(image, instr_memory, &first_unsupported);
+	if (unsupported != 0)
+		cerr << "warning: " << dec << unsupported << " instructions of " << filename
+		     << " have no equivalent and end the program, the first at 0x" << hex << first_unsupported << dec << endl;
+	branch_labels.assign(instr_memory.size(), string());
+
+	integer_register.assign(NUM_GP_REGISTERS, UNDEFINED);
+	integer_register[0] = 0;
+	integer_register[2] = data_memory_size & ~0xFu;
+	PC_ADDER = image.entry;
+}
+
 int sim_pipe_fp::get_int_register(unsigned reg){
-	return 0; // please modify
+	return integer_register[reg];
 }
 
 void sim_pipe_fp::set_int_register(unsigned reg, int value)
 {
+	integer_register[reg] = value;
 }
 
+/* UNDEFINED registers read back as (float)UNDEFINED, which print_registers skips */
 float sim_pipe_fp::get_fp_register(unsigned reg){
-	return 0.0; // please modify
+	if (floating_point_register[reg] == UNDEFINED) return UNDEFINED;
+	return unsigned2float(floating_point_register[reg]);
 }
 
 void sim_pipe_fp::set_fp_register(unsigned reg, float value){
+	floating_point_register[reg] = float2unsigned(value);
+}
+
+/* the integer registers r0-r31, all UNDEFINED */
+vector<unsigned> sim_pipe_fp::create_integer_Point_registers(){
+	return vector<unsigned>(NUM_GP_REGISTERS, UNDEFINED);
+}
+
+/* the floating point registers f0-f31, all UNDEFINED */
+vector<unsigned> sim_pipe_fp::create_floating_point_registers(){
+	return vector<unsigned>(NUM_GP_REGISTERS, UNDEFINED);
 }
 
 
@@ -565,271 +677,375 @@ unsigned sim_pipe_fp::get_clock_cycles(){
 }
 
 unsigned sim_pipe_fp::get_stalls(){
-	return count_stalls_inserted; // please modify
+	return counters.total_stalls();
 }
 
+void sim_pipe_fp::set_trace(pipeview_trace *trace){
+	this->trace = trace;
+}
 
-void sim_pipe_fp::Instruction_fetch(int instruction_index) {
-    IF_ID_PIPELINE_COLUMN.IR = instr_memory[instruction_index];
-    if(IF_ID_PIPELINE_COLUMN.IR.opcode==EOP)
-    {
-        end_of_program_reached= true;
+vector<pair<string, unsigned> > sim_pipe_fp::get_counters(){
+	return counters.export_counters();
+}
 
-        return;
-    }
+void sim_pipe_fp::print_counters(){
+	counters.print();
+}
 
-    if(Detect_Branch(MEM_WB_REGISTER_COLUMN.IR.opcode) && EX_MEM_PIPELINE_COLUMN.COND==1)
-    {
-        IF_ID_PIPELINE_COLUMN.NPC=MEM_WB_REGISTER_COLUMN.ALU_OUTPUT;
-        PC_ADDER=MEM_WB_REGISTER_COLUMN.ALU_OUTPUT;
-    }
 
-    else {
-        if(!end_of_program_reached) {
-            PC_ADDER = PC_ADDER + 4;
-            IF_ID_PIPELINE_COLUMN.NPC = (PC_ADDER);
-        }
+/* the registers an instruction reads, F registers numbered after the integer ones, UNDEFINED where it reads none */
+static void source_registers(const instruction_t &instr, unsigned *first, unsigned *second)
+{
+    *first=UNDEFINED;
+    *second=UNDEFINED;
+    switch(instr.opcode)
+    {
+        case ADD:
+        case SUB:
+        case XOR:
+        case SW:
+            *first=instr.src1;
+            *second=instr.src2;
+            break;
+        case SWS:
+            *first=NUM_GP_REGISTERS+instr.src1;
+            *second=instr.src2;
+            break;
+        case ADDS:
+        case SUBS:
+        case MULTS:
+        case DIVS:
+            *first=NUM_GP_REGISTERS+instr.src1;
+            *second=NUM_GP_REGISTERS+instr.src2;
+            break;
+        case ADDI:
+        case SUBI:
+        case LW:
+        case LWS:
+        case BEQZ:
+        case BNEZ:
+        case BLTZ:
+        case BGTZ:
+        case BLEZ:
+        case BGEZ:
+            *first=instr.src1;
+            break;
+        default:
+            break;
     }
-
 }
-void sim_pipe_fp::Instruction_decode(int instruction_index)
-{
-
-    if(clock_cycles>=1) {
-        if (ID_EX_PIPELINE_CLOUMN.IR.opcode == EOP)
-        {
-            EX_MEM_PIPELINE_COLUMN.IR=ID_EX_PIPELINE_CLOUMN.IR;
-            ID_EX_PIPELINE_CLOUMN.A=UNDEFINED;
-            ID_EX_PIPELINE_CLOUMN.B=UNDEFINED;
-            ID_EX_PIPELINE_CLOUMN.IMM=UNDEFINED;
-            return;
-
-        }
-        if (!handle_hazard()) {
 
-            ID_EX_PIPELINE_CLOUMN.NPC = IF_ID_PIPELINE_COLUMN.NPC;
-            ID_EX_PIPELINE_CLOUMN.IR = IF_ID_PIPELINE_COLUMN.IR;
-
-
-            if (ID_EX_PIPELINE_CLOUMN.IR.opcode == LW) {
-                ID_EX_PIPELINE_CLOUMN.A = integer_register[ID_EX_PIPELINE_CLOUMN.IR.src1];
-                ID_EX_PIPELINE_CLOUMN.IMM = ID_EX_PIPELINE_CLOUMN.IR.immediate;
-                ID_EX_PIPELINE_CLOUMN.B = UNDEFINED;
-
-            } else if (ID_EX_PIPELINE_CLOUMN.IR.opcode == SW) {
-                ID_EX_PIPELINE_CLOUMN.A = integer_register[ID_EX_PIPELINE_CLOUMN.IR.src2];
-                ID_EX_PIPELINE_CLOUMN.B = integer_register[ID_EX_PIPELINE_CLOUMN.IR.src1];
-                ID_EX_PIPELINE_CLOUMN.IMM = ID_EX_PIPELINE_CLOUMN.IR.immediate;
+/* true if "instr" reads the register "producer" writes */
+static bool reads_result_of(const instruction_t &instr, const instruction_t &producer)
+{
+    unsigned dest=result_register(producer);
+    if(dest==UNDEFINED)
+        return false;
+    unsigned first, second;
+    source_registers(instr, &first, &second);
+    return first==dest || second==dest;
+}
 
-            } else {
-                ID_EX_PIPELINE_CLOUMN.A = integer_register[IF_ID_PIPELINE_COLUMN.IR.src1];
-                ID_EX_PIPELINE_CLOUMN.B = integer_register[IF_ID_PIPELINE_COLUMN.IR.src2];
-                ID_EX_PIPELINE_CLOUMN.IMM = IF_ID_PIPELINE_COLUMN.IR.immediate;
-            }
-        } else {
-            count_stalls_inserted = count_stalls_inserted + 1;
-        }
+/* value of a register, F registers numbered after the integer ones */
+unsigned sim_pipe_fp::register_value(unsigned reg)
+{
+    if(reg<NUM_GP_REGISTERS)
+        return integer_register[reg];
+    return floating_point_register[reg-NUM_GP_REGISTERS];
+}
 
+void sim_pipe_fp::Instruction_fetch() {
+    if(decode_stalled)
+    {
+        //IF/ID and the PC hold the instruction ID could not take
+        counters.count_stage(IF, false);
+        return;
     }
-
+    if(Detect_ControlHazard())
+    {
+        //no instruction is fetched until the branch in flight sets the PC in MEM
+        IF_ID_PIPELINE_COLUMN=decltype(IF_ID_PIPELINE_COLUMN)();
+        counters.control_stalls++;
+        counters.count_stage(IF, false);
+        return;
+    }
+    counters.count_stage(IF, true);
+    unsigned index=(PC_ADDER-instr_base_address)>>2;
+    IF_ID_PIPELINE_COLUMN.IR = instruction_at(index);
+    IF_ID_PIPELINE_COLUMN.index = index;
+    IF_ID_PIPELINE_COLUMN.seq = UNDEFINED;
+    if(IF_ID_PIPELINE_COLUMN.IR.opcode==EOP)
+    {
+        //the PC stays on the EOP, fetching it again every cycle
+        IF_ID_PIPELINE_COLUMN.NPC = PC_ADDER;
+        return;
+    }
+    if(trace!=NULL)
+    {
+        //the timeline takes the free entry, the one there wrote back
+        IF_ID_PIPELINE_COLUMN.seq = next_seq++;
+        pipeview_record_t &record = in_flight(UNDEFINED);
+        record.seq = IF_ID_PIPELINE_COLUMN.seq;
+        record.pc = PC_ADDER;
+        record.fetch = clock_cycles;
+        record.decode = record.rename = record.dispatch = record.issue = UNDEFINED;
+        record.complete = record.retire = record.store = UNDEFINED;
+    }
+    PC_ADDER = PC_ADDER + 4;
+    IF_ID_PIPELINE_COLUMN.NPC = PC_ADDER;
 }
 
-
-void sim_pipe_fp::Instruction_execute(int instruction_index)
+void sim_pipe_fp::Instruction_decode()
 {
+    bool traced = (trace!=NULL && IF_ID_PIPELINE_COLUMN.seq!=UNDEFINED);
+    if(traced && in_flight(IF_ID_PIPELINE_COLUMN.seq).decode==UNDEFINED)
+        in_flight(IF_ID_PIPELINE_COLUMN.seq).decode = clock_cycles;
+    decode_stalled=handle_hazard();
+    ID_EX_PIPELINE_CLOUMN=decltype(ID_EX_PIPELINE_CLOUMN)();
+    if(decode_stalled)
+        return;
+    if(traced)
+        in_flight(IF_ID_PIPELINE_COLUMN.seq).rename = in_flight(IF_ID_PIPELINE_COLUMN.seq).dispatch = clock_cycles;
+
+    ID_EX_PIPELINE_CLOUMN.IR = IF_ID_PIPELINE_COLUMN.IR;
+    ID_EX_PIPELINE_CLOUMN.index = IF_ID_PIPELINE_COLUMN.index;
+    ID_EX_PIPELINE_CLOUMN.seq = IF_ID_PIPELINE_COLUMN.seq;
+    ID_EX_PIPELINE_CLOUMN.NPC = IF_ID_PIPELINE_COLUMN.NPC;
+
+    const instruction_t &instr = ID_EX_PIPELINE_CLOUMN.IR;
+    unsigned first, second;
+    source_registers(instr, &first, &second);
+    switch (instr.opcode) {
+        case ADD:
+        case SUB:
+        case XOR:
+        case ADDS:
+        case SUBS:
+        case MULTS:
+        case DIVS:
+            ID_EX_PIPELINE_CLOUMN.A = register_value(first);
+            ID_EX_PIPELINE_CLOUMN.B = register_value(second);
+            break;
+        case ADDI:
+        case SUBI:
+        case LW:
+        case LWS:
+        case BEQZ:
+        case BNEZ:
+        case BLTZ:
+        case BGTZ:
+        case BLEZ:
+        case BGEZ:
+            ID_EX_PIPELINE_CLOUMN.A = register_value(first);
+            ID_EX_PIPELINE_CLOUMN.IMM = instr.immediate;
+            break;
+        case SW:
+        case SWS:
+            //A holds the base address, B the value stored
+            ID_EX_PIPELINE_CLOUMN.A = register_value(second);
+            ID_EX_PIPELINE_CLOUMN.B = register_value(first);
+            ID_EX_PIPELINE_CLOUMN.IMM = instr.immediate;
+            break;
+        case JUMP:
+            ID_EX_PIPELINE_CLOUMN.IMM = instr.immediate;
+            break;
+        default:
+            //bubbles and EOP carry no operands
+            break;
+    }
+}
 
-
-    if(clock_cycles>=2)
+/**
+ * The instruction decoded last cycle starts in the free unit ID found for it, and the oldest
+ * instruction whose latency has elapsed moves on to EX/MEM. Another one ready in the same cycle
+ * keeps its unit busy until EX/MEM is free, a structural stall charged to that unit
+ */
+void sim_pipe_fp::Instruction_execute()
+{
+    decrement_units_busy_time();
+    const instruction_t &instr = ID_EX_PIPELINE_CLOUMN.IR;
+    if(holds_instruction(instr))
     {
-
-        EX_MEM_PIPELINE_COLUMN.IR = ID_EX_PIPELINE_CLOUMN.IR;
-        if(EX_MEM_PIPELINE_COLUMN.IR.opcode==EOP)
-        {
-            MEM_WB_REGISTER_COLUMN.IR=EX_MEM_PIPELINE_COLUMN.IR;
-            EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT=UNDEFINED;
-            EX_MEM_PIPELINE_COLUMN.B=UNDEFINED;
-            EX_MEM_PIPELINE_COLUMN.COND=UNDEFINED;
-            return;
+        unit_t &unit = exec_units[get_free_unit(instr.opcode)];
+        unsigned a = ID_EX_PIPELINE_CLOUMN.A;
+        unit.instruction = instr;
+        unit.index = ID_EX_PIPELINE_CLOUMN.index;
+        unit.seq = ID_EX_PIPELINE_CLOUMN.seq;
+        unit.issued = clock_cycles;
+        if(trace!=NULL && unit.seq!=UNDEFINED)
+            in_flight(unit.seq).issue = clock_cycles;
+        unit.busy = unit.latency;
+        unit.ALU_OUTPUT = alu(instr.opcode, a, ID_EX_PIPELINE_CLOUMN.B, ID_EX_PIPELINE_CLOUMN.IMM, ID_EX_PIPELINE_CLOUMN.NPC);
+        unit.B = ID_EX_PIPELINE_CLOUMN.B;
+        unit.COND = UNDEFINED;
+        switch (instr.opcode) {
+            case BEQZ: unit.COND = ((int)a == 0); break;
+            case BNEZ: unit.COND = ((int)a != 0); break;
+            case BLTZ: unit.COND = ((int)a < 0); break;
+            case BGTZ: unit.COND = ((int)a > 0); break;
+            case BLEZ: unit.COND = ((int)a <= 0); break;
+            case BGEZ: unit.COND = ((int)a >= 0); break;
+            case JUMP: unit.COND = 1; break;
+            default: break;
         }
-        opcode_t fetched_opcodes = EX_MEM_PIPELINE_COLUMN.IR.opcode;
-        unsigned alu_output=0;
-        //
-        if(fetched_opcodes==SW)
-        {
-            unsigned a = integer_register[EX_MEM_PIPELINE_COLUMN.IR.src2];
-            unsigned b = integer_register[EX_MEM_PIPELINE_COLUMN.IR.src1];
-            unsigned imm = EX_MEM_PIPELINE_COLUMN.IR.immediate;
-            unsigned npc = ID_EX_PIPELINE_CLOUMN.NPC;
-            alu_output = alu(fetched_opcodes, a, b, imm, npc);
-        }
-        else
-        {
-            unsigned a = integer_register[EX_MEM_PIPELINE_COLUMN.IR.src1];
-            unsigned b = integer_register[EX_MEM_PIPELINE_COLUMN.IR.src2];
-            unsigned imm = EX_MEM_PIPELINE_COLUMN.IR.immediate;
-            unsigned npc = ID_EX_PIPELINE_CLOUMN.NPC;
-            alu_output = alu(fetched_opcodes, a, b, imm, npc);
-        }
-
-        //
-
-        EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT=(alu_output);
-
-        EX_MEM_PIPELINE_COLUMN.B=ID_EX_PIPELINE_CLOUMN.B;
-
-
-
-
     }
 
+    unsigned done=UNDEFINED;
+    for (unsigned u=0; u<num_units; u++)
+    {
+        if (!unit_in_use(u) || exec_units[u].busy>0) continue;
+        if (done==UNDEFINED || exec_units[u].issued<exec_units[done].issued) done=u;
+    }
+    for (unsigned u=0; u<num_units; u++)
+        if (u!=done && unit_in_use(u) && exec_units[u].busy==0) counters.structural_stalls[u]++;
 
+    EX_MEM_PIPELINE_COLUMN=decltype(EX_MEM_PIPELINE_COLUMN)();
+    if(done==UNDEFINED)
+        return;
+    unit_t &unit = exec_units[done];
+    EX_MEM_PIPELINE_COLUMN.IR = unit.instruction;
+    EX_MEM_PIPELINE_COLUMN.index = unit.index;
+    EX_MEM_PIPELINE_COLUMN.seq = unit.seq;
+    EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT = unit.ALU_OUTPUT;
+    EX_MEM_PIPELINE_COLUMN.COND = unit.COND;
+    EX_MEM_PIPELINE_COLUMN.B = unit.B;
+    unit.instruction = BUBBLE_INSTRUCTION;
 }
 
-void sim_pipe_fp::Instruction_memory(int instruction_index)
+void sim_pipe_fp::Instruction_memory()
 {
-
-
-    if(clock_cycles>=3)
-    {
-        if(MEM_WB_REGISTER_COLUMN.IR.opcode==EOP)
-        {
-            MEM_WB_REGISTER_COLUMN.ALU_OUTPUT=UNDEFINED;
-            MEM_WB_REGISTER_COLUMN.LMD= (UNDEFINED);
-            return;
+    const instruction_t &instr = EX_MEM_PIPELINE_COLUMN.IR;
+    unsigned address = EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT;
+
+    if (is_memory(instr.opcode)) {
+        if (!memory_access_ready) {
+            //the access starts this cycle and holds MEM for the latency of the data memory
+            memory_cycles_left = data_memory_latency;
+            memory_access_ready = true;
         }
-
-
-        MEM_WB_REGISTER_COLUMN.IR=EX_MEM_PIPELINE_COLUMN.IR;
-
-        if(MEM_WB_REGISTER_COLUMN.IR.opcode==LW)
-        {
-//        int2char(EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT,data_memory);
-//        char2int()
-
-            MEM_WB_REGISTER_COLUMN.LMD=char2unsigned(data_memory);
-
-            //MEM_WB_REGISTER_COLUMN.ALU_OUTPUT = EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT;
-
-
-
+        if (memory_cycles_left > 0) {
+            memory_cycles_left--;
+            memory_bubble = true;
+            MEM_WB_REGISTER_COLUMN=decltype(MEM_WB_REGISTER_COLUMN)();
+            return;
         }
-        else if(MEM_WB_REGISTER_COLUMN.IR.opcode==SW)
-        {
-            write_memory(EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT,EX_MEM_PIPELINE_COLUMN.B);
-            MEM_WB_REGISTER_COLUMN.ALU_OUTPUT=integer_register[EX_MEM_PIPELINE_COLUMN.IR.dest];
-
-            //  MEM_WB_REGISTER_COLUMN.ALU_OUTPUT = EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT;
+        memory_access_ready = false;
+    }
+    memory_bubble = false;
 
-        }
-        else
-        {
-            MEM_WB_REGISTER_COLUMN.ALU_OUTPUT = EX_MEM_PIPELINE_COLUMN.ALU_OUTPUT;
-        }
+    MEM_WB_REGISTER_COLUMN=decltype(MEM_WB_REGISTER_COLUMN)();
+    MEM_WB_REGISTER_COLUMN.IR = instr;
+    MEM_WB_REGISTER_COLUMN.index = EX_MEM_PIPELINE_COLUMN.index;
+    MEM_WB_REGISTER_COLUMN.seq = EX_MEM_PIPELINE_COLUMN.seq;
+    if (!holds_instruction(instr))
+        return;
+    MEM_WB_REGISTER_COLUMN.ALU_OUTPUT = address;
+    if (trace != NULL && MEM_WB_REGISTER_COLUMN.seq != UNDEFINED) {
+        in_flight(MEM_WB_REGISTER_COLUMN.seq).complete = clock_cycles;
+        if (instr.opcode == SW || instr.opcode == SWS)
+            in_flight(MEM_WB_REGISTER_COLUMN.seq).store = clock_cycles;
+    }
 
+    if (instr.opcode == LW || instr.opcode == LWS) {
+        //an address outside the data memory reads as UNDEFINED
+        MEM_WB_REGISTER_COLUMN.LMD = (address <= data_memory_size - 4) ? char2unsigned(data_memory + address) : UNDEFINED;
+    } else if (instr.opcode == SW || instr.opcode == SWS) {
+        //a store outside the data memory is dropped
+        if (address <= data_memory_size - 4)
+            write_memory(address, EX_MEM_PIPELINE_COLUMN.B);
+    } else if (Detect_Branch(instr.opcode) && EX_MEM_PIPELINE_COLUMN.COND == 1) {
+        //fetch has waited for the branch and continues from the target this same cycle
+        PC_ADDER = address;
     }
 }
 
-
-
-
-void sim_pipe_fp::Instruction_writeback(int instruction_index) {
-
-
-    if (MEM_WB_REGISTER_COLUMN.IR.opcode == EOP) {
-        runcycle = false;
+void sim_pipe_fp::Instruction_writeback() {
+    const instruction_t &instr = MEM_WB_REGISTER_COLUMN.IR;
+    if (!holds_instruction(instr))
         return;
+    unsigned dest = result_register(instr);
+    unsigned value = (instr.opcode == LW || instr.opcode == LWS) ? MEM_WB_REGISTER_COLUMN.LMD : MEM_WB_REGISTER_COLUMN.ALU_OUTPUT;
+    if (dest != UNDEFINED && dest < NUM_GP_REGISTERS)
+        integer_register[dest] = value;
+    else if (dest != UNDEFINED)
+        floating_point_register[dest - NUM_GP_REGISTERS] = value;
+    no_of_instruction_executed++;
+    if (trace != NULL && MEM_WB_REGISTER_COLUMN.seq != UNDEFINED) {
+        in_flight(MEM_WB_REGISTER_COLUMN.seq).retire = clock_cycles;
+        trace_instruction(MEM_WB_REGISTER_COLUMN.seq);
     }
+}
 
+/* the timeline of the traced instruction "seq" in flight, or a free entry for UNDEFINED */
+pipeview_record_t &sim_pipe_fp::in_flight(unsigned seq)
+{
+    unsigned i = 0;
+    while (i < TRACED_IN_FLIGHT - 1 && traced_instructions[i].seq != seq)
+        i++;
+    return traced_instructions[i];
+}
 
-    if (clock_cycles >= 4) {
-
-        if (MEM_WB_REGISTER_COLUMN.IR.opcode == LW) {
-            integer_register[MEM_WB_REGISTER_COLUMN.IR.dest] = MEM_WB_REGISTER_COLUMN.LMD;
-        } else {
-            integer_register[MEM_WB_REGISTER_COLUMN.IR.dest] = MEM_WB_REGISTER_COLUMN.ALU_OUTPUT;
-        }
-
-    }
+/* writes the timeline of an instruction writing back to the trace, freeing its entry */
+void sim_pipe_fp::trace_instruction(unsigned seq)
+{
+    pipeview_record_t &record = in_flight(seq);
+    trace->write(record, instr_names[instruction_at((record.pc - instr_base_address) >> 2).opcode]);
+    record.seq = UNDEFINED;
 }
+
 /**
- * This function is implemented to detect data hazard in the pipeline
+ * This function is implemented to detect data hazard in the pipeline: the instruction in ID reads
+ * a register an instruction ahead of it has not written back yet. They sit in the functional units,
+ * EX/MEM and MEM/WB, the stages behind ID having already run this cycle. WB writes before ID reads
+ * within a cycle
  * @return
  */
-
 bool sim_pipe_fp::Detect_DataHazard()
 {
-    opcode_t ID_Stage_op=ID_EX_PIPELINE_CLOUMN.IR.opcode;
-    opcode_t EX_STage_op=EX_MEM_PIPELINE_COLUMN.IR.opcode;
-    opcode_t MEM_Stage_op=MEM_WB_REGISTER_COLUMN.IR.opcode;
-    //Check the src and destination registers
-    //Put an extra check for NOP for that stage
-    ///////CHECKING FOR HAZARDS WITH EXECUTION AND DECODE
-    if(EX_STage_op!=SW) {
-        if (ID_Stage_op != SW) {
-            if ((ID_EX_PIPELINE_CLOUMN.IR.src1 == EX_MEM_PIPELINE_COLUMN.IR.dest)
-                || (ID_EX_PIPELINE_CLOUMN.IR.src2 == EX_MEM_PIPELINE_COLUMN.IR.dest)
-                   && (EX_MEM_PIPELINE_COLUMN.IR.opcode != NOP))//For operations except store
-            {
-                data_hazard = true;
-                pipline_needs_stalling=true;
-                return data_hazard;
-            }
-        } else {
-            if ((ID_EX_PIPELINE_CLOUMN.IR.src1 == EX_MEM_PIPELINE_COLUMN.IR.dest)
-                || (ID_EX_PIPELINE_CLOUMN.IR.dest = EX_MEM_PIPELINE_COLUMN.IR.dest)) {
-                data_hazard = true;
-                pipline_needs_stalling=true;
-                return data_hazard;
-            }
-        }
-    }
-
-    ///CHECKING FOR HAZARDS WITH MEMORY AND WRITEBACK
+    const instruction_t &instr = IF_ID_PIPELINE_COLUMN.IR;
+    const instruction_t *producer = NULL;
+    for (unsigned u=0; u<num_units && producer==NULL; u++)
+        if (unit_in_use(u) && reads_result_of(instr, exec_units[u].instruction)) producer = &exec_units[u].instruction;
+    if (producer==NULL && reads_result_of(instr, EX_MEM_PIPELINE_COLUMN.IR))
+        producer = &EX_MEM_PIPELINE_COLUMN.IR;
+    if (producer==NULL && reads_result_of(instr, MEM_WB_REGISTER_COLUMN.IR))
+        producer = &MEM_WB_REGISTER_COLUMN.IR;
+    if (producer==NULL)
+        return false;
+    load_hazard = (producer->opcode == LW || producer->opcode == LWS);
+    hazard_register = result_register(*producer);
+    return true;
+}
 
-    if(MEM_Stage_op!=SW)
+/**
+ * Results reach the registers in program order: the instruction in ID waits while it would finish
+ * no later than an instruction ahead of it in a functional unit writing the same register (WAW)
+ */
+bool sim_pipe_fp::Detect_WriteHazard()
+{
+    const instruction_t &instr = IF_ID_PIPELINE_COLUMN.IR;
+    unsigned dest = result_register(instr);
+    if (dest == UNDEFINED)
+        return false;
+    //issued next cycle, it finishes after the latency of its unit
+    unsigned finish = exec_units[get_free_unit(instr.opcode)].latency + 1;
+    for (unsigned u=0; u<num_units; u++)
     {
-        if(ID_Stage_op!=SW)
-            if ((ID_EX_PIPELINE_CLOUMN.IR.src1 == MEM_WB_REGISTER_COLUMN.IR.dest)
-                || (ID_EX_PIPELINE_CLOUMN.IR.src2 == MEM_WB_REGISTER_COLUMN.IR.dest)
-                    )//For operations except store
-            {
-                data_hazard = true;
-                pipline_needs_stalling=true;
-                return data_hazard;
-            }
-
-            else
-            {
-                if ((ID_EX_PIPELINE_CLOUMN.IR.src1 == MEM_WB_REGISTER_COLUMN.IR.dest)
-                    || (ID_EX_PIPELINE_CLOUMN.IR.dest = MEM_WB_REGISTER_COLUMN.IR.dest)
-                        ) {
-                    data_hazard = true;
-                    pipline_needs_stalling=true;
-                    return data_hazard;
-                }
-            }
+        if (!unit_in_use(u) || result_register(exec_units[u].instruction) != dest) continue;
+        if (exec_units[u].busy >= finish)
+            return true;
     }
-    pipline_needs_stalling=false;
-    data_hazard= false;
-    return data_hazard;
-
+    return false;
 }
 
+/* a branch decoded this cycle, executing or in EX/MEM keeps IF from fetching, its target is known in MEM */
 bool sim_pipe_fp::Detect_ControlHazard()
 {
-    opcode_t branch_Check=ID_EX_PIPELINE_CLOUMN.IR.opcode;
-    if(Detect_Branch(branch_Check))
-    {
-        control_hazard=true;
-        pipline_needs_stalling=true;
-        return control_hazard;
-
-    }
-    control_hazard= false;
-    pipline_needs_stalling=false;
-    return control_hazard;
-
-
+    if(Detect_Branch(ID_EX_PIPELINE_CLOUMN.IR.opcode) || Detect_Branch(EX_MEM_PIPELINE_COLUMN.IR.opcode))
+        return true;
+    for (unsigned u=0; u<num_units; u++)
+        if (Detect_Branch(exec_units[u].instruction.opcode)) return true;
+    return false;
 }
 
 bool sim_pipe_fp::Detect_Branch(opcode_t opcode)
@@ -841,63 +1057,43 @@ bool sim_pipe_fp::Detect_Branch(opcode_t opcode)
     }
     return false;
 }
+
+/**
+ * Stalls ID, inserting a bubble into EX, while the instruction it holds waits on the result of an
+ * instruction ahead of it, on a free functional unit of its type or on an older write of its
+ * destination. The stall is charged to the register or to the busy unit it waits on
+ * @return true if ID stalls this cycle
+ */
 bool sim_pipe_fp::handle_hazard()
 {
-    //Hazards are detcted in decode stage but the actual control occurs in execute stage
-    //Where we start stalling the pipeline
-    if(clock_cycles>=1)
-    {
-        if(pipline_needs_stalling&&ID_EX_PIPELINE_CLOUMN.IR.opcode!=NOP)
-        {
-
-            /**\
-             Ask professor if logic of bot data hazrds and control hazrds are correct
-             or not
-             */
-            if(Detect_DataHazard()&&Detect_ControlHazard())
-            {
-                EX_MEM_PIPELINE_COLUMN.IR.opcode=NOP;
-                EX_MEM_PIPELINE_COLUMN.IR=ID_EX_PIPELINE_CLOUMN.IR;
-                ID_EX_PIPELINE_CLOUMN.IR.opcode=NOP;
-                pipline_needs_stalling=false;
-                return true;
-            }
-
-            else if(Detect_ControlHazard())
-            {
-                EX_MEM_PIPELINE_COLUMN.IR=ID_EX_PIPELINE_CLOUMN.IR;
-                ID_EX_PIPELINE_CLOUMN.IR.opcode=NOP;
-                pipline_needs_stalling=false;
-                return true;
-            }
-
-            else if(Detect_DataHazard())
-            {
-                EX_MEM_PIPELINE_COLUMN.IR.opcode=NOP;//DONT DO ANYTHING WITH THAT INSTRUCTION
-                pipline_needs_stalling=false;
-                return true;
-            }
-
-            else
-            {
-
-                //cout<<"Wrong hazard handling"<<endl;
-                return false;
-            }
-
-
-
-
-        }
+    const instruction_t &instr = IF_ID_PIPELINE_COLUMN.IR;
+    if(!holds_instruction(instr))
         return false;
-
+    if(Detect_DataHazard())
+    {
+        if(load_hazard)
+            counters.load_use_stalls++;
+        else
+            counters.raw_stalls[hazard_register]++;
+        return true;
+    }
+    if(get_free_unit(instr.opcode)==UNDEFINED)
+    {
+        counters.structural_stalls[first_unit_to_free(instr.opcode)]++;
+        return true;
+    }
+    if(Detect_WriteHazard())
+    {
+        counters.waw_stalls++;
+        return true;
     }
     return false;
-
 }
 
 
-
-
-
-
+/* returns the decoded instruction at "index", addresses past the loaded program read as NOP */
+const instruction_t &sim_pipe_fp::instruction_at(unsigned index){
+	static const instruction_t past_end = {NOP, UNDEFINED, UNDEFINED, UNDEFINED, UNDEFINED, UNDEFINED};
+	if (index < instr_memory.size()) return instr_memory[index];
+	return past_end;
+}
@@ -4,9 +4,11 @@
 #include <stdio.h>
 #include <string>
 #include <vector>
+#include <type_traits>
+#include "pipeline_counters.h"
+#include "pipeview_trace.h"
 using namespace std;
 
-#define PROGRAM_SIZE 50
 
 #define UNDEFINED 0xFFFFFFFF
 #define NUM_SP_REGISTERS 9
@@ -18,21 +20,34 @@ using namespace std;
 
 typedef enum {PC, NPC, IR, A, B, IMM, COND, ALU_OUTPUT, LMD} sp_register_t;
 
-typedef enum {LW, SW, ADD, ADDI, SUB, SUBI, XOR, BEQZ, BNEZ, BLTZ, BGTZ, BLEZ, BGEZ, JUMP, EOP, NOP, LWS, SWS, ADDS, SUBS, MULTS, DIVS} opcode_t;
+typedef enum : unsigned char {LW, SW, ADD, ADDI, SUB, SUBI, XOR, BEQZ, BNEZ, BLTZ, BGTZ, BLEZ, BGEZ, JUMP, EOP, NOP, LWS, SWS, ADDS, SUBS, MULTS, DIVS} opcode_t;
 
 typedef enum {IF, ID, EXE, MEM, WB} stage_t;
 
 typedef enum {INTEGER, ADDER, MULTIPLIER, DIVIDER} exe_unit_t;
 
 // instruction
+// register number of a decoded instruction, one byte wide; 0xFF reads back as UNDEFINED
+struct reg_field_t{
+        unsigned char number;
+        reg_field_t() = default;
+        reg_field_t(unsigned reg) : number(reg > 0xFF ? 0xFF : reg) {}
+        operator unsigned() const { return number == 0xFF ? UNDEFINED : number; }
+};
+
+// decoded micro-op, copied through the pipeline latches every cycle: plain data, no heap
 typedef struct{
         opcode_t opcode; //opcode
-        unsigned src1; //first source register
-        unsigned src2; //second source register
-        unsigned dest; //destination register
-        unsigned immediate; //immediate field;
-        string label; //in case of branch, label of the target instruction;
+        reg_field_t src1; //first source register in the assembly instruction (for SW, register to be written to memory)
+        reg_field_t src2; //second source register in the assembly instruction
+        reg_field_t dest; //destination register
+        unsigned immediate; //immediate field (for branches, offset to the target)
+        unsigned target; //for branches, index of the target instruction resolved at load time, UNDEFINED otherwise
 } instruction_t;
+static_assert(sizeof(instruction_t) <= 16 && is_trivially_copyable<instruction_t>::value, "instruction_t must stay a 16-byte POD");
+
+// content of an empty pipeline latch or functional unit
+static const instruction_t BUBBLE_INSTRUCTION = {NOP, UNDEFINED, UNDEFINED, UNDEFINED, UNDEFINED, UNDEFINED};
 
 // execution unit
 typedef struct{
@@ -43,20 +58,23 @@ typedef struct{
 			  // to the latency of the unit when the unit becomes busy, and decremented
 			  // at each clock cycle
 	instruction_t instruction; // instruction using the functional unit
+	unsigned index;      // its position in the instruction memory
+	unsigned seq;        // its number in the trace, UNDEFINED when tracing is off
+	unsigned issued;     // clock cycle it entered the unit: of two results ready together the older goes to MEM first
+	unsigned ALU_OUTPUT; // its result, COND and B, handed to EX/MEM once the latency has elapsed
+	unsigned COND;
+	unsigned B;
 } unit_t;
 
 class sim_pipe_fp{
 
         //instruction memory 
-        instruction_t instr_memory[PROGRAM_SIZE];
+        vector<instruction_t> instr_memory;
+        vector<string> branch_labels; //label of each branch as written in the program, for debugging
+        const instruction_t &instruction_at(unsigned index);
         unsigned PC_ADDER;//We can also use pc this is equivalent to the ADDEr in the 5 stage pipleine
-        int instruction_no=0;//Instruction no to be updated
         int no_of_instruction_executed=0;//no of execution exceuted
         int clock_cycles=0;//Keeps track of no of cc elapsed
-        bool runcycle=false;//Runs the cc when the first program stage is completed
-        bool data_hazard=false;//Makes itself true when a dat hazard s detected
-
-        bool control_hazard=false;//Makes itself true when a control hazrd is dtcted
 
         //base address in the instruction memory where the program is loaded
         unsigned instr_base_address;
@@ -76,11 +94,15 @@ class sim_pipe_fp{
 
 /**
  * The IF_ID PIPELINE COLUMNS Defined as STruct
+ * index is the position of IR in the instruction memory
+ * seq numbers the instructions traced, UNDEFINED when tracing is off
  */
     struct
     {
         unsigned NPC = (UNDEFINED);
-        instruction_t IR;
+        instruction_t IR = BUBBLE_INSTRUCTION;
+        unsigned index = UNDEFINED;
+        unsigned seq = UNDEFINED;
     }IF_ID_PIPELINE_COLUMN;
 
     /**
@@ -90,7 +112,9 @@ class sim_pipe_fp{
     struct
     {
         unsigned NPC=(UNDEFINED);
-        instruction_t IR;
+        instruction_t IR = BUBBLE_INSTRUCTION;
+        unsigned index = UNDEFINED;
+        unsigned seq = UNDEFINED;
         unsigned A=sp_register_t (UNDEFINED);
         unsigned  B=sp_register_t (UNDEFINED);
         unsigned IMM=sp_register_t (UNDEFINED);
@@ -101,7 +125,9 @@ class sim_pipe_fp{
  */
     struct
     {
-        instruction_t IR;
+        instruction_t IR = BUBBLE_INSTRUCTION;
+        unsigned index = UNDEFINED;
+        unsigned seq = UNDEFINED;
         unsigned COND=sp_register_t(UNDEFINED);
         unsigned ALU_OUTPUT=sp_register_t(UNDEFINED);
         unsigned B=sp_register_t (UNDEFINED);
@@ -112,7 +138,9 @@ class sim_pipe_fp{
  */
     struct
     {
-        instruction_t IR;
+        instruction_t IR = BUBBLE_INSTRUCTION;
+        unsigned index = UNDEFINED;
+        unsigned seq = UNDEFINED;
         unsigned  LMD=(UNDEFINED);
         unsigned ALU_OUTPUT=sp_register_t (UNDEFINED);
     }MEM_WB_REGISTER_COLUMN;
@@ -138,6 +166,10 @@ public:
 	//loads the assembly program in file "filename" in instruction memory at the specified address
 	void load_program(const char *filename, unsigned base_address=0x0);
 
+	//loads an RV32I ELF32 executable: the executable segment goes to instruction memory, the other
+	//segments to data memory at their addresses, and execution starts at the entry point
+	void load_elf(const char *filename);
+
 	//runs the simulator for "cycles" clock cycles (run the program to completion if cycles=0) 
 	void run(unsigned cycles=0);
 	
@@ -187,6 +219,18 @@ public:
 	//returns the number of stalls added by processor
 	unsigned get_stalls();
 
+	//returns every performance counter as a key and its current value: stalls by cause (RAW ones
+	//by register, F registers after the integer ones, structural ones by functional unit), and
+	//the cycles each stage spent on an instruction or on a bubble
+	vector<pair<string, unsigned> > get_counters();
+
+	//prints the performance counters as key=value lines
+	void print_counters();
+
+	//streams the stage timeline of every instruction to "trace" (not owned) in the O3PipeView format;
+	//NULL stops tracing
+	void set_trace(pipeview_trace *trace);
+
 	//prints the content of the data memory within the specified address range
 	void print_memory(unsigned start_address, unsigned end_address);
 
@@ -196,28 +240,41 @@ public:
 	//prints the values of the registers 
 	void print_registers();
     bool Detect_DataHazard();
+    bool Detect_WriteHazard();
     bool Detect_ControlHazard();
     bool handle_hazard();
-    bool pipline_needs_stalling=false;
-    bool count_stalls_inserted=0;
-    bool there_is_a_branch(opcode_t);
-    bool Hazard_Check=false;
+    unsigned hazard_register=UNDEFINED;  //register the data hazard found by Detect_DataHazard waits on
+    bool load_hazard=false;              //and whether a load produces it
+    bool decode_stalled=false;           //ID holds its instruction this cycle, so IF holds too
     bool Detect_Branch(opcode_t);
-    void read_memory(unsigned ,unsigned);
     bool end_of_program_reached=false;
-    void Instruction_fetch(int instruction_index);
-    void Instruction_decode(int instruction_index);
-    void Instruction_execute(int instruction_index);
-    void Instruction_memory(int instruction_index);
-    void Instruction_writeback(int instruction_index);
+    void clock_tick();
+    void Instruction_fetch();
+    void Instruction_decode();
+    void Instruction_execute();
+    void Instruction_memory();
+    void Instruction_writeback();
     vector<unsigned>integer_register;
+    vector<unsigned>floating_point_register; //bit patterns of the F registers, UNDEFINED until written
     vector<unsigned>create_integer_Point_registers();
     vector<unsigned >create_floating_point_registers();
+    unsigned register_value(unsigned reg);
 
 private:
 
 	// returns a free exec unit for the particular instruction type
 	unsigned get_free_unit(opcode_t opcode);	
+
+	// returns the unit of the type "opcode" needs that frees up first, the one a structural stall waits on
+	unsigned first_unit_to_free(opcode_t opcode);
+
+	// true while an instruction occupies the unit, including a finished one waiting for EX/MEM
+	bool unit_in_use(unsigned u) { return exec_units[u].instruction.opcode != NOP; }
+
+	//timing of the MEM stage: a load or store holds it, and every stage behind it, for the data memory latency
+	unsigned memory_cycles_left=0;    //stall cycles still to go for the access in MEM
+	bool memory_access_ready=false;   //the access in MEM has waited its latency and completes this cycle
+	bool memory_bubble=false;         //MEM/WB holds no new instruction while MEM waits
 	
 	//reduce execution unit busy time (to be invoked at every clock cycle 
 	void decrement_units_busy_time();
@@ -225,6 +282,19 @@ private:
 	//debug units
 	void debug_units();
 
+	//stalls by cause, per-stage occupancy
+	pipeline_counters counters;
+
+	//O3PipeView trace: the timelines of the instructions in flight, kept until they write back.
+	//Every latch and functional unit may hold one. A long operation can still be executing while
+	//younger instructions write back, so a timeline is found by its seq rather than at seq modulo the size
+	static const unsigned TRACED_IN_FLIGHT = MAX_UNITS + 4;
+	pipeview_trace *trace=NULL;
+	pipeview_record_t traced_instructions[TRACED_IN_FLIGHT];  //seq UNDEFINED marks a free entry
+	unsigned next_seq=0;
+	pipeview_record_t &in_flight(unsigned seq);
+	void trace_instruction(unsigned seq);
+
 };
 
 #endif /*SIM_PIPE_FP_H_*/
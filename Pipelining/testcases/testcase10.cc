@@ -0,0 +1,50 @@
+#include "sim_pipe.h"
+#include <iostream>
+#include <stdlib.h>
+
+using namespace std;
+
+/* Test case for operand forwarding in the pipelined simulator */
+
+// runs "program" to completion with or without forwarding and prints where the stalls come from
+void run_program(const char *program, bool forwarding){
+
+	unsigned i, j;
+
+	// instantiates the simulator with a 1MB data memory
+	sim_pipe *mips = new sim_pipe(1024*1024, 0, forwarding);
+
+	//loads program in instruction memory at address 0x10000000
+	mips->load_program(program, 0x10000000);
+
+	//initialize general purpose registers and data memory
+	for (i=0; i<7; i++) mips->set_gp_register(i,i);
+	for (i = 0x0, j=1; i<0x20; i+=4, j+=1) mips->write_memory(i,j);
+
+	mips->run();
+
+	cout << program << (forwarding ? " WITH FORWARDING" : " WITHOUT FORWARDING") << endl;
+	cout << "======================================================================" << endl;
+	mips->print_registers();
+	mips->print_memory(0x0, 0x20);
+	cout << "Instruction executed = " << dec << mips->get_instructions_executed() << endl;
+	cout << "Clock cycles = " << dec << mips->get_clock_cycles() << endl;
+	cout << "Stall inserted = " << dec << mips->get_stalls() << endl;
+	cout << "Load-use stalls = " << dec << mips->get_load_use_stalls() << endl;
+	cout << "Other data stalls = " << dec << mips->get_data_stalls() << endl;
+	cout << "Control stalls = " << dec << mips->get_control_stalls() << endl;
+	cout << "IPC = " << dec << mips->get_IPC() << endl << endl;
+
+	delete mips;
+}
+
+int main(int argc, char **argv){
+
+	// the same programs must leave the same registers and memory either way
+	run_program("asm/data_dep1.asm", false);
+	run_program("asm/data_dep1.asm", true);
+	run_program("asm/data_dep2.asm", false);
+	run_program("asm/data_dep2.asm", true);
+	run_program("asm/control_dep.asm", false);
+	run_program("asm/control_dep.asm", true);
+}
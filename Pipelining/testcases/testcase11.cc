@@ -0,0 +1,61 @@
+#include "sim_pipe.h"
+#include <iostream>
+#include <stdlib.h>
+
+using namespace std;
+
+/* Test case for branch prediction in the pipelined simulator */
+
+// runs asm/sort.asm to completion, fetching past branches as "predictor" says (stalling if NULL)
+void run_program(branch_predictor *predictor, bool forwarding){
+
+	unsigned i, j;
+
+	// instantiates the simulator with a 1MB data memory
+	sim_pipe *mips = new sim_pipe(1024*1024, 0, forwarding);
+	mips->set_branch_predictor(predictor);
+
+	//loads program in instruction memory at address 0x10000000
+	mips->load_program("asm/sort.asm", 0x10000000);
+
+	//initialize general purpose registers and data memory with an unsorted array
+	for (i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(i,0);
+	for (i = 0xA000, j=10; i<0xA028; i+=4, j=(j*7)%11) mips->write_memory(i,j);
+
+	mips->run();
+
+	cout << (predictor == NULL ? "no predictor" : predictor->name()) << (forwarding ? ", forwarding" : "") << endl;
+	cout << "======================================================================" << endl;
+	mips->print_memory(0xB000, 0xB028);
+	cout << "Instruction executed = " << dec << mips->get_instructions_executed() << endl;
+	cout << "Clock cycles = " << dec << mips->get_clock_cycles() << endl;
+	cout << "Stall inserted = " << dec << mips->get_stalls() << endl;
+	cout << "Control stalls = " << dec << mips->get_control_stalls() << endl;
+	cout << "Branches = " << dec << mips->get_branches() << endl;
+	cout << "Mispredictions = " << dec << mips->get_mispredictions() << endl;
+	cout << "Accuracy = " << dec << mips->get_branch_accuracy() << endl;
+	cout << "MPKI = " << dec << mips->get_MPKI() << endl;
+	cout << "IPC = " << dec << mips->get_IPC() << endl << endl;
+
+	delete mips;
+}
+
+int main(int argc, char **argv){
+
+	static_predictor not_taken(false);
+	static_predictor taken(true);
+	bimodal_predictor bimodal;
+	gshare_predictor gshare;
+	tage_predictor tage;
+	tage_predictor tage_forwarding;
+
+	// every run must leave the same sorted array
+	run_program(NULL, false);
+	run_program(&not_taken, false);
+	run_program(&taken, false);
+	run_program(&bimodal, false);
+	run_program(&gshare, false);
+	run_program(&tage, false);
+	run_program(NULL, true);
+	run_program(&tage_forwarding, true);
+}
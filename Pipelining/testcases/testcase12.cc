@@ -0,0 +1,59 @@
+#include "sim_pipe.h"
+#include <iostream>
+#include <stdlib.h>
+
+using namespace std;
+
+/* Test case for the performance counters of the pipelined simulator */
+
+// returns the value of counter "key", 0 if it is not exported
+unsigned counter(sim_pipe *mips, const string &key){
+	vector<pair<string, unsigned> > counters = mips->get_counters();
+	for (unsigned i=0; i<counters.size(); i++)
+		if (counters[i].first == key) return counters[i].second;
+	return 0;
+}
+
+// runs "program" to completion and prints its counters
+void run_program(const char *program, unsigned mem_latency, bool forwarding, branch_predictor *predictor){
+
+	unsigned i, j;
+
+	// instantiates the simulator with a 1MB data memory
+	sim_pipe *mips = new sim_pipe(1024*1024, mem_latency, forwarding);
+	mips->set_branch_predictor(predictor);
+
+	//loads program in instruction memory at address 0x10000000
+	mips->load_program(program, 0x10000000);
+
+	//initialize general purpose registers and data memory
+	for (i=0; i<7; i++) mips->set_gp_register(i,i);
+	for (i = 0x0, j=1; i<0x20; i+=4, j+=1) mips->write_memory(i,j);
+
+	cout << program << ", memory latency " << mem_latency << (forwarding ? ", forwarding" : "")
+	     << (predictor != NULL ? ", " : "") << (predictor != NULL ? predictor->name() : "") << endl;
+	cout << "======================================================================" << endl;
+
+	// the counters can be read while the program runs
+	mips->run(20);
+	cout << "after 20 clock cycles: stalls=" << dec << counter(mips, "stalls")
+	     << " stage.EX.occupied=" << counter(mips, "stage.EX.occupied") << endl;
+
+	mips->run();
+	cout << "Instruction executed = " << dec << mips->get_instructions_executed() << endl;
+	cout << "Clock cycles = " << dec << mips->get_clock_cycles() << endl;
+	mips->print_counters();
+	cout << endl;
+
+	delete mips;
+}
+
+int main(int argc, char **argv){
+
+	bimodal_predictor bimodal;
+
+	run_program("asm/control_dep.asm", 0, false, NULL);
+	run_program("asm/control_dep.asm", 4, false, NULL);
+	run_program("asm/control_dep.asm", 0, true, &bimodal);
+	run_program("asm/data_dep2.asm", 0, true, NULL);
+}
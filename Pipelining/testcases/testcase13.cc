@@ -0,0 +1,50 @@
+#include "sim_pipe.h"
+#include <iostream>
+#include <fstream>
+#include <stdlib.h>
+
+using namespace std;
+
+/* Test case for the O3PipeView trace of the pipelined simulator */
+
+// runs "program" to completion, tracing it to "trace_file", and prints the trace
+void run_program(const char *program, const char *trace_file, branch_predictor *predictor){
+
+	unsigned i, j;
+
+	// instantiates the simulator with a 1MB data memory
+	sim_pipe *mips = new sim_pipe(1024*1024, 0);
+	mips->set_branch_predictor(predictor);
+
+	//loads program in instruction memory at address 0x10000000
+	mips->load_program(program, 0x10000000);
+
+	//initialize general purpose registers and data memory
+	for (i=0; i<7; i++) mips->set_gp_register(i,i);
+	for (i = 0x0, j=1; i<0x20; i+=4, j+=1) mips->write_memory(i,j);
+
+	pipeview_trace trace;
+	if (!trace.open(trace_file)) exit(1);
+	mips->set_trace(&trace);
+	mips->run();
+	trace.close();
+
+	cout << program << (predictor != NULL ? ", " : "") << (predictor != NULL ? predictor->name() : "") << endl;
+	cout << "======================================================================" << endl;
+	cout << "Instruction executed = " << dec << mips->get_instructions_executed() << endl;
+	cout << "Clock cycles = " << dec << mips->get_clock_cycles() << endl;
+	ifstream fin(trace_file);
+	cout << fin.rdbuf() << endl;
+	remove(trace_file);
+
+	delete mips;
+}
+
+int main(int argc, char **argv){
+
+	// squashed instructions retire at tick 0
+	bimodal_predictor bimodal;
+
+	run_program("asm/data_dep2.asm", "testcase13.trace", NULL);
+	run_program("asm/control_dep.asm", "testcase13.trace", &bimodal);
+}
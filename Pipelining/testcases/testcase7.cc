@@ -0,0 +1,63 @@
+#include "sim_pipe.h"
+#include <iostream>
+#include <stdlib.h>
+
+using namespace std;
+
+/* Test case for the functional fast-forward mode of the pipelined simulator */
+
+int main(int argc, char **argv){
+
+	unsigned i, j;
+
+	// instantiates the simulator with a 1MB data memory
+	sim_pipe *mips = new sim_pipe(1024*1024, 0);
+
+	//loads program in instruction memory at address 0x10000000
+	mips->load_program("asm/sort.asm", 0x10000000);
+
+	//initialize general purpose registers
+	for (i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(i,0);
+
+	//initialize data memory with an unsorted array and prints its content
+	for (i = 0xA000, j=10; i<0xA028; i+=4, j=(j*7)%11) mips->write_memory(i,j);
+
+	cout << "\nBEFORE PROGRAM EXECUTION..." << endl;
+	cout << "======================================================================" << endl << endl;
+	mips->print_memory(0xA000, 0xA028);
+	mips->print_memory(0xB000, 0xB028);
+
+	// the INIT block goes through the detailed pipeline
+	cout << "\n4 clock cycles in the detailed pipeline..." << endl;
+	cout << "======================================================================" << endl << endl;
+	mips->run(4);
+	mips->print_registers();
+	cout << endl;
+
+	// drains INIT, runs the copy loop functionally and hands back to the pipeline at SORT
+	cout << "FAST-FORWARDING TO SORT (0x1000002c)..." << endl;
+	cout << "======================================================================" << endl << endl;
+	cout << "Instructions fast-forwarded = " << dec << mips->fast_forward(UNDEFINED, 0x1000002c) << endl;
+	mips->print_registers();
+	mips->print_memory(0xB000, 0xB028);
+	cout << endl;
+
+	// the sort runs functionally to the end of the program
+	cout << "FAST-FORWARDING TO COMPLETION..." << endl << endl;
+	cout << "Instructions fast-forwarded = " << dec << mips->fast_forward(UNDEFINED) << endl;
+
+	cout << "PROGRAM TERMINATED\n";
+	cout << "===================" << endl << endl;
+
+	//prints the value of registers and data memory
+	mips->print_registers();
+	mips->print_memory(0xA000, 0xA028);
+	mips->print_memory(0xB000, 0xB028);
+
+	cout << endl;
+
+	cout << "Total instructions fast-forwarded = " << dec << mips->get_instructions_fast_forwarded() << endl;
+	cout << "Clock cycles = " << dec << mips->get_clock_cycles() << endl;
+
+	delete mips;
+}
@@ -0,0 +1,34 @@
+#include "sim_pipe.h"
+#include <iostream>
+#include <stdlib.h>
+
+using namespace std;
+
+/* Test case for loading an RV32I ELF executable into the pipelined simulator */
+
+int main(int argc, char **argv){
+
+	// instantiates the simulator with a 1MB data memory
+	sim_pipe *mips = new sim_pipe(1024*1024, 0);
+
+	//loads the text at 0x10000000 and the data at 0x2000, the JAL that links has no equivalent
+	mips->load_elf("asm/rv32i_sum.elf");
+
+	cout << "\nBEFORE PROGRAM EXECUTION..." << endl;
+	cout << "======================================================================" << endl << endl;
+	mips->print_registers();
+	mips->print_memory(0x2000, 0x2044);
+
+	// runs the program to completion with the functional interpreter
+	cout << "\nEXECUTING PROGRAM TO COMPLETION..." << endl << endl;
+	cout << "Instructions fast-forwarded = " << dec << mips->fast_forward(UNDEFINED) << endl;
+
+	cout << "PROGRAM TERMINATED\n";
+	cout << "===================" << endl << endl;
+
+	//prints the value of registers and data memory
+	mips->print_registers();
+	mips->print_memory(0x2000, 0x2044);
+
+	delete mips;
+}
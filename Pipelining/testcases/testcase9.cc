@@ -0,0 +1,59 @@
+#include "sim_pipe.h"
+#include "../../Cache_heirarchy/cache_memory.h"
+#include <iostream>
+#include <stdlib.h>
+
+using namespace std;
+
+/* Test case for the data memory timing backends of the pipelined simulator */
+
+// runs asm/no_dep.asm to completion with data memory timed by "backend" (fixed latency if NULL)
+void run_program(const char *name, unsigned mem_latency, memory_backend *backend){
+
+	unsigned i, j;
+
+	// instantiates the simulator with a 1MB data memory
+	sim_pipe *mips = new sim_pipe(1024*1024, mem_latency);
+	mips->set_memory_backend(backend);
+
+	//loads program in instruction memory at address 0x10000000
+	mips->load_program("asm/no_dep.asm", 0x10000000);
+
+	//initialize general purpose registers and data memory
+	for (i=0; i<7; i++) mips->set_gp_register(i,i);
+	for (i = 0x0, j=1; i<0x20; i+=4, j+=1) mips->write_memory(i,j);
+
+	mips->run();
+
+	cout << name << endl;
+	cout << "======================================================================" << endl;
+	mips->print_registers();
+	mips->print_memory(0x0, 0x20);
+	cout << "Instruction executed = " << dec << mips->get_instructions_executed() << endl;
+	cout << "Clock cycles = " << dec << mips->get_clock_cycles() << endl;
+	cout << "Stall inserted = " << dec << mips->get_stalls() << endl;
+	cout << "Memory stalls = " << dec << mips->get_memory_stalls() << endl;
+	cout << "IPC = " << dec << mips->get_IPC() << endl << endl;
+
+	delete mips;
+}
+
+int main(int argc, char **argv){
+
+	run_program("FIXED LATENCY 0", 0, NULL);
+	run_program("FIXED LATENCY 4", 4, NULL);
+
+	// the first load misses to memory, the other accesses hit the block it brought into L1
+	cache_memory *l1_l2 = new cache_memory();
+	if (!l1_l2->load_config("../Cache_heirarchy/configs/l1_l2_timing.cfg")) exit(1);
+	run_program("L1 + L2", 0, l1_l2);
+	l1_l2->print_stats();
+	cout << endl;
+	delete l1_l2;
+
+	cache_memory *l1_vc_l2 = new cache_memory();
+	if (!l1_vc_l2->load_config("../Cache_heirarchy/configs/l1_vc_l2_timing.cfg")) exit(1);
+	run_program("L1 + VC + L2", 0, l1_vc_l2);
+	l1_vc_l2->print_stats();
+	delete l1_vc_l2;
+}
@@ -16,6 +16,8 @@
 #include <string>
 #include <iomanip>
 #include <map>
+#include <algorithm>
+#include <iterator>
 
 using namespace std;
 
@@ -305,7 +307,7 @@ void sim_ooo::print_rob(){
 	for(unsigned i=0; i< rob.num_entries;i++){
 		rob_entry_t entry = rob.entries[i];
 		instruction_t instruction;
-		if (entry.pc != UNDEFINED) instruction = instr_memory[(entry.pc-instr_base_address)>>2]; 
+		if (entry.pc != UNDEFINED) instruction = instruction_at((entry.pc-instr_base_address)>>2); 
 		cout << setfill(' ');
 		cout << setw(5) << i;
 		cout << setw(6);
@@ -423,8 +425,26 @@ void sim_ooo::commit_to_log(instr_window_entry_t entry){
                 if (entry.commit!= UNDEFINED ) log << dec << entry.commit;
                 else    log << "-";
                 log << endl;
+                if (trace != NULL && entry.pc != UNDEFINED) trace_instruction(entry);
 }
 
+/* adds an instruction to the trace. There are no separate front-end stages, the instruction is fetched,
+   decoded and dispatched when it issues; it issues to its unit when it starts executing */
+void sim_ooo::trace_instruction(const instr_window_entry_t &entry){
+	pipeview_record_t record;
+	record.seq = next_seq++;
+	record.pc = entry.pc;
+	record.fetch = record.decode = record.rename = record.dispatch = entry.issue;
+	record.issue = entry.exe;
+	record.complete = entry.wr;
+	record.retire = entry.commit;
+	opcode_t opcode = instruction_at((entry.pc - instr_base_address) >> 2).opcode;
+	record.store = (opcode == SW || opcode == SWS) ? entry.commit : UNDEFINED;
+	trace->write(record, instr_names[opcode]);
+}
+
+void sim_ooo::set_trace(pipeview_trace *trace){this->trace=trace;}
+
 /* prints the content of the log */
 void sim_ooo::print_log(){
 	cout << log.str();
@@ -446,6 +466,10 @@ unsigned sim_ooo::get_instructions_executed(){return instructions_executed;}
 
 unsigned sim_ooo::get_clock_cycles(){return clock_cycles;}
 
+void sim_ooo::set_memory_backend(memory_backend *backend){memory=backend;}
+
+unsigned sim_ooo::get_memory_cycles(){return memory_cycles;}
+
 
 
 /* ============================================================================
@@ -476,6 +500,13 @@ void sim_ooo::load_program(const char *filename, unsigned base_address){
    /* parsing the assembly file line by line */
    string line;
    unsigned instruction_nr = 0;
+   // one decoded entry per line, sized up front so parsing never reallocates the store
+   instr_memory.clear();
+   instr_memory.reserve(count(istreambuf_iterator<char>(fin), istreambuf_iterator<char>(), '\n') + 1);
+   branch_labels.clear();
+   branch_labels.reserve(instr_memory.capacity());
+   fin.clear();
+   fin.seekg(0);
    while (getline(fin,line)){
 	
 	// set the instruction field
@@ -494,6 +525,8 @@ void sim_ooo::load_program(const char *filename, unsigned base_address){
 		if (search == opcodes.end()) cout << "ERROR: invalid opcode: " << token << " !" << endl;
 	}
 
+	instr_memory.push_back(instruction_at(instruction_nr));
+	branch_labels.push_back(string());
 	instr_memory[instruction_nr].opcode = search->second;
 
 	//reading remaining parameters
@@ -552,11 +585,11 @@ void sim_ooo::load_program(const char *filename, unsigned base_address){
 			par1 = strtok (NULL, " \t");
 			par2 = strtok (NULL, " \t");
 			instr_memory[instruction_nr].src1 = atoi(strtok(par1, "R"));
-			instr_memory[instruction_nr].label = par2;
+			branch_labels[instruction_nr] = par2;
 			break;
 		case JUMP:
 			par2 = strtok (NULL, " \t");
-			instr_memory[instruction_nr].label = par2;
+			branch_labels[instruction_nr] = par2;
 		default:
 			break;
 
@@ -566,8 +599,7 @@ void sim_ooo::load_program(const char *filename, unsigned base_address){
 	instruction_nr++;
    }
    //reconstructing the labels of the branch operations
-   int i = 0;
-   while(true){
+   for (unsigned i = 0; i < instr_memory.size(); i++) {
    	instruction_t instr = instr_memory[i];
 	if (instr.opcode == EOP) break;
 	if (instr.opcode == BLTZ || instr.opcode == BNEZ ||
@@ -575,9 +607,9 @@ void sim_ooo::load_program(const char *filename, unsigned base_address){
             instr.opcode == BGEZ || instr.opcode == BLEZ ||
             instr.opcode == JUMP
 	 ){
-		instr_memory[i].immediate = (labels[instr.label] - i - 1) << 2;
+		instr_memory[i].target = labels[branch_labels[i]];
+		instr_memory[i].immediate = (instr_memory[i].target - i - 1) << 2;
 	}
-        i++;
    }
 
 }
@@ -700,18 +732,14 @@ void sim_ooo::reset(){
 
 	//init instruction log
 	init_log();	
+	next_seq=0;
 
 	// data memory
 	for (unsigned i=0; i<data_memory_size; i++) data_memory[i]=0xFF;
 	
-	//instr memory
-	for (int i=0; i<PROGRAM_SIZE;i++){
-		instr_memory[i].opcode=(opcode_t)EOP;
-		instr_memory[i].src1=UNDEFINED;
-		instr_memory[i].src2=UNDEFINED;
-		instr_memory[i].dest=UNDEFINED;
-		instr_memory[i].immediate=UNDEFINED;
-	}
+	//instr memory, unloaded addresses read as EOP
+	instr_memory.clear();
+	branch_labels.clear();
 
 	//general purpose registers
 	for(int i=0;i<int_regs.size();i++)
@@ -742,6 +770,7 @@ void sim_ooo::reset(){
 	//execution statistics
 	clock_cycles = 0;
 	instructions_executed = 0;
+	memory_cycles = 0;
 
 	//other required initializations
 }
@@ -791,7 +820,7 @@ void sim_ooo::issue()
  for(unsigned width_of_Issue=0;width_of_Issue<issue_width;width_of_Issue++)
  {
      unsigned PC=(PC_ADDER-instr_base_address)/4;//You can use the offset as an hexa 0x4 to simulate real addressing
-     instruction_t IR_issued=instr_memory[PC];//Step2:Get ypur first instruction
+     instruction_t IR_issued=instruction_at(PC);//Step2:Get ypur first instruction
      unsigned prevent_PC=PC_ADDER;
 //     cout<<IR_issued.opcode<<endl;
     // unsigned bottle_neck_check=PC_ADDER;
@@ -837,7 +866,7 @@ void sim_ooo::execute()
 
                     for(int j=0;j<num_units;j++)
                     {
-                        instruction_t current_executed_instruction = instr_memory[(reservation_stations.entries[i].pc - instr_base_address)/4];
+                        instruction_t current_executed_instruction = instruction_at((reservation_stations.entries[i].pc - instr_base_address)/4);
                         if(!current_executed_instruction.already_executed)
                             start_execution_operation(i,j,current_executed_instruction);
 
@@ -872,7 +901,7 @@ for(int exec_enter_loop_1=0;exec_enter_loop_1<num_units;exec_enter_loop_1++)
         {
             if(exec_units[exec_enter_loop_1].pc==reservation_stations.entries[res_stat_entry_loop_1].pc)
             {
-                instruction_t current_instruction = instr_memory[(exec_units[exec_enter_loop_1].pc - instr_base_address)/4];
+                instruction_t current_instruction = instruction_at((exec_units[exec_enter_loop_1].pc - instr_base_address)/4);
                 switch (current_instruction.opcode)
                 {
                     //see book how each values are passed and the alu_func above
@@ -1030,7 +1059,7 @@ void sim_ooo::commit() {
             //Start commiting and flushing now
             if (i == Rob_head && commit_cycle_track != clock_cycles && commit_per_cc==0) {
                 if (rob.entries[i].ready) {
-                    instruction_t Ir_current=instr_memory[(rob.entries[i].pc-instr_base_address)/4];
+                    instruction_t Ir_current=instruction_at((rob.entries[i].pc-instr_base_address)/4);
 //                    if(!flush_protocol_activated &&run_cycles && Ir_current.opcode==EOP)
 //                    {
 //                        run_cycles=false;
@@ -1557,6 +1586,13 @@ void sim_ooo::start_execution_operation(unsigned res_stat_entry, unsigned execut
         //calculate addresss the main job of load
         reservation_stations.entries[res_stat_entry].address += reservation_stations.entries[res_stat_entry].value1;
         exec_units[execution_stat_entry].busy=exec_units[execution_stat_entry].latency;//This is a better way to keep the unit busy instead of adding a latency and stalling it sourced from github links of tomasulo in java
+        if(memory!=NULL)
+        {
+            //the unit stays busy until the memory backend returns the data
+            unsigned extra_cycles=memory->access(reservation_stations.entries[res_stat_entry].address,false);
+            exec_units[execution_stat_entry].busy+=extra_cycles;
+            memory_cycles+=extra_cycles;
+        }
         exec_units[execution_stat_entry].pc=reservation_stations.entries[res_stat_entry].pc;//copy pc of execution units to reservation stations
         //update rob entries
         for(int rob_index=0;rob_index<rob.num_entries;rob_index++)
@@ -1672,6 +1708,8 @@ void sim_ooo::start_execution_operation(unsigned res_stat_entry, unsigned execut
     if(just_store(Curren_in.opcode)  && !Curren_in.already_executed)
     {
         reservation_stations.entries[res_stat_entry].address = reservation_stations.entries[res_stat_entry].address+float2unsigned( get_fp_register(Curren_in.src1));
+        //stores do not wait for memory here, the backend only sees the access
+        if(memory!=NULL) memory->access(reservation_stations.entries[res_stat_entry].address,true);
         Curren_in.already_executed=true;
         return;
 
@@ -1734,4 +1772,20 @@ void sim_ooo::follow_flush_protocol(unsigned  rob_index)
     }
     Rob_head=0;
 
-}
\ No newline at end of file
+}
+
+/* the EOP read past the end of the program, built once: the member initialisers rule out brace initialisation */
+static instruction_t end_of_program(){
+	instruction_t eop;
+	eop.opcode = EOP;
+	eop.src1 = eop.src2 = eop.dest = UNDEFINED;
+	eop.immediate = eop.target = UNDEFINED;
+	return eop;
+}
+
+/* returns the decoded instruction at "index", addresses past the loaded program read as EOP */
+const instruction_t &sim_ooo::instruction_at(unsigned index){
+	static const instruction_t past_end = end_of_program();
+	if (index < instr_memory.size()) return instr_memory[index];
+	return past_end;
+}
@@ -7,6 +7,9 @@
 #include <cstring>
 #include <sstream>
 #include <vector>
+#include <type_traits>
+#include "../Cache_heirarchy/memory_backend.h"
+#include "../Pipelining/pipeview_trace.h"
 
 using namespace std;
 
@@ -15,10 +18,9 @@ using namespace std;
 #define NUM_OPCODES 24
 #define NUM_STAGES 4
 #define MAX_UNITS 10 
-#define PROGRAM_SIZE 50 
 
 // instructions supported
-typedef enum {LW, SW, ADD, ADDI, SUB, SUBI, XOR, AND, MULT, DIV, BEQZ, BNEZ, BLTZ, BGTZ, BLEZ, BGEZ, JUMP, EOP, LWS, SWS, ADDS, SUBS, MULTS, DIVS} opcode_t;
+typedef enum : unsigned char {LW, SW, ADD, ADDI, SUB, SUBI, XOR, AND, MULT, DIV, BEQZ, BNEZ, BLTZ, BGTZ, BLEZ, BGEZ, JUMP, EOP, LWS, SWS, ADDS, SUBS, MULTS, DIVS} opcode_t;
 
 // reservation stations types
 typedef enum {INTEGER_RS, ADD_RS, MULT_RS, LOAD_B} res_station_t;
@@ -30,18 +32,28 @@ typedef enum {INTEGER, ADDER, MULTIPLIER, DIVIDER, MEMORY} exe_unit_t;
 typedef enum {ISSUE, EXECUTE, WRITE_RESULT, COMMIT} stage_t;
 
 // instruction data type
+// register number of a decoded instruction, one byte wide; 0xFF reads back as UNDEFINED
+struct reg_field_t{
+        unsigned char number;
+        reg_field_t() = default;
+        reg_field_t(unsigned reg) : number(reg > 0xFF ? 0xFF : reg) {}
+        operator unsigned() const { return number == 0xFF ? UNDEFINED : number; }
+};
+
+// decoded micro-op, copied through the pipeline latches every cycle: plain data, no heap
 typedef struct{
         opcode_t opcode; //opcode
-        unsigned src1; //first source register in the assembly instruction (for SW, register to be written to memory)
-        unsigned src2; //second source register in the assembly instruction
-        unsigned dest; //destination register
-        unsigned immediate; //immediate field
-        string label; //for conditional branches, label of the target instruction - used only for parsing/debugging purposes
+        reg_field_t src1; //first source register in the assembly instruction (for SW, register to be written to memory)
+        reg_field_t src2; //second source register in the assembly instruction
+        reg_field_t dest; //destination register
+        unsigned immediate; //immediate field (for branches, offset to the target)
+        unsigned target; //for branches, index of the target instruction resolved at load time, UNDEFINED otherwise
         bool already_issued=false;//checks if the instruction is already issud
         bool already_executed=false;//checks if the instrcution is already excuted
         bool already_written=false;
         bool already_commited=false;
 } instruction_t;
+static_assert(sizeof(instruction_t) <= 16 && is_trivially_copyable<instruction_t>::value, "instruction_t must stay 16 bytes and trivially copyable");
 
 // execution unit
 typedef struct{
@@ -141,7 +153,9 @@ class sim_ooo
         unsigned num_units;
 
 	//instruction memory
-	instruction_t instr_memory[PROGRAM_SIZE];
+	vector<instruction_t> instr_memory;
+	vector<string> branch_labels; //label of each branch as written in the program, for debugging
+	const instruction_t &instruction_at(unsigned index);
 
         //base address in the instruction memory where the program is loaded
         unsigned instr_base_address;
@@ -161,6 +175,15 @@ class sim_ooo
 	//execution log
 	stringstream log;
 
+	//timing of the loads in the MEMORY units beyond the unit latency, none if NULL (not owned)
+	memory_backend *memory=NULL;
+	unsigned memory_cycles=0;
+
+	//O3PipeView trace of the instructions leaving the window, none if NULL (not owned)
+	pipeview_trace *trace=NULL;
+	unsigned next_seq=0;
+	void trace_instruction(const instr_window_entry_t &entry);
+
 public:
 
 
@@ -229,6 +252,13 @@ public:
 	//returns the number of clock cycles 
 	unsigned get_clock_cycles();
 
+	//adds the latency of "backend" (not owned) to every load in a MEMORY unit and tells it
+	//every store address, NULL keeps the unit latency alone
+	void set_memory_backend(memory_backend *backend);
+
+	//returns the clock cycles loads spent in the memory backend beyond the MEMORY unit latency
+	unsigned get_memory_cycles();
+
 	//prints the content of the data memory within the specified address range
 	void print_memory(unsigned start_address, unsigned end_address);
 
@@ -256,6 +286,10 @@ public:
 	//commit an instruction to the log
 	void commit_to_log(instr_window_entry_t iwe);
 
+	//streams the timeline of every instruction leaving the window to "trace" (not owned) in the
+	//O3PipeView format, flushed ones without a retire cycle; NULL stops tracing
+	void set_trace(pipeview_trace *trace);
+
 	//print log
 	void print_log();
 
@@ -0,0 +1,60 @@
+#include "sim_ooo.h"
+#include <iostream>
+#include <fstream>
+#include <stdlib.h>
+#include <sstream>
+
+using namespace std;
+
+/* Test case for the O3PipeView trace of the out-of-order simulator */
+
+/* convert a float into an unsigned */
+inline unsigned float2unsigned(float value){
+        unsigned result;
+        memcpy(&result, &value, sizeof value);
+        return result;
+}
+
+int main(int argc, char **argv){
+
+	unsigned i, j;
+
+	// instantiates sim_ooo with a 1MB data memory
+	sim_ooo *ooo = new sim_ooo(1024*1024, 
+				   6,
+				   3, 2, 2, 2,
+				   4);
+
+	//initialize execution units
+        ooo->init_exec_unit(INTEGER, 2, 2);
+        ooo->init_exec_unit(ADDER, 2, 2);
+        ooo->init_exec_unit(MULTIPLIER, 10, 1);
+        ooo->init_exec_unit(DIVIDER, 40, 1);
+        ooo->init_exec_unit(MEMORY, 1, 1);
+
+	//loads program in instruction memory at address 0x00000000
+	ooo->load_program("asm/code_ooo2.asm", 0x00000000);
+
+	//initialize general purpose registers and data memory
+	for (i=0; i<5; i++) ooo->set_fp_register(i, (float)i);
+	for (i = 0xA000, j=0; i<0xA020; i+=4, j+=1) ooo->write_memory(i,float2unsigned((float)(j+1)));	
+
+	// traces the program to completion
+	pipeview_trace trace;
+	if (!trace.open("testcase11.trace")) exit(1);
+	ooo->set_trace(&trace);
+	ooo->run(); 
+	trace.close();
+
+	//the trace follows the execution log
+	ooo->print_log();
+	cout << endl;
+	ifstream fin("testcase11.trace");
+	cout << fin.rdbuf() << endl;
+	remove("testcase11.trace");
+
+	cout << "Instruction executed = " << dec << ooo->get_instructions_executed() << endl;
+	cout << "Clock cycles = " << dec << ooo->get_clock_cycles() << endl;
+
+	delete ooo;
+}